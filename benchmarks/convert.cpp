@@ -0,0 +1,121 @@
+#include <convert.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/* Conversion kernel benchmark.
+ * Every format with 1 and 3 channels is checked bit-exact against the scalar reference
+ * for all lengths up to 64 samples and for a 4096 sample block, then both are timed
+ * on the block. Exit code is non zero on mismatch.
+ * On ARM run natively or under qemu-user, e.g. qemu-arm -cpu cortex-a7 ./bench_convert
+ */
+
+static const struct {
+    ConvertFormat format;
+    const char *name;
+} _formats[] = {
+    {ConvertUInt8, "uint8   "},
+    {ConvertInt16LE, "int16le "},
+    {ConvertInt16BE, "int16be "},
+    {ConvertInt24BE, "int24be "},
+    {ConvertUInt24BE, "uint24be"},
+};
+
+static const size_t _block = 4096;
+static const size_t _repeat = 200;
+
+struct Buffers {
+    std::vector<float> converted[3];
+    std::vector<float> reference[3];
+    std::vector<int32_t> unpacked[3];
+    std::vector<int32_t> unpacked_reference[3];
+    float *converted_out[3];
+    float *reference_out[3];
+    int32_t *unpacked_out[3];
+    int32_t *unpacked_reference_out[3];
+
+    Buffers()
+    {
+        for (int c=0; c<3; c++) {
+            converted[c].resize(_block);
+            reference[c].resize(_block);
+            unpacked[c].resize(_block);
+            unpacked_reference[c].resize(_block);
+            converted_out[c] = converted[c].data();
+            reference_out[c] = reference[c].data();
+            unpacked_out[c] = unpacked[c].data();
+            unpacked_reference_out[c] = unpacked_reference[c].data();
+        }
+    }
+
+    bool check(ConvertFormat format, const uint8_t data[], size_t count, size_t channels)
+    {
+        const float scale = 0.0078125f * 1.37f;
+        const float offset = -3.25f;
+        convert(format, data, count, channels, scale, offset, converted_out);
+        convertReference(format, data, count, channels, scale, offset, reference_out);
+        unpack(format, data, count, channels, unpacked_out);
+        unpackReference(format, data, count, channels, unpacked_reference_out);
+        for (size_t c=0; c<channels; c++) {
+            if (memcmp(converted_out[c], reference_out[c], count * sizeof(float)) != 0
+                    || memcmp(unpacked_out[c], unpacked_reference_out[c], count * sizeof(int32_t)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+int main()
+{
+    std::vector<uint8_t> data(_block * 3 * 3);
+    srand(1);
+    for (uint8_t &byte: data) {
+        byte = rand();
+    }
+
+    Buffers buffers;
+    int failures = 0;
+    Info() << "backend:" << convertBackend();
+
+    for (const auto &format: _formats) {
+        for (size_t channels=1; channels<=3; channels+=2) {
+            bool exact = buffers.check(format.format, data.data(), _block, channels);
+            for (size_t count=1; count<=64 && exact; count++) {
+                // odd start keeps loads unaligned
+                exact = buffers.check(format.format, data.data() + 1, count, channels);
+            }
+            if (!exact) {
+                failures++;
+            }
+
+            uint64_t start = monotonicNsec();
+            for (size_t r=0; r<_repeat; r++) {
+                convertReference(format.format, data.data(), _block, channels, 0.5f, 1.0f, buffers.reference_out);
+            }
+            uint64_t scalar = monotonicNsec() - start;
+
+            start = monotonicNsec();
+            for (size_t r=0; r<_repeat; r++) {
+                convert(format.format, data.data(), _block, channels, 0.5f, 1.0f, buffers.converted_out);
+            }
+            uint64_t kernel = monotonicNsec() - start;
+
+            float values = _block * channels * _repeat;
+            Info() << format.name << "channels:" << (unsigned)channels
+                   << "bit-exact:" << exact
+                   << "scalar ns/value:" << scalar / values
+                   << "kernel ns/value:" << kernel / values
+                   << "speedup:" << (float)scalar / kernel;
+        }
+    }
+
+    if (failures > 0) {
+        Error() << failures << "kernels differ from scalar reference";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include <i2casync.h>
+#include <simi2c.h>
+#include <simdevices.h>
+#include <l3gd20h.h>
+#include <ssd1306.h>
+#include <poller.h>
+#include <timer.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+/* Sensor read latency on a bus shared with a display.
+ * Bus is simulated with SimI2C at 400 kHz, raw gyro reads go to a second L3GD20H model.
+ * 200 Hz "gyro" reads 30 bytes, display commits a full frame at 20 Hz.
+ * Latency is measured from the oldest unserved gyro deadline to the moment data is in the loop,
+ * so deadlines missed while the loop is blocked are accounted too.
+ *  sync        - both devices use blocking calls from the loop
+ *  sync chunks - blocking calls, display frame is sent one page per loop iteration
+ *  async fifo  - both use I2CAsync with the same priority
+ *  async prio  - gyro reads use high priority and preempt queued display pages
+ * L3GD20H driver is also run on the async engine to check its port.
+ */
+
+enum Mode {
+    Sync,
+    SyncChunked,
+    AsyncFifo,
+    AsyncPriority
+};
+
+static const char *_names[] = {"sync:       ", "sync chunks:", "async fifo: ", "async prio: "};
+
+static void _run(Mode mode, int seconds)
+{
+    const uint64_t period = 5000000;
+    SimI2C bus;
+    SimL3GD20H gyro_model(0x6A), sensor_model(L3GD20H_DEFAULT_ADDRESS);
+    SimSSD1306 display_model(SSD1306_I2C_ADDRESS);
+    bus.attach(&gyro_model);
+    bus.attach(&sensor_model);
+    bus.attach(&display_model);
+    Poller poller(1024, false);
+    I2CAsync engine(&bus, &poller);
+
+    std::vector<uint64_t> latency;
+    latency.reserve(seconds * 200 + 100);
+
+    uint64_t expected = 0;
+    Timer gyro(&poller);
+    gyro.setOverrunPolicy(Timer::OverrunSkip);
+    gyro.onTimeout = [&]() {
+        uint64_t now = monotonicNsec();
+        uint64_t deadline = now - (now - Timer::epoch()) % period;
+        uint64_t start = (expected != 0 && expected < deadline) ? expected : deadline;
+        expected = deadline + period;
+        if (mode == Sync || mode == SyncChunked) {
+            uint8_t data[30];
+            bus.readBytes(0x6A, 0x28 | 0x80, sizeof(data), data);
+            latency.push_back(monotonicNsec() - start);
+            return;
+        }
+        I2CAsync::Transaction transaction;
+        transaction.readBytes(0x6A, 0x28 | 0x80, 30);
+        engine.submit(std::move(transaction), [&latency, start](int, I2CAsync::Transaction&) {
+            latency.push_back(monotonicNsec() - start);
+        }, mode == AsyncPriority ? I2CAsync::PriorityHigh : I2CAsync::PriorityLow);
+    };
+    gyro.startAligned({0, (long)period}, {0, 0});
+
+    SSD1306 *display = nullptr;
+    if (mode == Sync) {
+        display = new SSD1306(SSD1306_I2C_ADDRESS, &bus, false);
+    } else if (mode == SyncChunked) {
+        display = new SSD1306(SSD1306_I2C_ADDRESS, &bus, false, &poller);
+    } else {
+        display = new SSD1306(SSD1306_I2C_ADDRESS, &engine, false);
+    }
+    display->initialize();
+    uint8_t frame = 0;
+    Timer refresh(&poller);
+    refresh.onTimeout = [&]() {
+        frame++;
+        display->clear();
+        display->drawLine(0, frame % 64, 127, 63 - frame % 64);
+        // full frames keep bus load of the comparison independent of drawn content
+        display->invalidate();
+        display->commit();
+    };
+    refresh.start(50);
+
+    L3GD20H *sensor = nullptr;
+    unsigned long samples = 0;
+    if (mode == AsyncPriority) {
+        sensor = new L3GD20H(L3GD20H_DEFAULT_ADDRESS, &engine, &poller);
+        sensor->onData = [&samples](float, float, float) { samples++; };
+        if (sensor->initialize() < 0 || sensor->start() < 0) {
+            Error() << "Unable to start gyroscope";
+        }
+    }
+
+    Timer finish(&poller);
+    finish.onTimeout = [&]() { poller.stop(); };
+    finish.start(seconds * 1000);
+
+    uint64_t begin = monotonicNsec();
+    poller.loop();
+    uint64_t elapsed = monotonicNsec() - begin;
+
+    gyro.stop(); refresh.stop();
+    if (sensor != nullptr) {
+        sensor->stop();
+    }
+    while (engine.pending() > 0) {
+        timespec delay = {0, 1000000};
+        nanosleep(&delay, nullptr);
+    }
+    poller.stop();
+
+    uint64_t transfers, messages, bytes, errors, busy;
+    bus.getStatistics(transfers, messages, bytes, errors, busy);
+
+    std::sort(latency.begin(), latency.end());
+    size_t n = latency.size();
+    if (n == 0) {
+        Error() << "No samples";
+    } else {
+        Info() << _names[mode] << "reads" << (unsigned long)n
+               << "latency us p50:" << latency[n / 2] / 1000.f
+               << "p99:" << latency[n * 99 / 100] / 1000.f
+               << "max:" << latency[n - 1] / 1000.f
+               << "bus kB/s:" << bytes * 1000000.f / elapsed;
+    }
+    if (sensor != nullptr) {
+        Info() << "L3GD20H on async engine delivered" << samples << "samples";
+    }
+
+    delete sensor;
+    delete display;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    _run(Sync, seconds);
+    _run(SyncChunked, seconds);
+    _run(AsyncFifo, seconds);
+    _run(AsyncPriority, seconds);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <i2cbatch.h>
+#include <simi2c.h>
+#include <simdevices.h>
+#include <pca9685.h>
+#include <ssd1306.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+
+/* Syscalls and wall time per driver operation, one ioctl per call vs I2CBatch.
+ * Adapter is simulated with SimI2C at 400 kHz and 50 us per transfer overhead
+ * which stands for syscall and adapter setup.
+ * Legacy sequences are copies of the driver code before batching.
+ */
+
+static void _measure(SimI2C &bus, const char *name, int iterations, std::function<void()> operation)
+{
+    bus.resetStatistics();
+    uint64_t start = monotonicNsec();
+    for (int i=0; i<iterations; i++) {
+        operation();
+    }
+    uint64_t elapsed = monotonicNsec() - start;
+
+    uint64_t transfers, messages, bytes, errors, busy;
+    bus.getStatistics(transfers, messages, bytes, errors, busy);
+    Info() << name << "syscalls/op:" << (float)transfers / iterations
+           << "messages/op:" << (float)messages / iterations
+           << "bytes/op:" << (float)bytes / iterations
+           << "us/op:" << elapsed / 1000.f / iterations;
+}
+
+static void _legacySetPrescale(I2CBus &bus)
+{
+    uint8_t oldmode;
+    bus.readByte(0x40, 0x00, oldmode);
+    bus.writeByte(0x40, 0x00, oldmode | 0x10);
+    bus.writeByte(0x40, 0xFE, 121);
+    bus.writeByte(0x40, 0x00, oldmode);
+    bus.writeByte(0x40, 0x00, oldmode | 0x20);
+}
+
+static void _legacySSD1306Command(I2CBus &bus, uint8_t command)
+{
+    uint8_t batch[] = { 0x00, command };
+    bus.writeBatch(SSD1306_I2C_ADDRESS, sizeof(batch), batch);
+}
+
+static void _legacySSD1306Initialize(I2CBus &bus)
+{
+    static const uint8_t commands[] = {
+        0xAE, 0xD5, 0xF0, 0xA8, 0x3F, 0xD3, 0x00, 0x40, 0x8D, 0x14, 0x20, 0x00, 0xA1,
+        0xC8, 0xDA, 0x12, 0x81, 0xCF, 0xD9, 0xF1, 0xDB, 0x40, 0xA4, 0xA6, 0xAF
+    };
+    for (uint8_t command: commands) {
+        _legacySSD1306Command(bus, command);
+    }
+}
+
+static void _legacySSD1306Commit(I2CBus &bus, const uint8_t *buffer)
+{
+    static const uint8_t commands[] = { 0x21, 0, 127, 0x22, 0, 7 };
+    for (uint8_t command: commands) {
+        _legacySSD1306Command(bus, command);
+    }
+    uint8_t data[129];
+    for (size_t i=0; i<8; i++) {
+        data[0] = 0x40;
+        memcpy(data+1, buffer+i*128, 128);
+        bus.writeBatch(SSD1306_I2C_ADDRESS, sizeof(data), data);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 50;
+    SimI2C bus;
+    bus.setTransferOverhead(50000);
+    SimPCA9685 pwm_model;
+    SimSSD1306 display_model;
+    SimMS5611 baro_model;
+    bus.attach(&pwm_model);
+    bus.attach(&display_model);
+    bus.attach(&baro_model);
+
+    PCA9685 pwm(0x40, &bus);
+    _measure(bus, "PCA9685 setPrescale legacy: ", iterations, [&]() { _legacySetPrescale(bus); });
+    _measure(bus, "PCA9685 setPrescale batched:", iterations, [&]() { pwm.setFrequency(50); });
+
+    SSD1306 display(SSD1306_I2C_ADDRESS, &bus, false);
+    uint8_t frame[1024];
+    memset(frame, 0x55, sizeof(frame));
+    _measure(bus, "SSD1306 initialize legacy:  ", iterations, [&]() { _legacySSD1306Initialize(bus); });
+    _measure(bus, "SSD1306 initialize batched: ", iterations, [&]() { display.initialize(); });
+    _measure(bus, "SSD1306 commit legacy:      ", iterations, [&]() { _legacySSD1306Commit(bus, frame); });
+    _measure(bus, "SSD1306 commit batched:     ", iterations, [&]() { display.invalidate(); display.commit(); });
+
+    uint8_t prom[16];
+    _measure(bus, "MS5611 PROM legacy:         ", iterations, [&]() {
+        for (size_t i=0; i<16; i+=2) {
+            bus.readBytes(0x77, 0xA0 + i, 2, prom + i);
+        }
+    });
+    _measure(bus, "MS5611 PROM batched:        ", iterations, [&]() {
+        I2CBatch batch(&bus);
+        for (size_t i=0; i<16; i+=2) {
+            batch.readBytes(0x77, 0xA0 + i, 2, prom + i);
+        }
+        batch.submit();
+    });
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <i2cscheduler.h>
+#include <simi2c.h>
+#include <simdevices.h>
+#include <poller.h>
+#include <timer.h>
+#include <log.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Navio bus load under I2CScheduler on SimI2C at 400 kHz.
+ * Gyroscope, two barometers, ADC and PWM controller run periodic jobs,
+ * display refresh is either one 1 KB frame job or eight page jobs.
+ * Utilisation is the same, but the long non-preemptive frame job would block gyro
+ * reads past their deadline, so it is rejected and the bus is run without display.
+ * Finally an extra display is added to show utilisation based rejection.
+ */
+
+struct Device {
+    const char *name;
+    uint8_t address;
+    uint64_t period_usec;
+    uint64_t deadline_usec;
+    uint8_t reg;
+    uint8_t size;
+    bool write;
+};
+
+static const Device _devices[] = {
+    {"gyro",    0x6B, 5000,  0,     0xA8, 30, false},
+    {"baro1",   0x77, 10000, 0,     0x00, 3,  false},
+    {"baro2",   0x76, 10000, 0,     0x00, 3,  false},
+    {"adc",     0x48, 10000, 0,     0x00, 2,  false},
+    {"pwm",     0x40, 20000, 0,     0x06, 64, true},
+};
+
+static int _transfer(I2CBus *bus, const Device &device)
+{
+    uint8_t data[255];
+    if (device.write) {
+        memset(data, 0, device.size);
+        return bus->writeBytes(device.address, device.reg, device.size, data);
+    }
+    return bus->readBytes(device.address, device.reg, device.size, data);
+}
+
+static int _page(I2CBus *bus, uint8_t address, const uint8_t *frame, size_t page)
+{
+    uint8_t data[129];
+    data[0] = 0x40;
+    memcpy(data + 1, frame + page * 128, 128);
+    return bus->writeBatch(address, sizeof(data), data);
+}
+
+static void _run(bool paged, int seconds)
+{
+    SimI2C bus;
+    SimL3GD20H gyro;
+    SimMS5611 baro1(0x77), baro2(0x76);
+    SimADS1115 adc;
+    SimPCA9685 pwm;
+    SimSSD1306 display1(0x3C), display2(0x3D);
+    SimI2CDevice *models[] = {&gyro, &baro1, &baro2, &adc, &pwm, &display1, &display2};
+    for (SimI2CDevice *model: models) {
+        bus.attach(model);
+    }
+    Poller poller(1024, false);
+    I2CScheduler scheduler(&bus, &poller);
+
+    for (const Device &device: _devices) {
+        size_t bytes = device.size + (device.write ? 2 : 3);
+        if (scheduler.addPeriodic(device.address, device.period_usec, device.deadline_usec, bytes,
+                                  std::bind(_transfer, std::placeholders::_1, device)) < 0) {
+            Error() << "Unable to add" << device.name;
+        }
+    }
+
+    uint8_t frame[1024];
+    memset(frame, 0x55, sizeof(frame));
+    if (paged) {
+        int id = scheduler.addPeriodic(0x3C, 12500, 0, 130, [&frame](I2CBus *bus) {
+            static size_t page = 0;
+            page = (page + 1) % 8;
+            return _page(bus, 0x3C, frame, page);
+        });
+        Info() << "paged display:" << (id < 0 ? "rejected" : "admitted");
+    } else {
+        int id = scheduler.addPeriodic(0x3C, 100000, 0, 1030, [&frame](I2CBus *bus) {
+            for (size_t page=0; page<8; page++) {
+                if (_page(bus, 0x3C, frame, page) < 0) {
+                    return -1;
+                }
+            }
+            return 0;
+        });
+        Info() << "frame display:" << (id < 0 ? "rejected" : "admitted");
+    }
+
+    Timer finish(&poller);
+    finish.onTimeout = [&]() { poller.stop(); };
+    finish.start(seconds * 1000);
+    scheduler.resetStatistics();
+    poller.loop();
+
+    Info() << (paged ? "paged set:" : "frame set:")
+           << "admitted utilisation" << scheduler.admittedUtilisation()
+           << "measured" << scheduler.utilisation()
+           << "deadline misses" << (unsigned long)scheduler.deadlineMisses();
+    for (const Device &device: _devices) {
+        uint64_t jobs, misses;
+        float throughput;
+        scheduler.getDeviceStatistics(device.address, jobs, misses, throughput);
+        Info() << "   " << device.name << "jobs" << (unsigned long)jobs << "misses" << (unsigned long)misses
+               << "B/s" << throughput;
+    }
+    uint64_t jobs, misses;
+    float throughput;
+    scheduler.getDeviceStatistics(0x3C, jobs, misses, throughput);
+    Info() << "    display jobs" << (unsigned long)jobs << "misses" << (unsigned long)misses << "B/s" << throughput;
+
+    if (paged) {
+        int id = scheduler.addPeriodic(0x3D, 3125, 0, 130, [&frame](I2CBus *bus) {
+            return _page(bus, 0x3D, frame, 0);
+        });
+        Info() << "second display at 40 fps:" << (id < 0 ? "rejected" : "admitted");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    _run(false, seconds);
+    _run(true, seconds);
+    return 0;
+}
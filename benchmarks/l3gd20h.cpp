@@ -0,0 +1,148 @@
+#include <simi2c.h>
+#include <simdevices.h>
+#include <poller.h>
+#include <timer.h>
+#include <l3gd20h.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+/* L3GD20H sample delivery benchmark.
+ * Driver polls SimL3GD20H at 800 Hz. Bus wrapper marks the end of every FIFO data
+ * transfer, consumer marks the last sample of the block, difference is decode plus
+ * delivery cost including a first order low-pass filter in the consumer.
+ * Per sample onData is compared with onBlock, block run also checks reconstructed
+ * timestamps against sample times of the model, 98% of blocks should be within 0.25 ms.
+ * Blocks around FIFO overruns (poll delayed by more than 10 ms) could be one period off,
+ * they are counted separately.
+ */
+
+#define TIMESTAMP_ERROR_BOUND_NSEC 250000
+
+class TimedBus: public SimI2C
+{
+public:
+    uint64_t transfer_end = 0;
+    unsigned samples = 0;
+
+    int readWrite(i2c_rdwr_ioctl_data &messages) override
+    {
+        int result = SimI2C::readWrite(messages);
+        if (messages.nmsgs == 2 && messages.msgs[1].len >= 6) {
+            samples = messages.msgs[1].len / 6;
+            transfer_end = monotonicNsec();
+        }
+        return result;
+    }
+};
+
+struct Filter {
+    float x = 0, y = 0, z = 0;
+
+    void update(float sx, float sy, float sz)
+    {
+        x += 0.1f * (sx - x);
+        y += 0.1f * (sy - y);
+        z += 0.1f * (sz - z);
+    }
+};
+
+struct Result {
+    uint64_t busy = 0;
+    uint64_t samples = 0;
+    std::vector<int64_t> timestamp_error;
+    unsigned overrun_blocks = 0;
+};
+
+static Result _run(bool block, int seconds)
+{
+    TimedBus bus;
+    SimL3GD20H model;
+    bus.attach(&model);
+    Poller poller(1024, false);
+    L3GD20H sensor(L3GD20H_DEFAULT_ADDRESS, &bus, &poller);
+    Filter filter;
+    Result result;
+    unsigned remaining = 0;
+    uint64_t overruns = 0;
+    unsigned settle = 0;
+
+    if (block) {
+        sensor.onBlock = [&](const L3GD20H::Block &samples) {
+            for (size_t i=0; i<samples.size; i++) {
+                filter.update(samples.x[i], samples.y[i], samples.z[i]);
+            }
+            result.busy += monotonicNsec() - bus.transfer_end;
+            result.samples += samples.size;
+            // overrun block and the one after it could take samples dropped or left in FIFO during read
+            if (model.overruns() != overruns) {
+                overruns = model.overruns();
+                settle = 2;
+            }
+            if (settle > 0) {
+                settle--;
+                result.overrun_blocks++;
+                return;
+            }
+            result.timestamp_error.push_back((int64_t)(samples.timestamp[samples.size - 1] - model.lastSampleTime()));
+        };
+    } else {
+        sensor.onData = [&](float x, float y, float z) {
+            filter.update(x, y, z);
+            if (remaining == 0) {
+                remaining = bus.samples;
+            }
+            if (--remaining == 0) {
+                result.busy += monotonicNsec() - bus.transfer_end;
+                result.samples += bus.samples;
+            }
+        };
+    }
+
+    if (sensor.initialize() < 0 || sensor.start(L3GD20H_RATE_OCTA) < 0) {
+        Error() << "Unable to start L3GD20H";
+        exit(EXIT_FAILURE);
+    }
+
+    Timer finish(&poller);
+    finish.onTimeout = [&]() { poller.stop(); };
+    finish.start(seconds * 1000);
+    poller.loop();
+    sensor.stop();
+
+    if (filter.x == 12345.f) {
+        Info() << "keep filter";
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+
+    Result data = _run(false, seconds);
+    Result block = _run(true, seconds);
+
+    Info() << "onData  ns/sample:" << (float)data.busy / data.samples << "samples:" << data.samples;
+    Info() << "onBlock ns/sample:" << (float)block.busy / block.samples << "samples:" << block.samples;
+
+    std::vector<int64_t> &error = block.timestamp_error;
+    if (error.empty()) {
+        Error() << "No sample blocks were delivered";
+        return EXIT_FAILURE;
+    }
+    std::sort(error.begin(), error.end());
+    int64_t p1 = error[error.size() / 100];
+    int64_t p99 = error[error.size() * 99 / 100];
+    Info() << "timestamp error us p1:" << p1 / 1000.f
+           << "p50:" << error[error.size() / 2] / 1000.f
+           << "p99:" << p99 / 1000.f << "skipped overrun blocks:" << block.overrun_blocks;
+    if (p1 < -TIMESTAMP_ERROR_BOUND_NSEC || p99 > TIMESTAMP_ERROR_BOUND_NSEC) {
+        Error() << "Timestamp error exceeds" << TIMESTAMP_ERROR_BOUND_NSEC / 1000 << "us";
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <log.h>
+#include <utils.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+/* Logger hot path benchmark.
+ * Compares the stringstream Message pipeline (kept below as legacy) with binary records
+ * pushed to per thread rings. Timed section is the call site only; stderr goes to /dev/null
+ * while measuring. Mean comes from untimed bursts, percentiles from individually timed
+ * messages and include one clock_gettime. Allocations are counted through global operator new.
+ * Last two runs show a rate limited call site and a message below runtime level.
+ */
+
+static std::atomic<size_t> _allocations(0);
+
+void *operator new(size_t size)
+{
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+#pragma GCC diagnostic pop
+
+namespace legacy {
+
+class Message
+{
+    struct Stream {
+        Stream(const MessageContext &ctx, MessageType type)
+            : ref(1), space(true), ss(), context(ctx), type(type){}
+        int ref;
+        bool space;
+        std::stringstream ss;
+        MessageContext context;
+        MessageType type;
+    } *stream;
+
+public:
+    inline Message(const MessageContext &context, MessageType type) : stream(new Stream(context, type)) {}
+    inline Message(const Message &o):stream(o.stream) { ++stream->ref; }
+    inline ~Message() {
+        if (!--stream->ref) {
+            std::cerr << stream->context._file << ":";
+            std::cerr << stream->context._line << " ";
+            std::cerr << stream->context._function << "(): ";
+            std::cerr << stream->ss.str() << std::endl;
+            delete stream;
+        }
+    }
+
+    inline Message &maybeSpace() { if (stream->space) stream->ss << ' '; return *this; }
+
+    inline Message &operator<<(unsigned int t) { stream->ss << t; return maybeSpace(); }
+    inline Message &operator<<(float t) { stream->ss << t; return maybeSpace(); }
+    inline Message &operator<<(const char* t) { stream->ss << t; return maybeSpace(); }
+};
+
+class MessageLogger
+{
+public:
+    MessageLogger(int line, const char *file, const char *function): context(line, file, function) {}
+    Message warn() const { return Message(context, MessageType::MessageWarn); }
+
+private:
+    MessageContext context;
+};
+
+}
+
+#define LegacyWarn legacy::MessageLogger(__LINE__, __FILE__, __FUNCTION__).warn
+
+struct Result {
+    std::vector<uint64_t> latency;  /**< per message, includes one clock_gettime */
+    uint64_t total;                 /**< untimed bursts */
+    size_t allocations;
+    uint64_t drain;
+};
+
+template<typename Log>
+static Result _run(size_t messages, size_t burst, Log log)
+{
+    Result result;
+    result.latency.reserve(messages);
+    result.total = 0;
+    result.allocations = 0;
+    result.drain = 0;
+
+    for (size_t done=0; done<messages; done+=burst) {
+        bool timed = (done / burst) & 1;
+        size_t allocations = _allocations.load();
+        uint64_t burst_start = monotonicNsec();
+        for (size_t i=0; i<burst; i++) {
+            if (timed) {
+                uint64_t start = monotonicNsec();
+                log(done + i);
+                result.latency.push_back(monotonicNsec() - start);
+            } else {
+                log(done + i);
+            }
+        }
+        if (!timed) {
+            result.total += monotonicNsec() - burst_start;
+        }
+        result.allocations += _allocations.load() - allocations;
+
+        uint64_t start = monotonicNsec();
+        Logger::flush();
+        result.drain += monotonicNsec() - start;
+    }
+    std::sort(result.latency.begin(), result.latency.end());
+    return result;
+}
+
+static void _report(const char *name, size_t messages, const Result &result)
+{
+    size_t n = result.latency.size();
+    Info() << name << "ns/message mean:" << (float)result.total / (messages - n)
+           << "p50:" << result.latency[n / 2]
+           << "p99:" << result.latency[n * 99 / 100]
+           << "allocations/message:" << (float)result.allocations / messages
+           << "flush ns/message:" << (float)result.drain / messages;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t messages = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    const size_t burst = 256;
+
+    // first message of a thread allocates its ring
+    Info() << "bench_log:" << messages << "messages, bursts of" << burst;
+    Logger::flush();
+
+    int null = open("/dev/null", O_WRONLY);
+    int saved = dup(STDERR_FILENO);
+    dup2(null, STDERR_FILENO);
+
+    Result legacy = _run(messages, burst, [](size_t i) {
+        LegacyWarn() << "FIFO overrun, samples lost:" << (unsigned int)i << "rate:" << 800.f;
+    });
+    Result binary = _run(messages, burst, [](size_t i) {
+        Warn() << "FIFO overrun, samples lost:" << (unsigned int)i << "rate:" << 800.f;
+    });
+    Result limited = _run(messages, burst, [](size_t i) {
+        WarnLimited(10) << "FIFO overrun, samples lost:" << (unsigned int)i << "rate:" << 800.f;
+    });
+    Logger::setLevel(MessageError);
+    Result filtered = _run(messages, burst, [](size_t i) {
+        Warn() << "FIFO overrun, samples lost:" << (unsigned int)i << "rate:" << 800.f;
+    });
+    Logger::setLevel(MessageDebug);
+
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    close(null);
+
+    _report("stringstream:", messages, legacy);
+    _report("binary ring: ", messages, binary);
+    _report("limited 10/s:", messages, limited);
+    _report("below level: ", messages, filtered);
+    Info() << "dropped:" << Logger::dropped();
+    return 0;
+}
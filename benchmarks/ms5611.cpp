@@ -0,0 +1,271 @@
+#include <ms5611.h>
+#include <poller.h>
+#include <timer.h>
+#include <simi2c.h>
+#include <simdevices.h>
+#include <log.h>
+#include <utils.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* MS5611 compensation and startup.
+ * Integer path is checked against datasheet example (C1..C6, D1, D2 -> 2007, 100009) and
+ * against values computed with arbitrary precision integers for second order cases.
+ * Legacy float path is a copy of the driver code before integer compensation.
+ * Startup is initialize() to onReady on SimI2C: cold (reset, PROM read and CRC check)
+ * and warm (PROM matches calibration cache).
+ * Continuous mode runs with injected bus errors and interrupted conversions,
+ * every sample after them must be compensated with a temperature conversion.
+ * Exit code is non zero on mismatch.
+ */
+
+static const uint16_t _coefficients[6] = {40127, 36924, 23317, 23282, 33464, 28312};
+
+static const struct {
+    uint32_t d1;
+    uint32_t d2;
+    int32_t temperature;
+    int32_t pressure;
+} _golden[] = {
+    {9085466, 8569150, 2007, 100009},   /* datasheet example */
+    {9085466, 9751948, 5999, 107686},   /* 60 C */
+    {7900000, 7974202, -163, 74125},    /* below 20 C */
+    {8500000, 7381620, -2654, 80648},   /* below -15 C */
+    {6000000, 6789038, -5471, 33838},
+    {10500000, 8000000, -62, 121897},
+    {4000000, 6500000, -6965, 2088},
+};
+
+static void _legacyCalculate(const uint16_t c[6], uint32_t raw_temperature, uint32_t raw_pressure,
+                             float &temperature, float &pressure)
+{
+    float dT = raw_temperature - c[4] * powf(2, 8);
+    temperature = (2000 + ((dT * c[5]) / powf(2, 23)));
+    float OFF = c[1] * powf(2, 16) + (c[3] * dT) / powf(2, 7);
+    float SENS = c[0] * powf(2, 15) + (c[2] * dT) / powf(2, 8);
+
+    float T2, OFF2, SENS2;
+
+    if (temperature >= 2000) {
+        T2 = 0;
+        OFF2 = 0;
+        SENS2 = 0;
+    } else {
+        T2 = dT * dT / powf(2, 31);
+        OFF2 = 5 * powf(temperature - 2000, 2) / 2;
+        SENS2 = OFF2 / 2;
+
+        if (temperature < -1500) {
+            OFF2 = OFF2 + 7 * powf(temperature + 1500, 2);
+            SENS2 = SENS2 + 11 * powf(temperature + 1500, 2) / 2;
+        }
+    }
+
+    temperature = temperature - T2;
+    OFF = OFF - OFF2;
+    SENS = SENS - SENS2;
+
+    pressure = ((raw_pressure * SENS) / powf(2, 21) - OFF) / powf(2, 15) / 100;
+    temperature = temperature / 100;
+}
+
+/** @return initialize() to onReady time in ns or 0 if device did not become ready. */
+static uint64_t _startup(const char *cache, bool &reset)
+{
+    Poller poller(64, false);
+    SimI2C bus;
+    bus.setTransferOverhead(50000);
+    SimMS5611 model;
+    bus.attach(&model);
+
+    MS5611 sensor(MS5611_I2C_ADDRESS, &bus, &poller);
+    uint64_t ready = 0;
+    sensor.onReady = [&]() {
+        ready = monotonicNsec();
+        poller.stop();
+    };
+    sensor.onError = [&]() { poller.stop(); };
+    sensor.setCalibrationCache(cache);
+
+    bus.resetStatistics();
+    uint64_t start = monotonicNsec();
+    if (sensor.initialize() < 0) {
+        return 0;
+    }
+    if (ready == 0) {
+        poller.loop();
+    }
+
+    uint64_t transfers, messages, bytes, errors, busy;
+    bus.getStatistics(transfers, messages, bytes, errors, busy);
+    // reset is the only single message write on this path
+    reset = messages > 16;
+    return ready != 0 ? ready - start : 0;
+}
+
+/** @return amount of wrongly compensated samples or -1 if sampling did not recover. */
+static int _continuousRecovery()
+{
+    Poller poller(64, false);
+    SimI2C bus;
+    SimMS5611 model;
+    bus.attach(&model);
+    model.setRaw(_golden[0].d1, _golden[0].d2);
+
+    MS5611 sensor(MS5611_I2C_ADDRESS, &bus, &poller);
+    int bad = 0;
+    unsigned samples = 0, faults = 0, recovered = 0;
+    sensor.onReady = [&]() {
+        if (sensor.startContinuous(100, 4) < 0) {
+            poller.stop();
+        }
+    };
+    sensor.onSamples = [&]() {
+        MS5611::Sample taken[MS5611::SampleCapacity];
+        size_t count = sensor.readSamples(taken, MS5611::SampleCapacity);
+        for (size_t i=0; i<count; i++) {
+            if (fabsf(taken[i].temperature - _golden[0].temperature / 100.0f) > 0.005f
+                    || fabsf(taken[i].pressure - _golden[0].pressure / 100.0f) > 0.005f) {
+                bad++;
+            }
+        }
+        samples += count;
+        recovered = faults;
+    };
+
+    // failed transaction whose command reached the device, then conversion cancelled by reset
+    Timer fault(&poller);
+    fault.onTimeout = [&]() {
+        if (faults % 2 == 0) {
+            bus.write(MS5611_I2C_ADDRESS, 0x40 | (MS5611_OVERSAMPLING_1024 << 1));
+            bus.failNext(1);
+        } else {
+            bus.write(MS5611_I2C_ADDRESS, 0x1E);
+        }
+        faults++;
+    };
+    fault.start(37);
+
+    Timer finish(&poller);
+    finish.onTimeout = [&]() { poller.stop(); };
+    finish.start(1500);
+
+    if (sensor.initialize() < 0) {
+        return -1;
+    }
+    poller.loop();
+    sensor.stopContinuous();
+
+    Info() << "continuous recovery faults:" << faults << "samples:" << samples << "wrong:" << bad;
+    return samples < 50 || recovered + 2 < faults ? -1 : bad;
+}
+
+int main()
+{
+    MS5611::Calibration calibration;
+    calibration.set(_coefficients);
+
+    int failures = 0;
+    float legacy_error = 0;
+    for (const auto &golden: _golden) {
+        int32_t temperature, pressure;
+        calibration.compensate(golden.d2, golden.d1, temperature, pressure);
+        if (temperature != golden.temperature || pressure != golden.pressure) {
+            Error() << "D1:" << golden.d1 << "D2:" << golden.d2
+                    << "got:" << temperature << pressure
+                    << "expected:" << golden.temperature << golden.pressure;
+            failures++;
+        }
+
+        float legacy_temperature, legacy_pressure;
+        _legacyCalculate(_coefficients, golden.d2, golden.d1, legacy_temperature, legacy_pressure);
+        float error = fabsf(legacy_pressure * 100 - golden.pressure);
+        if (error > legacy_error) {
+            legacy_error = error;
+        }
+    }
+    Info() << "golden vectors:" << (unsigned)(sizeof(_golden) / sizeof(_golden[0])) << "failed:" << failures
+           << "legacy float max pressure error, Pa:" << legacy_error;
+
+    // raw values sweep over normal operating range, both branches of second order compensation
+    const size_t samples = 1 << 12;
+    const size_t repeat = 200;
+    static uint32_t d1[samples], d2[samples];
+    srand(1);
+    for (size_t i=0; i<samples; i++) {
+        d1[i] = 6000000 + rand() % 4000000;
+        d2[i] = 7000000 + rand() % 2500000;
+    }
+
+    volatile float sink = 0;
+    uint64_t start = monotonicNsec();
+    for (size_t r=0; r<repeat; r++) {
+        for (size_t i=0; i<samples; i++) {
+            float temperature, pressure;
+            _legacyCalculate(_coefficients, d2[i], d1[i], temperature, pressure);
+            sink = sink + pressure;
+        }
+    }
+    uint64_t legacy = monotonicNsec() - start;
+
+    volatile int32_t integer_sink = 0;
+    start = monotonicNsec();
+    for (size_t r=0; r<repeat; r++) {
+        for (size_t i=0; i<samples; i++) {
+            int32_t temperature, pressure;
+            calibration.compensate(d2[i], d1[i], temperature, pressure);
+            integer_sink = integer_sink + pressure;
+        }
+    }
+    uint64_t integer = monotonicNsec() - start;
+
+    float count = samples * repeat;
+    Info() << "legacy float ns/sample:" << legacy / count
+           << "int64 ns/sample:" << integer / count
+           << "speedup:" << (float)legacy / integer;
+
+    char cache[] = "/tmp/bench_ms5611.XXXXXX";
+    if (mkdtemp(cache) == nullptr) {
+        Error() << "Unable to create cache directory";
+        return EXIT_FAILURE;
+    }
+    char cache_file[sizeof(cache) + 32];
+    snprintf(cache_file, sizeof(cache_file), "%s/ms5611-i2c-77", cache);
+
+    bool reset = false;
+    uint64_t cold = _startup(cache, reset);
+    if (cold == 0 || !reset) {
+        Error() << "Cold start failed";
+        failures++;
+    }
+    uint64_t warm = _startup(cache, reset);
+    if (warm == 0 || reset) {
+        Error() << "Warm start did not use calibration cache";
+        failures++;
+    }
+    Info() << "startup cold us:" << cold / 1000.f << "warm us:" << warm / 1000.f;
+
+    // valid cache of another unit must not be trusted
+    FILE *file = fopen(cache_file, "w");
+    if (file != nullptr) {
+        fprintf(file, "0000 9cc0 903c 5b15 5af2 82b8 6e98 000b\n");
+        fclose(file);
+    }
+    if (_startup(cache, reset) == 0 || !reset) {
+        Error() << "Mismatching calibration cache was not detected";
+        failures++;
+    }
+
+    unlink(cache_file);
+    rmdir(cache);
+
+    int wrong = _continuousRecovery();
+    if (wrong != 0) {
+        Error() << "Continuous mode did not recover from bus errors, wrong samples:" << wrong;
+        failures++;
+    }
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+#include <simi2c.h>
+#include <simdevices.h>
+#include <simgpio.h>
+#include <poller.h>
+#include <timer.h>
+#include <l3gd20h.h>
+#include <ms5611.h>
+#include <bmp180.h>
+#include <ads1115.h>
+#include <pca9685.h>
+#include <ssd1306.h>
+#include <vz89.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+/* Hardware-free driver benchmark.
+ * Every driver runs at its maximum rate against a device model on SimI2C at 400 kHz.
+ * Reported per driver:
+ *  rate       - samples or operations per second
+ *  latency    - sample age at callback for streaming sensors, request to result otherwise
+ *  transfers  - readWrite() calls (ioctls on real hardware) per sample
+ *  bytes      - bus bytes per sample
+ *  bus        - bus utilisation
+ */
+
+class Bench
+{
+public:
+    SimI2C bus;
+    Poller poller;
+    std::vector<uint64_t> latency;
+
+    Bench(): bus(), poller(1024, false), latency(), _start(0), _deadline(0)
+    {
+        latency.reserve(100000);
+    }
+
+    void run(int seconds)
+    {
+        Timer finish(&poller);
+        finish.onTimeout = [this]() { poller.stop(); };
+        finish.start(seconds * 1000);
+
+        bus.resetStatistics();
+        latency.clear();
+        _start = monotonicNsec();
+        _deadline = _start + seconds * 1000000000ull;
+        poller.loop();
+    }
+
+    /** Run operation back to back through poller tasks.
+     * Poller drains a whole batch of tasks before timers, so slow operations check the deadline themselves.
+     */
+    void repeat(std::function<void()> operation)
+    {
+        poller.post([this, operation]() {
+            if (monotonicNsec() >= _deadline) {
+                poller.stop();
+                return;
+            }
+            operation();
+            repeat(operation);
+        });
+    }
+
+    void report(const char *name)
+    {
+        uint64_t elapsed = monotonicNsec() - _start;
+        uint64_t transfers, messages, bytes, errors, busy;
+        bus.getStatistics(transfers, messages, bytes, errors, busy);
+
+        size_t n = latency.size();
+        if (n == 0) {
+            Error() << name << "no samples";
+            return;
+        }
+        std::sort(latency.begin(), latency.end());
+        Info() << name << "rate/s:" << n * 1e9f / elapsed
+               << "latency us p50:" << latency[n / 2] / 1000.f
+               << "p99:" << latency[n * 99 / 100] / 1000.f
+               << "transfers:" << (float)transfers / n
+               << "bytes:" << (float)bytes / n
+               << "bus:" << (float)busy / elapsed;
+    }
+
+private:
+    uint64_t _start;
+    uint64_t _deadline;
+};
+
+static void _l3gd20h(int seconds)
+{
+    Bench bench;
+    SimL3GD20H model;
+    bench.bus.attach(&model);
+
+    L3GD20H sensor(L3GD20H_DEFAULT_ADDRESS, &bench.bus, &bench.poller);
+    sensor.onData = [&](float, float, float) {
+        bench.latency.push_back(monotonicNsec() - model.lastSampleTime());
+    };
+    if (sensor.initialize() < 0 || sensor.start(L3GD20H_RATE_OCTA) < 0) {
+        Error() << "Unable to start L3GD20H";
+        return;
+    }
+    bench.run(seconds);
+    sensor.stop();
+    bench.report("L3GD20H 800 Hz FIFO:");
+}
+
+static void _l3gd20hInterrupt(int seconds)
+{
+    Bench bench;
+    SimL3GD20H model;
+    SimGPIO int2(&bench.poller);
+    model.setInterrupt(&int2);
+    bench.bus.attach(&model);
+
+    L3GD20H sensor(L3GD20H_DEFAULT_ADDRESS, &bench.bus, &bench.poller);
+    sensor.onData = [&](float, float, float) {
+        bench.latency.push_back(monotonicNsec() - model.lastSampleTime());
+    };
+    if (sensor.initialize() < 0 || sensor.setInterrupt(&int2, 16) < 0 || sensor.start(L3GD20H_RATE_OCTA) < 0) {
+        Error() << "Unable to start L3GD20H";
+        return;
+    }
+    bench.run(seconds);
+    sensor.stop();
+    bench.report("L3GD20H 800 Hz INT2:");
+}
+
+static void _ms5611(int seconds)
+{
+    Bench bench;
+    SimMS5611 model;
+    bench.bus.attach(&model);
+
+    MS5611 sensor(MS5611_I2C_ADDRESS, &bench.bus, &bench.poller);
+    uint64_t request = 0;
+    auto next = [&]() {
+        request = monotonicNsec();
+        sensor.getTemperatureAndPressure();
+    };
+    sensor.onTemperatureAndPressure = [&](float, float) {
+        bench.latency.push_back(monotonicNsec() - request);
+        bench.poller.post(next);
+    };
+    sensor.setOversampling(MS5611_OVERSAMPLING_256);
+    sensor.onReady = next;
+    if (sensor.initialize() < 0) {
+        Error() << "Unable to initialize MS5611";
+        return;
+    }
+    bench.run(seconds);
+    bench.report("MS5611 OSR 256:     ");
+}
+
+static void _ms5611Continuous(int seconds, uint8_t oversampling, const char *name)
+{
+    Bench bench;
+    SimMS5611 model;
+    bench.bus.attach(&model);
+
+    MS5611 sensor(MS5611_I2C_ADDRESS, &bench.bus, &bench.poller);
+    sensor.onSamples = [&]() {
+        MS5611::Sample samples[MS5611::SampleCapacity];
+        size_t count = sensor.readSamples(samples, MS5611::SampleCapacity);
+        uint64_t now = monotonicNsec();
+        for (size_t i=0; i<count; i++) {
+            bench.latency.push_back(now - samples[i].timestamp);
+        }
+    };
+    sensor.setOversampling(oversampling);
+    sensor.onReady = [&]() {
+        sensor.startContinuous(MS5611::maximumRate(oversampling, 16), 16);
+    };
+    if (sensor.initialize() < 0) {
+        Error() << "Unable to initialize MS5611";
+        return;
+    }
+    bench.run(seconds);
+    bench.report(name);
+}
+
+static void _bmp180(int seconds)
+{
+    Bench bench;
+    SimBMP180 model;
+    bench.bus.attach(&model);
+
+    BMP180 sensor(BMP180_I2C_DEFAULT_ADDR, &bench.bus, &bench.poller);
+    uint64_t request = 0;
+    auto next = [&]() {
+        request = monotonicNsec();
+        sensor.getTemperatureAndPressure();
+    };
+    sensor.onTemperatureAndPressure = [&](float, float) {
+        bench.latency.push_back(monotonicNsec() - request);
+        bench.poller.post(next);
+    };
+    if (sensor.initialize() < 0) {
+        Error() << "Unable to initialize BMP180";
+        return;
+    }
+    next();
+    bench.run(seconds);
+    bench.report("BMP180:             ");
+}
+
+static void _ads1115(int seconds)
+{
+    Bench bench;
+    SimADS1115 model;
+    model.setInput(0, 1.5f);
+    bench.bus.attach(&model);
+
+    ADS1115 adc(ADS1115_I2C_ADDRESS, &bench.bus, &bench.poller);
+    adc.onData = [&](float) {
+        bench.latency.push_back(monotonicNsec() - model.lastConversionTime());
+    };
+    if (adc.initialize() < 0 || adc.startSampling(ADS1115::MS0G, ADS1115::G4096, ADS1115::SR860, false) < 0) {
+        Error() << "Unable to start ADS1115";
+        return;
+    }
+    bench.run(seconds);
+    adc.stopSampling();
+    bench.report("ADS1115 860 SPS:    ");
+}
+
+static void _pca9685(int seconds)
+{
+    Bench bench;
+    SimPCA9685 model;
+    bench.bus.attach(&model);
+
+    PCA9685 pwm(PCA9685_I2C_DEFAULT_ADDR, &bench.bus);
+    if (pwm.initialize() < 0 || pwm.setFrequency(50) < 0) {
+        Error() << "Unable to initialize PCA9685";
+        return;
+    }
+    uint8_t channel = 0;
+    bench.repeat([&]() {
+        uint64_t start = monotonicNsec();
+        pwm.setPWMuS(channel, 1000 + channel * 50);
+        channel = (channel + 1) % 16;
+        bench.latency.push_back(monotonicNsec() - start);
+    });
+    bench.run(seconds);
+    bench.report("PCA9685 setPWM:     ");
+}
+
+static void _ssd1306(int seconds)
+{
+    Bench bench;
+    SimSSD1306 model;
+    bench.bus.attach(&model);
+
+    SSD1306 display(SSD1306_I2C_ADDRESS, &bench.bus, false);
+    if (display.initialize() < 0) {
+        Error() << "Unable to initialize SSD1306";
+        return;
+    }
+    uint8_t frame = 0;
+    bench.repeat([&]() {
+        uint64_t start = monotonicNsec();
+        display.clear();
+        display.drawText(0, 0, "navio_bench");
+        display.drawLine(0, frame % 64, 127, 63 - frame % 64);
+        display.commit();
+        frame++;
+        bench.latency.push_back(monotonicNsec() - start);
+    });
+    bench.run(seconds);
+    bench.report("SSD1306 frame:      ");
+}
+
+static void _vz89(int seconds)
+{
+    Bench bench;
+    SimVZ89 model;
+    model.setStatus(800, 40, 150);
+    bench.bus.attach(&model);
+
+    VZ89 sensor(VZ89_I2C_ADDRESS, &bench.bus);
+    bench.repeat([&]() {
+        float co2, tvoc;
+        uint8_t reactivity;
+        uint64_t start = monotonicNsec();
+        sensor.getStatus(co2, reactivity, tvoc);
+        bench.latency.push_back(monotonicNsec() - start);
+    });
+    bench.run(seconds);
+    bench.report("VZ89 status:        ");
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    _l3gd20h(seconds);
+    _l3gd20hInterrupt(seconds);
+    _ms5611(seconds);
+    _ms5611Continuous(seconds, MS5611_OVERSAMPLING_256, "MS5611 OSR 256 cont:");
+    _ms5611Continuous(seconds, MS5611_OVERSAMPLING_4096, "MS5611 OSR 4096 cont:");
+    _bmp180(seconds);
+    _ads1115(seconds);
+    _pca9685(seconds);
+    _ssd1306(seconds);
+    _vz89(seconds);
+    return 0;
+}
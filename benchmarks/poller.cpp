@@ -0,0 +1,144 @@
+#include <poller.h>
+#include <descriptor.h>
+#include <log.h>
+#include <utils.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <map>
+#include <vector>
+
+/* Poller dispatch benchmark.
+ * Registers N always readable eventfds and measures cost of one loop
+ * iteration per dispatched event for the legacy std::map based dispatch
+ * and for the fd indexed slot table used by Poller.
+ */
+
+class Counter: public Descriptor
+{
+public:
+    Counter(Poller *event_poller, uint64_t *budget):
+        Descriptor(event_poller), _budget(budget)
+    {
+        _descriptor = eventfd(1, EFD_NONBLOCK);
+        _registerRead();
+    }
+
+    virtual ~Counter()
+    {
+        _unregisterRead();
+        close(_descriptor);
+    }
+
+    virtual const char* name() { return "Counter"; }
+    int fd() { return _descriptor; }
+
+    // eventfd is never drained, so it stays readable for level triggered epoll.
+    virtual void _onRead()
+    {
+        if (--(*_budget) == 0) {
+            _ep->stop();
+        }
+    }
+    virtual void _onWrite() {}
+
+private:
+    uint64_t *_budget;
+};
+
+/* Copy of the original map based loop, kept here as a reference point. */
+static void legacyLoop(int epoll_fd, std::map<int, Counter*> &read_pool, uint64_t &budget)
+{
+    timespec a_mono_time, b_mono_time, c_mono_time, a_cpu_time, b_cpu_time, c_cpu_time;
+    epoll_event events[16];
+    float epoll_mono = 0, callback_mono = 0;
+
+    while (budget > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &a_mono_time);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &a_cpu_time);
+        int count = epoll_wait(epoll_fd, events, 16, -1);
+        clock_gettime(CLOCK_MONOTONIC, &b_mono_time);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &b_cpu_time);
+        for (int i=0; i<count && budget > 0; i++) {
+            budget--;
+            read_pool[events[i].data.fd]->name();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &c_mono_time);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c_cpu_time);
+        epoll_mono += (b_mono_time.tv_sec - a_mono_time.tv_sec) * 1000.f + (b_mono_time.tv_nsec - a_mono_time.tv_nsec) / 1e6f;
+        callback_mono += (c_mono_time.tv_sec - b_mono_time.tv_sec) * 1000.f + (c_mono_time.tv_nsec - b_mono_time.tv_nsec) / 1e6f;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const uint64_t events_total = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000000;
+    const size_t sizes[] = { 16, 128, 1024 };
+
+    Info() << "Dispatching" << events_total << "events per run";
+
+    for (size_t n : sizes) {
+        Poller poller;
+        uint64_t budget = 0;
+        std::vector<Counter*> counters;
+        for (size_t i=0; i<n; i++) {
+            counters.push_back(new Counter(&poller, &budget));
+        }
+
+        // legacy: same fds in a separate epoll instance with map lookup
+        int epoll_fd = epoll_create(1);
+        std::map<int, Counter*> read_pool;
+        for (Counter *c: counters) {
+            epoll_event e;
+            e.events = EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP;
+            e.data.fd = c->fd();
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd(), &e);
+            read_pool[c->fd()] = c;
+        }
+
+        budget = events_total;
+        uint64_t start = monotonicNsec();
+        legacyLoop(epoll_fd, read_pool, budget);
+        double legacy_ns = (double)(monotonicNsec() - start) / events_total;
+
+        budget = events_total;
+        start = monotonicNsec();
+        poller.loop();
+        double slot_ns = (double)(monotonicNsec() - start) / events_total;
+
+        Info() << "descriptors:" << (unsigned long)n
+               << "map:" << legacy_ns << "ns/event"
+               << "slot table:" << slot_ns << "ns/event";
+
+        // batch drain: bigger event array, budget and busy polling
+        const size_t capacities[] = { 16, 256 };
+        for (size_t capacity : capacities) {
+            float epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls, events;
+            poller.setEventCapacity(capacity);
+            poller.setBusyPoll(capacity > 16 ? 50 : 0);
+            poller.getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls, events);
+
+            budget = events_total;
+            start = monotonicNsec();
+            poller.loop();
+            double batch_ns = (double)(monotonicNsec() - start) / events_total;
+
+            poller.getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls, events);
+            Info() << "    capacity:" << (unsigned long)capacity << "busy poll:" << (capacity > 16)
+                   << batch_ns << "ns/event"
+                   << "syscalls/iteration:" << syscalls << "events/wakeup:" << events;
+        }
+        poller.setEventCapacity(16);
+        poller.setBusyPoll(0);
+
+        close(epoll_fd);
+        for (Counter *c: counters) {
+            delete c;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <poller.h>
+#include <timer.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/* Cross thread task injection benchmark.
+ * 1..8 producer threads post timestamped tasks into one Poller,
+ * consumer records post-to-execute latency.
+ * Saturated run shows throughput, paced run (producers sleep 20us between posts)
+ * shows latency without queueing delay.
+ */
+
+struct Sample {
+    uint64_t posted;
+    std::vector<uint64_t> *latencies;
+};
+
+static void _fixedTask(void *argument)
+{
+    Sample *sample = static_cast<Sample*>(argument);
+    sample->latencies->push_back(monotonicNsec() - sample->posted);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t tasks_per_producer = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+
+    for (int run=0; run<4; run++) {
+        bool fixed = run & 1;
+        uint64_t pace = run & 2 ? 20000 : 0;
+        for (size_t producers=1; producers<=8; producers*=2) {
+            Poller poller(4096);
+            std::vector<uint64_t> latencies;
+            latencies.reserve(producers * tasks_per_producer);
+            std::vector<Sample> samples(producers * tasks_per_producer);
+            std::atomic<size_t> done(0);
+            size_t rejected = 0;
+
+            std::vector<std::thread> threads;
+            for (size_t p=0; p<producers; p++) {
+                threads.push_back(std::thread([&, p]() {
+                    size_t local_rejected = 0;
+                    for (size_t i=0; i<tasks_per_producer; i++) {
+                        Sample *sample = &samples[p * tasks_per_producer + i];
+                        sample->latencies = &latencies;
+                        for (;;) {
+                            sample->posted = monotonicNsec();
+                            int ret;
+                            if (fixed) {
+                                ret = poller.postFixed(_fixedTask, sample);
+                            } else {
+                                ret = poller.post([sample]() { _fixedTask(sample); });
+                            }
+                            if (ret == 0) break;
+                            local_rejected++;
+                            std::this_thread::yield();
+                        }
+                        if (pace) {
+                            std::this_thread::sleep_for(std::chrono::nanoseconds(pace));
+                        }
+                    }
+                    if (++done == producers) {
+                        poller.post([&poller]() { poller.stop(); });
+                    }
+                    __atomic_add_fetch(&rejected, local_rejected, __ATOMIC_RELAXED);
+                }));
+            }
+
+            uint64_t start = monotonicNsec();
+            poller.loop();
+            uint64_t elapsed = monotonicNsec() - start;
+            for (auto &t: threads) {
+                t.join();
+            }
+
+            std::sort(latencies.begin(), latencies.end());
+            size_t n = latencies.size();
+            Info() << (fixed ? "postFixed" : "post") << (pace ? "paced" : "saturated") << "producers:" << (unsigned long)producers
+                   << "tasks/s:" << (float)(n * 1e9 / elapsed)
+                   << "latency ns p50:" << (unsigned long long)latencies[n / 2]
+                   << "p99:" << (unsigned long long)latencies[n * 99 / 100]
+                   << "max:" << (unsigned long long)latencies[n - 1]
+                   << "queue full retries:" << (unsigned long)rejected;
+        }
+    }
+
+    return 0;
+}
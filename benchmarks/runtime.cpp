@@ -0,0 +1,77 @@
+#include <runtime.h>
+#include <poller.h>
+#include <timer.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+/* Single loop vs split loop jitter benchmark.
+ * Same timer set is used in both runs: 1 kHz "gyro" timer which only records
+ * its wakeup time and several slow timers which burn cpu like display
+ * rendering or blocking bus transfers do.
+ * In split mode slow timers live in a separate low priority loop.
+ */
+
+static void _burn(uint64_t nsec)
+{
+    uint64_t end = monotonicNsec() + nsec;
+    while (monotonicNsec() < end);
+}
+
+static void _run(bool split, int seconds)
+{
+    Runtime runtime;
+    Poller *fast = runtime.addLoop(split ? 1 % sysconf(_SC_NPROCESSORS_ONLN) : -1, 50, "fast");
+    Poller *slow = split ? runtime.addLoop(-1, 10, "slow") : fast;
+
+    std::vector<uint64_t> wakeups;
+    wakeups.reserve(seconds * 1000 + 100);
+
+    Timer gyro(fast);
+    gyro.onTimeout = [&]() {
+        wakeups.push_back(monotonicNsec());
+    };
+    gyro.start(1);
+
+    Timer display(slow), adc(slow), baro(slow);
+    display.onTimeout = [&]() { _burn(8000000); };
+    adc.onTimeout = [&]() { _burn(300000); };
+    baro.onTimeout = [&]() { _burn(500000); };
+    display.start(100);
+    adc.start(10);
+    baro.start(20);
+
+    runtime.start();
+    sleep(seconds);
+    runtime.stop();
+
+    gyro.stop(); display.stop(); adc.stop(); baro.stop();
+
+    std::vector<uint64_t> jitter;
+    for (size_t i=1; i<wakeups.size(); i++) {
+        int64_t delta = wakeups[i] - wakeups[i-1] - 1000000;
+        jitter.push_back(delta < 0 ? -delta : delta);
+    }
+    std::sort(jitter.begin(), jitter.end());
+    size_t n = jitter.size();
+    if (n == 0) {
+        Error() << "No samples";
+        return;
+    }
+    Info() << (split ? "split loops: " : "single loop:") << "samples" << (unsigned long)n
+           << "jitter us p50:" << jitter[n / 2] / 1000.f
+           << "p99:" << jitter[n * 99 / 100] / 1000.f
+           << "max:" << jitter[n - 1] / 1000.f;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    _run(false, seconds);
+    _run(true, seconds);
+    return 0;
+}
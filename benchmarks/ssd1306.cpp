@@ -0,0 +1,328 @@
+#include <simi2c.h>
+#include <simdevices.h>
+#include <ssd1306.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+
+/* Bytes on the bus per SSD1306 frame for typical screens, full frame commit vs changed rectangles.
+ * Both displays redraw the same screens from scratch, full one is invalidated before every commit.
+ * Adapter is simulated with SimI2C at 400 kHz and 50 us per transfer overhead,
+ * display memory of both models is compared after every frame.
+ *
+ * Drawing primitives are checked against per pixel references in all colour modes,
+ * then a status dashboard is drawn with both to compare drawing time.
+ */
+
+typedef std::function<void(SSD1306&, int)> Screen;
+
+struct Result {
+    float bytes;
+    float messages;
+    float us;
+};
+
+static void _frame(SSD1306 &display, SimI2C &bus, const Screen &screen, int frame, bool full, Result &result)
+{
+    bus.resetStatistics();
+    uint64_t start = monotonicNsec();
+    screen(display, frame);
+    if (full) {
+        display.invalidate();
+    }
+    display.commit();
+    result.us += (monotonicNsec() - start) / 1000.f;
+
+    uint64_t transfers, messages, bytes, errors, busy;
+    bus.getStatistics(transfers, messages, bytes, errors, busy);
+    result.bytes += bytes;
+    result.messages += messages;
+}
+
+static void _telemetry(SSD1306 &display, int frame)
+{
+    char line[32];
+    display.clear();
+    display.drawText(0, 0, "NAVIO2  GPS 3D", COLOR_WHITE, FONT_TERMINUS_v12n);
+    snprintf(line, sizeof(line), "ALT %6.1f m", 120.0f + (frame % 50) * 0.1f);
+    display.drawText(0, 16, line, COLOR_WHITE, FONT_TERMINUS_v12n);
+    snprintf(line, sizeof(line), "BAT %5.2f V", 12.60f - (frame / 10) * 0.01f);
+    display.drawText(0, 28, line, COLOR_WHITE, FONT_TERMINUS_v12n);
+    display.drawLine(0, 42, 127, 42);
+    snprintf(line, sizeof(line), "%02d:%02d:%02d", 12, (frame / 60) % 60, frame % 60);
+    display.drawText(0, 46, line, COLOR_WHITE, FONT_TERMINUS_v16n);
+}
+
+static void _clock(SSD1306 &display, int frame)
+{
+    char line[32];
+    snprintf(line, sizeof(line), "%02d:%02d:%02d", 12, (frame / 60) % 60, frame % 60);
+    display.clear();
+    display.drawText(8, 16, line, COLOR_WHITE, FONT_TERMINUS_v28n);
+}
+
+static void _static(SSD1306 &display, int)
+{
+    display.clear();
+    display.drawText(0, 0, "Navio2\nwaiting for GPS", COLOR_WHITE, FONT_TERMINUS_v16n);
+}
+
+static void _scope(SSD1306 &display, int frame)
+{
+    display.clear();
+    display.drawLine(0, frame % 64, 127, 63 - frame % 64);
+}
+
+/** Per pixel references for drawing primitives, bounds are checked to avoid out of canvas warnings. */
+static void _pixel(SSD1306 &display, int x, int y, uint8_t color)
+{
+    if (x >= 0 && y >= 0 && x < 128 && y < 64) {
+        display.drawPixel(x, y, color);
+    }
+}
+
+static void _pixelLine(SSD1306 &display, int x1, int y1, int x2, int y2, uint8_t color)
+{
+    int dx = abs(x2 - x1), dy = -abs(y2 - y1);
+    int step_x = x1 < x2 ? 1 : -1, step_y = y1 < y2 ? 1 : -1;
+    int error = dx + dy;
+    for (;;) {
+        _pixel(display, x1, y1, color);
+        if (x1 == x2 && y1 == y2) {
+            break;
+        }
+        int error2 = 2 * error;
+        if (error2 >= dy) { error += dy; x1 += step_x; }
+        if (error2 <= dx) { error += dx; y1 += step_y; }
+    }
+}
+
+static void _pixelFillRect(SSD1306 &display, int x, int y, int width, int height, uint8_t color)
+{
+    for (int row=y; row<y+height; row++) {
+        for (int column=x; column<x+width; column++) {
+            _pixel(display, column, row, color);
+        }
+    }
+}
+
+static void _pixelRect(SSD1306 &display, int x, int y, int width, int height, uint8_t color)
+{
+    for (int column=x; column<x+width; column++) {
+        _pixel(display, column, y, color);
+        if (height > 1) _pixel(display, column, y + height - 1, color);
+    }
+    for (int row=y+1; row<y+height-1; row++) {
+        _pixel(display, x, row, color);
+        if (width > 1) _pixel(display, x + width - 1, row, color);
+    }
+}
+
+static void _pixelBitmap(SSD1306 &display, int x, int y, const uint8_t *bitmap, int width, int height, uint8_t color)
+{
+    for (int row=0; row<height; row++) {
+        for (int column=0; column<width; column++) {
+            if (bitmap[(row / 8) * width + column] & (1 << (row % 8))) {
+                _pixel(display, x + column, y + row, color);
+            }
+        }
+    }
+}
+
+/** 16x8 battery icon, display memory layout. */
+static const uint8_t _battery[] = {
+    0xFF, 0x81, 0xBD, 0xBD, 0xBD, 0xBD, 0xBD, 0xBD, 0x81, 0x81, 0x81, 0x81, 0x81, 0xFF, 0x3C, 0x3C
+};
+
+/** 12x12 satellite icon, display memory layout. */
+static const uint8_t _satellite[] = {
+    0x00, 0x86, 0xCF, 0xEF, 0x7E, 0x3C, 0x3C, 0x7E, 0xF7, 0xF3, 0x61, 0x00,
+    0x00, 0x01, 0x03, 0x07, 0x0E, 0x0C, 0x0C, 0x0E, 0x07, 0x03, 0x01, 0x00
+};
+
+struct Shapes {
+    std::function<void(SSD1306&, int, int, int, int, uint8_t)> line;
+    std::function<void(SSD1306&, int, int, int, int, uint8_t)> rect;
+    std::function<void(SSD1306&, int, int, int, int, uint8_t)> fill;
+    std::function<void(SSD1306&, int, int, const uint8_t*, int, int, uint8_t)> bitmap;
+};
+
+static const Shapes _spanShapes = {
+    [](SSD1306 &d, int x1, int y1, int x2, int y2, uint8_t c) { d.drawLine(x1, y1, x2, y2, c); },
+    [](SSD1306 &d, int x, int y, int w, int h, uint8_t c) { d.drawRect(x, y, w, h, c); },
+    [](SSD1306 &d, int x, int y, int w, int h, uint8_t c) { d.fillRect(x, y, w, h, c); },
+    [](SSD1306 &d, int x, int y, const uint8_t *b, int w, int h, uint8_t c) { d.drawBitmap(x, y, b, w, h, c); },
+};
+
+static const Shapes _pixelShapes = {
+    _pixelLine, _pixelRect, _pixelFillRect, _pixelBitmap
+};
+
+/** Every primitive in every octant and alignment, partly outside of canvas. */
+static void _testPattern(SSD1306 &display, const Shapes &shapes, uint8_t color)
+{
+    for (int i=0; i<64; i+=7) {
+        shapes.line(display, 64, 32, i * 2, 0, color);
+        shapes.line(display, 64, 32, 127, i, color);
+        shapes.line(display, 64, 32, 127 - i * 2, 63, color);
+        shapes.line(display, 64, 32, 0, 63 - i, color);
+    }
+    shapes.line(display, 3, 5, 3, 60, color);
+    shapes.line(display, 120, 7, 5, 7, color);
+    shapes.line(display, 100, 50, 200, 70, color);
+    shapes.fill(display, 5, 3, 30, 17, color);
+    shapes.fill(display, 40, 8, 8, 8, color);
+    shapes.fill(display, 120, 60, 20, 20, color);
+    shapes.rect(display, 2, 2, 124, 60, color);
+    shapes.rect(display, 50, 21, 1, 9, color);
+    shapes.rect(display, 70, 41, 13, 2, color);
+    shapes.bitmap(display, 90, 13, _battery, 16, 8, color);
+    shapes.bitmap(display, -3, -5, _satellite, 12, 12, color);
+    shapes.bitmap(display, 122, 59, _satellite, 12, 12, color);
+    shapes.bitmap(display, 30, 44, _satellite, 12, 11, color);
+}
+
+static void _dashboard(SSD1306 &display, const Shapes &shapes, int frame)
+{
+    char line[32];
+    display.clear();
+    shapes.rect(display, 0, 0, 128, 64, COLOR_WHITE);
+    shapes.fill(display, 1, 1, 126, 13, COLOR_WHITE);
+    display.drawText(3, 1, "ARMED", COLOR_BLACK, FONT_TERMINUS_v12n);
+    shapes.bitmap(display, 108, 3, _battery, 16, 8, COLOR_INVERT);
+    shapes.bitmap(display, 92, 1, _satellite, 12, 12, COLOR_INVERT);
+
+    // throttle bars
+    for (int i=0; i<4; i++) {
+        int level = (frame * (i + 3)) % 40;
+        shapes.rect(display, 4 + i * 9, 18, 7, 42, COLOR_WHITE);
+        shapes.fill(display, 5 + i * 9, 59 - level, 5, level, COLOR_WHITE);
+    }
+
+    // altitude history
+    shapes.rect(display, 42, 18, 82, 30, COLOR_WHITE);
+    int previous = 0;
+    for (int i=0; i<16; i++) {
+        int value = 20 + ((frame + i * 5) * 7) % 25;
+        if (i > 0) {
+            shapes.line(display, 43 + (i - 1) * 5, 18 + previous, 43 + i * 5, 18 + value, COLOR_WHITE);
+        }
+        previous = value;
+    }
+
+    snprintf(line, sizeof(line), "ALT %5.1f", 120.0f + (frame % 50) * 0.1f);
+    display.drawText(42, 50, line, COLOR_WHITE, FONT_TERMINUS_v12n);
+}
+
+static int _primitives(int frames)
+{
+    SimI2C pixel_bus, span_bus;
+    SimSSD1306 pixel_model, span_model;
+    pixel_bus.attach(&pixel_model);
+    span_bus.attach(&span_model);
+    SSD1306 pixel(SSD1306_I2C_ADDRESS, &pixel_bus, false);
+    SSD1306 span(SSD1306_I2C_ADDRESS, &span_bus, false);
+
+    int status = EXIT_SUCCESS;
+    static const uint8_t colors[] = {COLOR_WHITE, COLOR_INVERT, COLOR_BLACK};
+    for (uint8_t color: colors) {
+        // striped background, so black and invert have something to change
+        for (SSD1306 *display: {&pixel, &span}) {
+            display->clear();
+            for (int x=0; x<128; x+=3) {
+                _pixelLine(*display, x, 0, x, 63, COLOR_WHITE);
+            }
+        }
+        _testPattern(pixel, _pixelShapes, color);
+        _testPattern(span, _spanShapes, color);
+        pixel.commit();
+        span.commit();
+        if (memcmp(pixel_model.ram(), span_model.ram(), 128 * 8) != 0) {
+            Error() << "Drawing primitives differ from per pixel reference, color" << color;
+            status = EXIT_FAILURE;
+        }
+    }
+
+    uint64_t pixel_time = 0, span_time = 0;
+    for (int frame=0; frame<frames; frame++) {
+        uint64_t start = monotonicNsec();
+        _dashboard(pixel, _pixelShapes, frame);
+        pixel_time += monotonicNsec() - start;
+
+        start = monotonicNsec();
+        _dashboard(span, _spanShapes, frame);
+        span_time += monotonicNsec() - start;
+
+        pixel.commit();
+        span.commit();
+        if (memcmp(pixel_model.ram(), span_model.ram(), 128 * 8) != 0) {
+            Error() << "Dashboard differs from per pixel reference at frame" << frame;
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+    Info() << "dashboard per pixel us/frame:" << pixel_time / 1000.f / frames
+           << "spans us/frame:" << span_time / 1000.f / frames
+           << "speedup:" << (float)pixel_time / span_time;
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+
+    SimI2C full_bus, changed_bus;
+    full_bus.setTransferOverhead(50000);
+    changed_bus.setTransferOverhead(50000);
+    SimSSD1306 full_model, changed_model;
+    full_bus.attach(&full_model);
+    changed_bus.attach(&changed_model);
+
+    SSD1306 full(SSD1306_I2C_ADDRESS, &full_bus, false);
+    SSD1306 changed(SSD1306_I2C_ADDRESS, &changed_bus, false);
+    if (full.initialize() < 0 || changed.initialize() < 0) {
+        Error() << "Unable to initialize SSD1306";
+        return EXIT_FAILURE;
+    }
+
+    struct {
+        const char *name;
+        Screen screen;
+    } screens[] = {
+        {"telemetry:", _telemetry},
+        {"clock:    ", _clock},
+        {"static:   ", _static},
+        {"scope:    ", _scope},
+    };
+
+    int status = EXIT_SUCCESS;
+    for (auto &screen: screens) {
+        Result full_result{0, 0, 0}, changed_result{0, 0, 0};
+        for (int frame=0; frame<frames; frame++) {
+            _frame(full, full_bus, screen.screen, frame, true, full_result);
+            _frame(changed, changed_bus, screen.screen, frame, false, changed_result);
+            if (memcmp(full_model.ram(), changed_model.ram(), 128 * 8) != 0) {
+                Error() << screen.name << "display memory differs at frame" << frame;
+                status = EXIT_FAILURE;
+                break;
+            }
+        }
+        Info() << screen.name << "full bytes/frame:" << full_result.bytes / frames
+               << "messages/frame:" << full_result.messages / frames
+               << "us/frame:" << full_result.us / frames;
+        Info() << screen.name << "changed bytes/frame:" << changed_result.bytes / frames
+               << "messages/frame:" << changed_result.messages / frames
+               << "us/frame:" << changed_result.us / frames
+               << "bus saved:" << 100.f - changed_result.bytes * 100.f / full_result.bytes << "%";
+    }
+
+    if (_primitives(frames) != EXIT_SUCCESS) {
+        status = EXIT_FAILURE;
+    }
+
+    return status;
+}
@@ -0,0 +1,194 @@
+#include <poller.h>
+#include <timer.h>
+#include <simi2c.h>
+#include <simdevices.h>
+#include <l3gd20h.h>
+#include <ms5611.h>
+#include <bmp180.h>
+#include <ads1115.h>
+#include <pca9685.h>
+#include <ssd1306.h>
+#include <startup.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <functional>
+#include <vector>
+
+/* Sensor set bring-up time on one poller.
+ * All Navio drivers are initialized on SimI2C at 400 kHz with 50 us per transfer overhead,
+ * first one after another, then all at once with initializeAsync().
+ * Device waits (MS5611 reset, L3GD20H boot, BMP180 start-up) overlap in the concurrent case.
+ * Orchestrated case runs the same set through Startup with bus -> device -> start dependencies,
+ * synchronous displays and PWM setup on its thread pool, and reports time to first gyro and
+ * barometer samples.
+ */
+
+typedef std::function<int(std::function<void(int)>)> Step;
+
+class SensorSet
+{
+public:
+    SensorSet(): poller(64, false), gyro(0x6B, &bus, &poller), baro(MS5611_I2C_ADDRESS, &bus, &poller),
+        bmp(0x76, &bus, &poller), adc(ADS1115_I2C_ADDRESS, &bus, &poller),
+        pwm(0x40, &bus), display(SSD1306_I2C_ADDRESS, &bus, false), bmp_model(0x76)
+    {
+        bus.setTransferOverhead(50000);
+        bus.attach(&gyro_model);
+        bus.attach(&baro_model);
+        bus.attach(&bmp_model);
+        bus.attach(&adc_model);
+        bus.attach(&pwm_model);
+        bus.attach(&display_model);
+
+        steps.push_back([this](std::function<void(int)> done) { return gyro.initializeAsync(done); });
+        steps.push_back([this](std::function<void(int)> done) { return baro.initializeAsync(done); });
+        steps.push_back([this](std::function<void(int)> done) { return bmp.initializeAsync(done); });
+        steps.push_back([this](std::function<void(int)> done) { return adc.initializeAsync(done); });
+        // no waits and no poller, these are synchronous
+        steps.push_back([this](std::function<void(int)> done) { done(pwm.initialize()); return 0; });
+        steps.push_back([this](std::function<void(int)> done) { done(display.initialize()); return 0; });
+    }
+
+    /** @return bring-up time in ns or 0 on failure. */
+    uint64_t serial()
+    {
+        _start = monotonicNsec();
+        _failed = false;
+        _next(0);
+        poller.loop();
+        return _failed ? 0 : monotonicNsec() - _start;
+    }
+
+    uint64_t concurrent()
+    {
+        _start = monotonicNsec();
+        _failed = false;
+        _pending = steps.size();
+        for (Step &step: steps) {
+            if (step([this](int result) { _done(result); }) < 0) {
+                return 0;
+            }
+        }
+        if (_pending > 0) {
+            poller.loop();
+        }
+        return _failed ? 0 : monotonicNsec() - _start;
+    }
+
+    /** Time to first gyro and barometer samples in ns.
+     * @return 0 on success or negative value on error
+     */
+    int orchestrated(uint64_t &first_gyro, uint64_t &first_baro)
+    {
+        Startup startup(&poller);
+        first_gyro = first_baro = 0;
+        auto sampled = [&](uint64_t &first) {
+            if (first == 0) {
+                first = monotonicNsec() - _start;
+            }
+            if (first_gyro != 0 && first_baro != 0) {
+                poller.stop();
+            }
+        };
+        gyro.onData = [&](float, float, float) { sampled(first_gyro); };
+        baro.onSamples = [&]() { sampled(first_baro); };
+
+        startup.addBlockingStep("bus", [this]() { bus.resetStatistics(); return 0; });
+        startup.addStep("l3gd20h", steps[0], {"bus"});
+        startup.addStep("ms5611", steps[1], {"bus"});
+        startup.addStep("bmp180", steps[2], {"bus"});
+        startup.addStep("ads1115", steps[3], {"bus"});
+        startup.addBlockingStep("pca9685", [this]() { return pwm.initialize(); }, {"bus"});
+        startup.addBlockingStep("ssd1306", [this]() { return display.initialize(); }, {"bus"});
+        startup.addStep("start", [this](Startup::Completion done) {
+            if (gyro.start(L3GD20H_RATE_OCTA) < 0 || baro.startContinuous(100) < 0) {
+                return -1;
+            }
+            done(0);
+            return 0;
+        }, {"l3gd20h", "ms5611"});
+
+        bool failed = false;
+        _start = monotonicNsec();
+        if (startup.start([&](int result) { failed = result < 0; if (failed) poller.stop(); }) < 0) {
+            return -1;
+        }
+        poller.loop();
+        startup.printTimeline();
+        return failed ? -1 : 0;
+    }
+
+    SimI2C bus;
+    Poller poller;
+    L3GD20H gyro;
+    MS5611 baro;
+    BMP180 bmp;
+    ADS1115 adc;
+    PCA9685 pwm;
+    SSD1306 display;
+    std::vector<Step> steps;
+
+private:
+    SimL3GD20H gyro_model;
+    SimMS5611 baro_model;
+    SimBMP180 bmp_model;
+    SimADS1115 adc_model;
+    SimPCA9685 pwm_model;
+    SimSSD1306 display_model;
+    uint64_t _start;
+    size_t _pending;
+    bool _failed;
+
+    void _next(size_t index)
+    {
+        if (index == steps.size()) {
+            poller.stop();
+            return;
+        }
+        int ret = steps[index]([this, index](int result) {
+            _failed |= result < 0;
+            // continue from event loop, not from inside the previous driver
+            poller.post([this, index]() { _next(index + 1); });
+        });
+        if (ret < 0) {
+            _failed = true;
+            poller.stop();
+        }
+    }
+
+    void _done(int result)
+    {
+        _failed |= result < 0;
+        if (--_pending == 0) {
+            poller.stop();
+        }
+    }
+};
+
+int main()
+{
+    uint64_t serial, concurrent;
+    {
+        SensorSet set;
+        serial = set.serial();
+    }
+    {
+        SensorSet set;
+        concurrent = set.concurrent();
+    }
+    uint64_t first_gyro, first_baro;
+    int orchestrated;
+    {
+        SensorSet set;
+        orchestrated = set.orchestrated(first_gyro, first_baro);
+    }
+    if (serial == 0 || concurrent == 0 || orchestrated < 0) {
+        Error() << "Bring-up failed";
+        return EXIT_FAILURE;
+    }
+    Info() << "sensor set bring-up ms serial:" << serial / 1e6f << "concurrent:" << concurrent / 1e6f;
+    Info() << "orchestrated first sample ms gyro:" << first_gyro / 1e6f << "barometer:" << first_baro / 1e6f;
+    return EXIT_SUCCESS;
+}
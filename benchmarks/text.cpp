@@ -0,0 +1,263 @@
+#include <simi2c.h>
+#include <simdevices.h>
+#include <ssd1306.h>
+#include <font.h>
+#include <log.h>
+#include <utils.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+/* SSD1306 text rendering speed for embedded Terminus fonts, glyphs per second.
+ * Legacy path is a copy of drawText() before glyph cache: PSF parsing on every call and drawPixel() per set bit.
+ * Both paths draw the same text on two displays, display memory is compared after commit.
+ */
+
+/* PSF2 sources of all fonts, legacy path renders from them. */
+static const uint8_t _ter_v12n[] = {
+#include "fonts/ter-v12n.inc"
+};
+
+static const uint8_t _ter_v14b[] = {
+#include "fonts/ter-v14b.inc"
+};
+
+static const uint8_t _ter_v14n[] = {
+#include "fonts/ter-v14n.inc"
+};
+
+static const uint8_t _ter_v14v[] = {
+#include "fonts/ter-v14v.inc"
+};
+
+static const uint8_t _ter_v16b[] = {
+#include "fonts/ter-v16b.inc"
+};
+
+static const uint8_t _ter_v16n[] = {
+#include "fonts/ter-v16n.inc"
+};
+
+static const uint8_t _ter_v16v[] = {
+#include "fonts/ter-v16v.inc"
+};
+
+static const uint8_t _ter_v18b[] = {
+#include "fonts/ter-v18b.inc"
+};
+
+static const uint8_t _ter_v18n[] = {
+#include "fonts/ter-v18n.inc"
+};
+
+static const uint8_t _ter_v20b[] = {
+#include "fonts/ter-v20b.inc"
+};
+
+static const uint8_t _ter_v20n[] = {
+#include "fonts/ter-v20n.inc"
+};
+
+static const uint8_t _ter_v22b[] = {
+#include "fonts/ter-v22b.inc"
+};
+
+static const uint8_t _ter_v22n[] = {
+#include "fonts/ter-v22n.inc"
+};
+
+static const uint8_t _ter_v24b[] = {
+#include "fonts/ter-v24b.inc"
+};
+
+static const uint8_t _ter_v24n[] = {
+#include "fonts/ter-v24n.inc"
+};
+
+static const uint8_t _ter_v28b[] = {
+#include "fonts/ter-v28b.inc"
+};
+
+static const uint8_t _ter_v28n[] = {
+#include "fonts/ter-v28n.inc"
+};
+
+static const uint8_t _ter_v32b[] = {
+#include "fonts/ter-v32b.inc"
+};
+
+static const uint8_t _ter_v32n[] = {
+#include "fonts/ter-v32n.inc"
+};
+
+static const uint8_t *_psf[] = {
+    _ter_v12n,
+    _ter_v14b,
+    _ter_v14n,
+    _ter_v14v,
+    _ter_v16b,
+    _ter_v16n,
+    _ter_v16v,
+    _ter_v18b,
+    _ter_v18n,
+    _ter_v20b,
+    _ter_v20n,
+    _ter_v22b,
+    _ter_v22n,
+    _ter_v24b,
+    _ter_v24n,
+    _ter_v28b,
+    _ter_v28n,
+    _ter_v32b,
+    _ter_v32n,
+};
+
+static void _legacyDrawText(SSD1306 &display, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2,
+                            std::string text, uint8_t color, uint8_t font)
+{
+    if (x2<x1) std::swap(x1, x2);
+    if (y2<y1) std::swap(y1, y2);
+
+    const uint8_t* psf_font = _psf[font];
+    const uint32_t* header = reinterpret_cast<const uint32_t*>(psf_font);
+
+    uint32_t magic          = header[0];
+    uint32_t version        = header[1];
+    uint32_t header_size    = header[2];
+    uint32_t flags          = header[3];
+    uint32_t chars_count    = header[4];
+    uint32_t char_length    = header[5];
+    uint32_t char_height    = header[6];
+    uint32_t char_width     = header[7];
+
+    assert(magic == 0x864ab572);
+    assert(version == 0);
+    assert(flags == 0x1);
+    assert(chars_count > 255);
+
+    psf_font += header_size;
+
+    uint32_t width = x2 - x1;
+    uint32_t columns = width / char_width;
+
+    int pos=0;
+    for (std::string::iterator it=text.begin(); it!=text.end(); ++it) {
+        switch (*it) {
+        case '\n':
+            pos += columns - pos % columns;
+            continue;
+        case '\t':
+            pos += 2;
+            break;
+        }
+
+        uint16_t text_x = x1 + (pos % columns) * char_width;
+        uint16_t text_y = y1 + (pos / columns) * char_height;
+        uint16_t real_width = char_width + (8 - char_width % 8) % 8; // 8bit aligning
+        const uint8_t * font_char = psf_font + char_length * (*it);
+
+        if (text_y < y2) {
+            for (uint8_t ih=0; ih<char_height; ih++) {
+                for (uint8_t iw=0; iw<real_width; iw++) {
+                    size_t offset = ih * real_width / 8 + iw / 8;
+                    uint8_t probe_mask = 0b10000000 >> (iw % 8);
+                    if (*(font_char + offset) & probe_mask) {
+                        display.drawPixel(text_x + iw, text_y + ih, color);
+                    }
+                }
+            }
+        }
+
+        pos++;
+    }
+}
+
+/** Printable ASCII which fits on the screen without clipping when drawn at (1, 3). */
+static std::string _sample(uint8_t font)
+{
+    const Font &glyphs = Font::get(font);
+    size_t count = (126 / glyphs.width()) * (61 / glyphs.height());
+    std::string text;
+    for (size_t i=0; i<count; i++) {
+        text += (char)('!' + i % 94);
+    }
+    return text;
+}
+
+static float _glyphsPerSecond(size_t glyphs, std::function<void()> draw)
+{
+    uint64_t start = monotonicNsec();
+    uint64_t elapsed = 0;
+    size_t iterations = 0;
+    while (elapsed < 200000000) {
+        draw();
+        iterations++;
+        elapsed = monotonicNsec() - start;
+    }
+    return glyphs * iterations * 1e9f / elapsed;
+}
+
+int main()
+{
+    SimI2C legacy_bus, cached_bus;
+    SimSSD1306 legacy_model, cached_model;
+    legacy_bus.attach(&legacy_model);
+    cached_bus.attach(&cached_model);
+    SSD1306 legacy(SSD1306_I2C_ADDRESS, &legacy_bus, false);
+    SSD1306 cached(SSD1306_I2C_ADDRESS, &cached_bus, false);
+
+    static const uint8_t colors[] = {COLOR_WHITE, COLOR_INVERT, COLOR_BLACK};
+
+    int status = EXIT_SUCCESS;
+    size_t embedded = 0;
+    for (uint8_t font=0; font<FONT_TERMINUS_COUNT; font++) {
+        if (getFont(font) == nullptr) {
+            continue;
+        }
+        embedded += getFont(font)->size();
+        std::string text = _sample(font);
+        const Font &glyphs = Font::get(font);
+
+        // unaligned origin shifts glyphs across pages, every colour is drawn over previous ones
+        legacy.fill(); cached.fill();
+        legacy.clear(); cached.clear();
+        for (uint8_t color: colors) {
+            _legacyDrawText(legacy, 1, 3, 127, 63, text, color, font);
+            cached.drawText(1, 3, 127, 63, text, color, font);
+            _legacyDrawText(legacy, 0, 0, 127, 63, text, color, font);
+            cached.drawText(0, 0, 127, 63, text, color, font);
+        }
+        legacy.commit();
+        cached.commit();
+        if (memcmp(legacy_model.ram(), cached_model.ram(), 128 * 8) != 0) {
+            Error() << "Font" << font << "rendering differs from legacy";
+            status = EXIT_FAILURE;
+        }
+
+        // every frame starts from clear screen, so each pixel is really written
+        float legacy_rate = _glyphsPerSecond(text.size(), [&]() {
+            legacy.clear();
+            _legacyDrawText(legacy, 0, 0, 127, 63, text, COLOR_WHITE, font);
+        });
+        float cached_rate = _glyphsPerSecond(text.size(), [&]() {
+            cached.clear();
+            cached.drawText(0, 0, 127, 63, text, COLOR_WHITE, font);
+        });
+        Info() << "font" << font << glyphs.width() << "x" << glyphs.height()
+               << "legacy glyphs/s:" << legacy_rate << "cached glyphs/s:" << cached_rate
+               << "speedup:" << cached_rate / legacy_rate;
+    }
+
+    Info() << "embedded glyph data bytes:" << embedded;
+
+    if (cached.textWidth("12:34:56", FONT_DEFAULT) != 8 * Font::get(FONT_DEFAULT).width()) {
+        Error() << "Unexpected text width";
+        status = EXIT_FAILURE;
+    }
+
+    return status;
+}
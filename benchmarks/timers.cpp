@@ -0,0 +1,115 @@
+#include <poller.h>
+#include <timer.h>
+#include <timerwheel.h>
+#include <log.h>
+#include <utils.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+/* Timer backend benchmark.
+ * Runs 100 concurrent periodic timers (1-10 ms plus a few 50-500 ms ones)
+ * with one timerfd per timer and with all timers multiplexed onto TimerWheel.
+ * Reports syscalls per second (epoll_wait + read + timerfd_settime) and wakeup jitter.
+ */
+
+struct Probe {
+    Timer *timer;
+    uint64_t period;
+    uint64_t last;
+    uint64_t expirations;
+};
+
+static void _run(bool wheel_backend, int seconds)
+{
+    const size_t count = 100;
+    Poller poller;
+    TimerWheel *wheel = nullptr;
+    if (wheel_backend) {
+        wheel = new TimerWheel(&poller);
+        poller.setTimerWheel(wheel);
+    }
+
+    std::vector<Probe> probes(count);
+    std::vector<uint64_t> jitter;
+    jitter.reserve(seconds * 100000);
+    uint64_t callbacks = 0;
+
+    for (size_t i=0; i<count; i++) {
+        Probe &probe = probes[i];
+        probe.period = i < 90 ? (i % 10 + 1) : (i - 89) * 50;
+        probe.last = 0;
+        probe.expirations = 0;
+        probe.timer = new Timer(&poller);
+        probe.timer->onTimeout = [&probe, &jitter, &callbacks]() {
+            uint64_t now = monotonicNsec();
+            if (probe.last != 0) {
+                int64_t delta = now - probe.last - probe.period * 1000000;
+                jitter.push_back(delta < 0 ? -delta : delta);
+            }
+            probe.last = now;
+            probe.expirations++;
+            callbacks++;
+        };
+    }
+
+    Timer stop_timer(&poller);
+    stop_timer.onTimeout = [&poller]() { poller.stop(); };
+    stop_timer.singleShot(seconds * 1000);
+
+    for (Probe &probe: probes) {
+        probe.timer->start(probe.period);
+    }
+
+    float epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls_per_iteration, events_per_wakeup;
+    poller.getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls_per_iteration, events_per_wakeup);
+    poller.loop();
+    poller.getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls_per_iteration, events_per_wakeup);
+
+    // every fd event costs one read(), epoll_wait count is derived from events per wakeup
+    uint64_t events = callbacks + 1;
+    uint64_t rearms = 0;
+    if (wheel != nullptr) {
+        uint64_t wakeups, expirations;
+        wheel->getStatistics(wakeups, expirations, rearms);
+        events = wakeups;
+    }
+    uint64_t epoll_calls = events_per_wakeup > 0 ? events / events_per_wakeup * syscalls_per_iteration : 0;
+    uint64_t syscalls = epoll_calls + events + rearms;
+
+    // built-in per timer histograms, worst timer is reported
+    uint64_t lateness_p99 = 0, lateness_max = 0, overruns = 0;
+    for (Probe &probe: probes) {
+        lateness_p99 = std::max(lateness_p99, probe.timer->lateness().percentile(0.99));
+        lateness_max = std::max(lateness_max, probe.timer->lateness().max());
+        overruns += probe.timer->overruns();
+    }
+
+    for (Probe &probe: probes) {
+        probe.timer->stop();
+        delete probe.timer;
+    }
+    stop_timer.stop();
+    poller.setTimerWheel(nullptr);
+    delete wheel;
+
+    std::sort(jitter.begin(), jitter.end());
+    size_t n = jitter.size();
+    Info() << (wheel_backend ? "timer wheel:   " : "timerfd/timer:") << "callbacks/s" << callbacks / seconds
+           << "syscalls/s" << syscalls / seconds
+           << "(epoll" << epoll_calls / seconds << "read" << events / seconds << "settime" << rearms / seconds << ")"
+           << "jitter us p50:" << jitter[n / 2] / 1000.f
+           << "p99:" << jitter[n * 99 / 100] / 1000.f
+           << "max:" << jitter[n - 1] / 1000.f;
+    Info() << "    lateness us p99 <=" << (unsigned long long)lateness_p99
+           << "max:" << lateness_max / 1000.f << "overruns:" << (unsigned long long)overruns;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    _run(false, seconds);
+    _run(true, seconds);
+    return 0;
+}
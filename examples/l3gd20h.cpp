@@ -45,14 +45,15 @@ protected:
 
         Info() << "Initializing timers";
         stats_timer.onTimeout = [&]() {
-            float epoll_mono, callback_mono, epoll_cpu, callback_cpu;
-            _event_poller->getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu);
+            float epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls, events;
+            _event_poller->getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu, syscalls, events);
             Info() << "Real Time: epoll" << epoll_mono << "callbacks" << callback_mono
                    << "ratio" << roundTo(epoll_mono / (epoll_mono + callback_mono) * 100, 0.1) << "%"
                    << "/" << roundTo(callback_mono / (epoll_mono + callback_mono) * 100, 0.1) << "%";
             Info() << "CPU Time: epoll" << epoll_cpu << "callbacks" << callback_cpu
                    << "ratio" << roundTo(epoll_cpu / (epoll_cpu + callback_cpu) * 100, 0.1) << "%"
                    << "/" << roundTo(callback_cpu / (epoll_cpu + callback_cpu) * 100, 0.1) << "%";
+            Info() << "Wakeups: syscalls per iteration" << syscalls << "events per wakeup" << events;
         };
         stats_timer.start(5000);
 
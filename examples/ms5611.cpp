@@ -6,6 +6,7 @@
 #include <log.h>
 #include <utils.h>
 #include <application.h>
+#include <startup.h>
 
 class Main: public Application
 {
@@ -15,29 +16,29 @@ class Main: public Application
 
 protected:
     virtual bool _onStart() {
-        Info() << "Initializing I2C";
-        if (i2c.openDevice("/dev/i2c-1") < 0) {
-            Error() << "Unable to open i2c device";
-            return false;
-        }
+        // bus is opened on startup thread pool, sensor is reset and verified from event loop
+        _startup->addBlockingStep("i2c", [&]() {
+            if (i2c.openDevice("/dev/i2c-1") < 0) {
+                Error() << "Unable to open i2c device";
+                return -1;
+            }
+            return 0;
+        });
+        _startup->addStep("ms5611", [&](Startup::Completion done) {
+            ms5611.setOversampling(MS5611_OVERSAMPLING_4096);
+            ms5611.setCalibrationCache("/tmp");
+            return ms5611.initializeAsync(done);
+        }, {"i2c"});
 
-        Info() << "Initializing sensors";
-        if (ms5611.initialize() < 0) {
-            Error() << "Unable to initialize ms5611";
-            return false;
-        }
-        ms5611.setOversampling(MS5611_OVERSAMPLING_4096);
         ms5611.onTemperatureAndPressure = [&](float temperature, float pressure) {
             Info() << "Temperature" << temperature << "Pressure" << pressure;
         };
 
-        Info() << "Initializing timers";
         ms5611_timer.onTimeout = [&]() {
             if (ms5611.getTemperatureAndPressure()<0) {
                 Error() << "Unable to get temperature and pressure";
             }
         };
-        ms5611_timer.start(1000);
 
         stats_timer.onTimeout = [&]() {
             float epoll_mono, callback_mono, epoll_cpu, callback_cpu;
@@ -54,6 +55,12 @@ protected:
         return Application::_onStart();
     }
 
+    virtual bool _onStarted() {
+        Info() << "Initializing timers";
+        ms5611_timer.start(1000);
+        return Application::_onStarted();
+    }
+
     virtual bool _onQuit() {
         Info() << "Cleanuping resources";
 
@@ -1,5 +1,5 @@
 #include "ads1115.h"
-#include "i2c.h"
+#include "i2cbus.h"
 #include "poller.h"
 #include "timer.h"
 #include "log.h"
@@ -13,11 +13,11 @@ static const uint64_t _rates[] = { 8, 16, 32, 64, 128, 250, 475, 860 };
 static const float _gains[] = { 6.144, 4.096, 2.048, 1.024, 0.512, 0.256 };
 
 ADS1115::ADS1115():
-    ADS1115(ADS1115_I2C_ADDRESS, I2C::getDefault(), Poller::getDefault())
+    ADS1115(ADS1115_I2C_ADDRESS, I2CBus::getDefault(), Poller::getDefault())
 {
 }
 
-ADS1115::ADS1115(uint8_t address, I2C *bus, Poller *event_poller):
+ADS1115::ADS1115(uint8_t address, I2CBus *bus, Poller *event_poller):
     _i2c(bus), _timer(new Timer(event_poller)), _address(address), _state(NotReady), _gain(0)
 {
     _timer->onTimeout = [this]() {
@@ -62,6 +62,15 @@ int ADS1115::initialize()
     return 0;
 }
 
+int ADS1115::initializeAsync(std::function<void(int)> callback)
+{
+    if (initialize() < 0) {
+        return -1;
+    }
+    if (callback) callback(0);
+    return 0;
+}
+
 int ADS1115::startSampling(Mux mux, Gain gain, SampleRate sample_rate, bool single_shot)
 {
     if (_state != Ready) {
@@ -8,7 +8,7 @@
 
 class Poller;
 class Timer;
-class I2C;
+class I2CBus;
 
 class ADS1115
 {
@@ -54,7 +54,7 @@ public:
     std::function<void(float)> onData;
 
     ADS1115();
-    ADS1115(uint8_t address, I2C *bus, Poller *event_poller);
+    ADS1115(uint8_t address, I2CBus *bus, Poller *event_poller);
     ADS1115(const ADS1115& that) = delete; /**< Copy contructor is not allowed. */
     ~ADS1115();
 
@@ -63,6 +63,14 @@ public:
      */
     int initialize();
 
+    /** Same as initialize(), for uniform bring-up with other drivers.
+     * Configuration is a single register write with nothing to wait for,
+     * so callback is called before return.
+     * @param callback - called with 0 on success
+     * @return 0 on success or negative value on error, callback is not called then
+     */
+    int initializeAsync(std::function<void(int)> callback);
+
     /** Start data sampling.
      * @param mux - input muxing.
      * @param gain - input gain.
@@ -78,7 +86,7 @@ public:
     int stopSampling();
 
 private:
-    I2C *_i2c;
+    I2CBus *_i2c;
     Timer *_timer;
     uint8_t _address;
     State _state;
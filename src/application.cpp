@@ -1,11 +1,15 @@
 #include "application.h"
 #include "poller.h"
 #include "signal.h"
+#include "startup.h"
 #include "log.h"
 
+#include <stdlib.h>
+
 Application::Application():
     _event_poller(new Poller),
     _signal(new Signal),
+    _startup(new Startup(_event_poller)),
     _exit_code(EXIT_SUCCESS)
 {
     _signal->onSignal = [&](signalfd_siginfo &siginfo) {
@@ -19,6 +23,7 @@ Application::Application():
 
 Application::~Application()
 {
+    delete _startup; _startup = nullptr;
     delete _signal; _signal = nullptr;
     delete _event_poller; _event_poller = nullptr;
 }
@@ -29,6 +34,20 @@ int Application::run(int argc, char **argv)
         return _exit_code == 0 ? 255 : _exit_code;
     }
 
+    int ret = _startup->start([this](int result) {
+        if (_startup->size() > 0) {
+            _startup->printTimeline();
+        }
+        if (result < 0 || !_onStarted()) {
+            Error() << "Startup failed";
+            _exit_code = _exit_code == 0 ? 255 : _exit_code;
+            _event_poller->stop();
+        }
+    });
+    if (ret < 0) {
+        return _exit_code == 0 ? 255 : _exit_code;
+    }
+
     _event_poller->loop();
 
     return _exit_code;
@@ -39,6 +58,11 @@ bool Application::_onStart()
     return true;
 }
 
+bool Application::_onStarted()
+{
+    return true;
+}
+
 bool Application::_onQuit()
 {
     return true;
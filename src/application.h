@@ -3,7 +3,12 @@
 
 class Poller;
 class Signal;
+class Startup;
 
+/** Application skeleton: event loop, termination signals and startup sequence.
+ * Subclasses register init steps in _startup from _onStart(), independent steps run
+ * concurrently once event loop is started, _onStarted() is called when all of them finished.
+ */
 class Application
 {
 public:
@@ -15,9 +20,12 @@ public:
 protected:
     Poller *_event_poller;
     Signal *_signal;
+    Startup *_startup;
     int _exit_code;
 
     virtual bool _onStart();
+    /** Called from event loop when every startup step succeeded, return false to quit. */
+    virtual bool _onStarted();
     virtual bool _onQuit();
 };
 
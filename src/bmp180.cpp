@@ -1,5 +1,5 @@
 #include "bmp180.h"
-#include "i2c.h"
+#include "i2cbus.h"
 #include "timer.h"
 #include "log.h"
 
@@ -21,16 +21,18 @@
 #define BMP180_COMMAND_TEMPERATURE  0x2E // temperature measurent
 #define BMP180_COMMAND_PRESSURE     0x34 // pressure measurement
 
+#define BMP180_STARTUP_MSEC         10
+
 #define BMP180_DELAY                4500
 #define BMP180_RETRY                2000
 
 
 BMP180::BMP180():
-    BMP180(BMP180_I2C_DEFAULT_ADDR, I2C::getDefault(), Poller::getDefault())
+    BMP180(BMP180_I2C_DEFAULT_ADDR, I2CBus::getDefault(), Poller::getDefault())
 {
 }
 
-BMP180::BMP180(uint8_t address, I2C *bus, Poller *event_poller):
+BMP180::BMP180(uint8_t address, I2CBus *bus, Poller *event_poller):
     _state(NotReady), _i2c(bus), _timer(new Timer(event_poller)),
     _address(address),  _id(0), _oversampling(BMP180_OVERSAMPLING_SINGLE),
     _ac1(0), _ac2(0), _ac3(0), _ac4(0), _ac5(0), _ac6(0),
@@ -41,7 +43,13 @@ BMP180::BMP180(uint8_t address, I2C *bus, Poller *event_poller):
     _timer->onTimeout = [this]() {
         assert(_state != NotReady);
         assert(_state != Ready);
-        if (_state == ReadingTemperature) {
+        if (_state == Resetting) {
+            _state = NotReady;
+            int result = initialize();
+            std::function<void(int)> callback = std::move(_initialized);
+            _initialized = nullptr;
+            if (callback) callback(result);
+        } else if (_state == ReadingTemperature) {
             if (_readTemperatureADC() < 0) {
                 Error() << "_readTemperatureADC error";
                 if (onError) onError();
@@ -128,6 +136,24 @@ int BMP180::initialize()
     return 0;
 }
 
+int BMP180::initializeAsync(std::function<void(int)> callback)
+{
+    if (_state == Resetting) {
+        Error() << "Device is already initializing";
+        return -1;
+    }
+    _timer->stop();
+    if (_i2c->writeByte(_address, BMP180_SOFT_RESET_REG, BMP180_SOFT_RESET_REF) < 0) {
+        Error() << "Unable to reset device";
+        _state = NotReady;
+        return -1;
+    }
+    _initialized = callback;
+    _state = Resetting;
+    _timer->singleShot(BMP180_STARTUP_MSEC);
+    return 0;
+}
+
 int BMP180::setOversampling(uint8_t ovesampling)
 {
     if (_state != Ready) {
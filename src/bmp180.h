@@ -12,7 +12,7 @@
 
 class Poller;
 class Timer;
-class I2C;
+class I2CBus;
 
 /** Bosch bmp180 pressure sensor.
  * Class provides methods and callbacks to read temperature and pressure from bmp180 sensor.
@@ -21,6 +21,7 @@ class BMP180
 {
     enum State {
         NotReady,
+        Resetting,
         Ready,
         ReadingTemperature,
         ReadingComboTemperature,
@@ -51,7 +52,7 @@ public:
      * @param bus - but instance, where sensor located.
      * @param address - device address.
      */
-    BMP180(uint8_t address, I2C *bus, Poller *event_poller);
+    BMP180(uint8_t address, I2CBus *bus, Poller *event_poller);
     BMP180(const BMP180& that) = delete; /**< Copy contructor not allowed because of sensor state and timers. */
     ~BMP180();
 
@@ -60,6 +61,12 @@ public:
      */
     int initialize();
 
+    /** Reset sensor, wait for start-up and initialize it without blocking event loop.
+     * @param callback - called from event loop with 0 on success or negative value on error
+     * @return 0 if initialization started or negative value on error, callback is not called then
+     */
+    int initializeAsync(std::function<void(int)> callback);
+
     /** Set sensor oversampling.
      * Set how many samples should be used for approximation by sensor.
      * Use predefined constants: BMP180_OVERSAMPLING_*.
@@ -80,12 +87,14 @@ public:
      */
     int getTemperatureAndPressure();
 
-    /** Perform device soft reset. */
+    /** Perform device soft reset.
+     * Device has to be initialized again after start-up time, initializeAsync() does both.
+     */
     void reset();
 
 private:
     State _state;
-    I2C *_i2c;
+    I2CBus *_i2c;
     Timer *_timer;
     uint8_t _address;
     uint8_t _id;
@@ -109,6 +118,8 @@ private:
     float _temperature;
     float _pressure;
 
+    std::function<void(int)> _initialized;
+
     int _readTemperatureADC();
     int _readPressureADC();
     int _writeCommand(uint8_t command);
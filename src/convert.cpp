@@ -0,0 +1,307 @@
+#include "convert.h"
+
+/* Kernel set is chosen at compile time from target flags, NAVIO_CONVERT_PORTABLE forces scalar code.
+ * SSE2 covers int16 with 1 and 3 channels (single samples and 3 axis sensors),
+ * NEON additionally covers 24 bit values through byte plane loads.
+ * NEON kernels are opt-in with NAVIO_CONVERT_NEON until bench_convert is checked on target.
+ * Everything else and array tails go through the reference loop.
+ * This file is built with -ffp-contract=off so neither path fuses multiply and add.
+ */
+#if defined(NAVIO_CONVERT_PORTABLE)
+#define CONVERT_PORTABLE
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CONVERT_SSE2
+#elif defined(NAVIO_CONVERT_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define CONVERT_NEON
+#else
+#define CONVERT_PORTABLE
+#endif
+
+static inline int32_t _value(ConvertFormat format, const uint8_t *p)
+{
+    switch (format) {
+    case ConvertUInt8:
+        return p[0];
+    case ConvertInt16LE:
+        return (int16_t)(p[0] | p[1] << 8);
+    case ConvertInt16BE:
+        return (int16_t)(p[0] << 8 | p[1]);
+    case ConvertInt24BE:
+        return (int32_t)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8) >> 8;
+    case ConvertUInt24BE:
+        return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    }
+    return 0;
+}
+
+size_t convertValueSize(ConvertFormat format)
+{
+    switch (format) {
+    case ConvertUInt8:
+        return 1;
+    case ConvertInt16LE:
+    case ConvertInt16BE:
+        return 2;
+    case ConvertInt24BE:
+    case ConvertUInt24BE:
+        return 3;
+    }
+    return 0;
+}
+
+void convertReference(ConvertFormat format, const uint8_t data[], size_t count, size_t channels,
+                      float scale, float offset, float *const out[])
+{
+    size_t size = convertValueSize(format);
+    for (size_t i=0; i<count; i++) {
+        for (size_t c=0; c<channels; c++) {
+            float value = (float)_value(format, data + (i * channels + c) * size);
+            out[c][i] = value * scale + offset;
+        }
+    }
+}
+
+void unpackReference(ConvertFormat format, const uint8_t data[], size_t count, size_t channels, int32_t *const out[])
+{
+    size_t size = convertValueSize(format);
+    for (size_t i=0; i<count; i++) {
+        for (size_t c=0; c<channels; c++) {
+            out[c][i] = _value(format, data + (i * channels + c) * size);
+        }
+    }
+}
+
+#if defined(CONVERT_SSE2)
+
+static inline __m128i _load16(ConvertFormat format, const uint8_t *p)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (format == ConvertInt16BE) {
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+    return v;
+}
+
+static inline __m128i _low32(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline __m128i _high32(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+static inline __m128 _scale(__m128i v, __m128 scale, __m128 offset)
+{
+    return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), scale), offset);
+}
+
+/** Split a0 b0 c0 a1 | b1 c1 a2 b2 | c2 a3 b3 c3 into channel vectors. */
+static inline void _store3(__m128 a, __m128 b, __m128 c, float *const out[], size_t i)
+{
+    __m128 p = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128 q = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128 r = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    __m128 t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    _mm_storeu_ps(out[0] + i, _mm_shuffle_ps(a, p, _MM_SHUFFLE(2, 0, 3, 0)));
+    _mm_storeu_ps(out[1] + i, _mm_shuffle_ps(q, r, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(out[2] + i, _mm_shuffle_ps(t, c, _MM_SHUFFLE(3, 0, 2, 0)));
+}
+
+static size_t _convert(ConvertFormat format, const uint8_t data[], size_t count, size_t channels,
+                       float scale, float offset, float *const out[])
+{
+    if (format != ConvertInt16LE && format != ConvertInt16BE) {
+        return 0;
+    }
+
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 o = _mm_set1_ps(offset);
+    size_t i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _load16(format, data + i * 2);
+            _mm_storeu_ps(out[0] + i, _scale(_low32(v), s, o));
+            _mm_storeu_ps(out[0] + i + 4, _scale(_high32(v), s, o));
+        }
+    } else if (channels == 3) {
+        for (; i + 8 <= count; i += 8) {
+            const uint8_t *p = data + i * 6;
+            __m128i v0 = _load16(format, p);
+            __m128i v1 = _load16(format, p + 16);
+            __m128i v2 = _load16(format, p + 32);
+            _store3(_scale(_low32(v0), s, o), _scale(_high32(v0), s, o), _scale(_low32(v1), s, o), out, i);
+            _store3(_scale(_high32(v1), s, o), _scale(_low32(v2), s, o), _scale(_high32(v2), s, o), out, i + 4);
+        }
+    }
+    return i;
+}
+
+static size_t _unpack(ConvertFormat format, const uint8_t data[], size_t count, size_t channels, int32_t *const out[])
+{
+    if ((format != ConvertInt16LE && format != ConvertInt16BE) || channels != 1) {
+        return 0;
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _load16(format, data + i * 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out[0] + i), _low32(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out[0] + i + 4), _high32(v));
+    }
+    return i;
+}
+
+#elif defined(CONVERT_NEON)
+
+static inline int16x8_t _swap16(ConvertFormat format, int16x8_t v)
+{
+    if (format == ConvertInt16BE) {
+        return vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(v)));
+    }
+    return v;
+}
+
+static inline void _store16(int16x8_t v, float32x4_t scale, float32x4_t offset, float *dst)
+{
+    float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+    float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+    vst1q_f32(dst, vaddq_f32(vmulq_f32(low, scale), offset));
+    vst1q_f32(dst + 4, vaddq_f32(vmulq_f32(high, scale), offset));
+}
+
+/** Join byte planes of 4 big endian 24 bit values. */
+static inline int32x4_t _join24(ConvertFormat format, uint16x4_t b0, uint16x4_t b1, uint16x4_t b2)
+{
+    uint32x4_t v = vorrq_u32(vorrq_u32(vshlq_n_u32(vmovl_u16(b0), 16), vshlq_n_u32(vmovl_u16(b1), 8)), vmovl_u16(b2));
+    int32x4_t value = vreinterpretq_s32_u32(v);
+    if (format == ConvertInt24BE) {
+        value = vshrq_n_s32(vshlq_n_s32(value, 8), 8);
+    }
+    return value;
+}
+
+/** Unpack 16 single channel 24 bit values. */
+static inline void _load24(ConvertFormat format, const uint8_t *p, int32x4_t value[4])
+{
+    uint8x16x3_t planes = vld3q_u8(p);
+    uint16x8_t low[3], high[3];
+    for (int b=0; b<3; b++) {
+        low[b] = vmovl_u8(vget_low_u8(planes.val[b]));
+        high[b] = vmovl_u8(vget_high_u8(planes.val[b]));
+    }
+    value[0] = _join24(format, vget_low_u16(low[0]), vget_low_u16(low[1]), vget_low_u16(low[2]));
+    value[1] = _join24(format, vget_high_u16(low[0]), vget_high_u16(low[1]), vget_high_u16(low[2]));
+    value[2] = _join24(format, vget_low_u16(high[0]), vget_low_u16(high[1]), vget_low_u16(high[2]));
+    value[3] = _join24(format, vget_high_u16(high[0]), vget_high_u16(high[1]), vget_high_u16(high[2]));
+}
+
+static size_t _convert(ConvertFormat format, const uint8_t data[], size_t count, size_t channels,
+                       float scale, float offset, float *const out[])
+{
+    const float32x4_t s = vdupq_n_f32(scale);
+    const float32x4_t o = vdupq_n_f32(offset);
+    size_t i = 0;
+
+    if ((format == ConvertInt16LE || format == ConvertInt16BE) && channels == 1) {
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(data + i * 2));
+            _store16(_swap16(format, v), s, o, out[0] + i);
+        }
+    } else if ((format == ConvertInt16LE || format == ConvertInt16BE) && channels == 3) {
+        for (; i + 8 <= count; i += 8) {
+            int16x8x3_t v = vld3q_s16(reinterpret_cast<const int16_t*>(data + i * 6));
+            for (int c=0; c<3; c++) {
+                _store16(_swap16(format, v.val[c]), s, o, out[c] + i);
+            }
+        }
+    } else if ((format == ConvertInt24BE || format == ConvertUInt24BE) && channels == 1) {
+        for (; i + 16 <= count; i += 16) {
+            int32x4_t value[4];
+            _load24(format, data + i * 3, value);
+            for (int q=0; q<4; q++) {
+                vst1q_f32(out[0] + i + q * 4, vaddq_f32(vmulq_f32(vcvtq_f32_s32(value[q]), s), o));
+            }
+        }
+    }
+    return i;
+}
+
+static size_t _unpack(ConvertFormat format, const uint8_t data[], size_t count, size_t channels, int32_t *const out[])
+{
+    size_t i = 0;
+    if ((format == ConvertInt16LE || format == ConvertInt16BE) && channels == 1) {
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t v = _swap16(format, vreinterpretq_s16_u8(vld1q_u8(data + i * 2)));
+            vst1q_s32(out[0] + i, vmovl_s16(vget_low_s16(v)));
+            vst1q_s32(out[0] + i + 4, vmovl_s16(vget_high_s16(v)));
+        }
+    } else if ((format == ConvertInt24BE || format == ConvertUInt24BE) && channels == 1) {
+        for (; i + 16 <= count; i += 16) {
+            int32x4_t value[4];
+            _load24(format, data + i * 3, value);
+            for (int q=0; q<4; q++) {
+                vst1q_s32(out[0] + i + q * 4, value[q]);
+            }
+        }
+    }
+    return i;
+}
+
+#else
+
+static size_t _convert(ConvertFormat, const uint8_t[], size_t, size_t, float, float, float *const[])
+{
+    return 0;
+}
+
+static size_t _unpack(ConvertFormat, const uint8_t[], size_t, size_t, int32_t *const[])
+{
+    return 0;
+}
+
+#endif
+
+void convert(ConvertFormat format, const uint8_t data[], size_t count, size_t channels,
+             float scale, float offset, float *const out[])
+{
+    size_t done = _convert(format, data, count, channels, scale, offset, out);
+    if (done == count) {
+        return;
+    }
+
+    float *tail[channels];
+    for (size_t c=0; c<channels; c++) {
+        tail[c] = out[c] + done;
+    }
+    convertReference(format, data + done * channels * convertValueSize(format), count - done, channels,
+                     scale, offset, tail);
+}
+
+void unpack(ConvertFormat format, const uint8_t data[], size_t count, size_t channels, int32_t *const out[])
+{
+    size_t done = _unpack(format, data, count, channels, out);
+    if (done == count) {
+        return;
+    }
+
+    int32_t *tail[channels];
+    for (size_t c=0; c<channels; c++) {
+        tail[c] = out[c] + done;
+    }
+    unpackReference(format, data + done * channels * convertValueSize(format), count - done, channels, tail);
+}
+
+const char* convertBackend()
+{
+#if defined(CONVERT_SSE2)
+    return "sse2";
+#elif defined(CONVERT_NEON)
+    return "neon";
+#else
+    return "portable";
+#endif
+}
@@ -0,0 +1,51 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Raw sample layouts as they come from sensor registers. */
+enum ConvertFormat {
+    ConvertUInt8,
+    ConvertInt16LE,
+    ConvertInt16BE,
+    ConvertInt24BE,
+    ConvertUInt24BE
+};
+
+/** Unpack interleaved raw samples into separate channels and scale them.
+ * out[c][i] = raw(sample i, channel c) * scale + offset, multiply and add are not fused.
+ * Uses SSE2 when target supports it, NEON only with NAVIO_CONVERT_NEON, portable code otherwise.
+ * Results are bit-exact with convertReference().
+ * @param format - raw value layout
+ * @param data - raw bytes, samples follow each other, channels are interleaved inside a sample
+ * @param count - amount of samples
+ * @param channels - values per sample
+ * @param scale - multiplier
+ * @param offset - added after scaling
+ * @param out - one destination array per channel
+ */
+void convert(ConvertFormat format, const uint8_t data[], size_t count, size_t channels,
+             float scale, float offset, float *const out[]);
+
+/** Unpack interleaved raw samples into separate integer channels without scaling.
+ * @param format - raw value layout
+ * @param data - raw bytes
+ * @param count - amount of samples
+ * @param channels - values per sample
+ * @param out - one destination array per channel
+ */
+void unpack(ConvertFormat format, const uint8_t data[], size_t count, size_t channels, int32_t *const out[]);
+
+/** Scalar implementation, reference for bit-exactness checks. */
+void convertReference(ConvertFormat format, const uint8_t data[], size_t count, size_t channels,
+                      float scale, float offset, float *const out[]);
+void unpackReference(ConvertFormat format, const uint8_t data[], size_t count, size_t channels, int32_t *const out[]);
+
+/** @return size of one raw value in bytes. */
+size_t convertValueSize(ConvertFormat format);
+
+/** @return name of compiled in kernel set: "sse2", "neon" or "portable". */
+const char* convertBackend();
+
+#endif // CONVERT_H
@@ -0,0 +1,62 @@
+#include "event.h"
+#include "poller.h"
+#include "log.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <cassert>
+
+Event::Event():
+    Event(Poller::getDefault())
+{
+
+}
+
+Event::Event(Poller *event_poller):
+    Descriptor(event_poller), onEvent(nullptr)
+{
+    _descriptor = eventfd(0, EFD_NONBLOCK);
+    assert(_descriptor >= 0);
+    _registerRead();
+}
+
+Event::~Event()
+{
+    _unregisterRead();
+    close(_descriptor);
+}
+
+const char* Event::name()
+{
+    return "Event";
+}
+
+int Event::notify(uint64_t value)
+{
+    if (::write(_descriptor, &value, sizeof(value)) != sizeof(value)) {
+        Error() << "Unable to notify event. errno" << errno << strerror(errno);
+        return -1;
+    }
+    return 0;
+}
+
+void Event::_onRead()
+{
+    uint64_t value = 0;
+    if (read(_descriptor, &value, sizeof(value)) == sizeof(value)) {
+        if (onEvent) {
+            onEvent(value);
+        } else {
+            Warn() << "Event handler is not set";
+        }
+    } else if (errno != EAGAIN) {
+        Error() << "Incomplete event data";
+    }
+}
+
+void Event::_onWrite()
+{
+
+}
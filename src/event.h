@@ -0,0 +1,42 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "descriptor.h"
+#include <stdint.h>
+#include <functional>
+
+/** Linux eventfd wrapper.
+ *  Class provides wakeup primitive which can be triggered from any thread.
+ *  Callback is always executed in event poller thread.
+ */
+class Event: public Descriptor
+{
+public:
+    /** User set callback. Will be called when event was notified.
+     * @param uint64_t sum of values passed to notify() since last callback.
+     */
+    std::function<void(uint64_t)> onEvent;
+
+    /** Event constructor with default eventloop. */
+    Event();
+    /** Event constructor.
+     * @param event_poller - EventPoller instance which will be used to process events.
+     */
+    Event(Poller *event_poller);
+    Event(const Event& that) = delete;  /**< Copy contructor not allowed because of file descriptor. */
+    virtual ~Event();
+    virtual const char* name();
+
+    /** Notify event.
+     * Thread safe, could be called from any thread.
+     * @param value - value which will be added to eventfd counter.
+     * @return 0 on success or negative value on error
+     */
+    int notify(uint64_t value=1);
+
+protected:
+    virtual void _onRead();
+    virtual void _onWrite();
+};
+
+#endif // EVENT_H
@@ -0,0 +1,41 @@
+#include "font.h"
+#include "log.h"
+
+const Font& Font::get(uint8_t font)
+{
+    const Font *embedded = getFont(font);
+    if (embedded == nullptr) {
+        WarnLimited(1) << "Font" << font << "is not compiled in, check NAVIO_FONTS";
+        embedded = getFont(FONT_DEFAULT);
+    }
+    return *embedded;
+}
+
+const uint8_t* Font::glyph(uint8_t character) const
+{
+    // the first glyph is always space
+    if (character < _first || character >= _first + _count) {
+        character = _first;
+    }
+    return _glyphs + (character - _first) * _pages * _width;
+}
+
+size_t Font::textWidth(const std::string &text) const
+{
+    size_t longest = 0;
+    size_t cells = 0;
+    for (char character: text) {
+        switch (character) {
+        case '\n':
+            if (cells > longest) longest = cells;
+            cells = 0;
+            continue;
+        case '\t':
+            cells += 2;
+            break;
+        }
+        cells++;
+    }
+    if (cells > longest) longest = cells;
+    return longest * _width;
+}
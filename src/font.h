@@ -0,0 +1,101 @@
+#ifndef FONT_H
+#define FONT_H
+
+#define FONT_TERMINUS_v12n      0x00
+#define FONT_TERMINUS_v14b      0x01
+#define FONT_TERMINUS_v14n      0x02
+#define FONT_TERMINUS_v14v      0x03
+#define FONT_TERMINUS_v16b      0x04
+#define FONT_TERMINUS_v16n      0x05
+#define FONT_TERMINUS_v16v      0x06
+#define FONT_TERMINUS_v18b      0x07
+#define FONT_TERMINUS_v18n      0x08
+#define FONT_TERMINUS_v20b      0x09
+#define FONT_TERMINUS_v20n      0x0A
+#define FONT_TERMINUS_v22b      0x0B
+#define FONT_TERMINUS_v22n      0x0C
+#define FONT_TERMINUS_v24b      0x0D
+#define FONT_TERMINUS_v24n      0x0E
+#define FONT_TERMINUS_v28b      0x0F
+#define FONT_TERMINUS_v28n      0x10
+#define FONT_TERMINUS_v32b      0x11
+#define FONT_TERMINUS_v32n      0x12
+
+#define FONT_TERMINUS_COUNT     0x13
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/** Font in SSD1306 memory layout.
+ * Glyph is stored page-major: pages() rows of width() bytes, bit 0 of a byte is the top pixel of its page,
+ * so text could be drawn with byte blits instead of pixel by pixel.
+ * Fonts are converted from PSF2 at build time by fontconv, only fonts and glyph range
+ * selected with NAVIO_FONTS and NAVIO_FONT_CHARSET cmake options are compiled in.
+ */
+class Font
+{
+public:
+    /** Constructor, used by generated fonts_embedded.h.
+     * @param width - glyph width in pixels
+     * @param height - glyph height in pixels
+     * @param first - code of the first glyph
+     * @param count - amount of glyphs
+     * @param glyphs - count * pages() * width bytes
+     */
+    constexpr Font(uint8_t width, uint8_t height, uint8_t first, uint16_t count, const uint8_t *glyphs):
+        _width(width), _height(height), _pages((height + 7) / 8), _first(first), _count(count), _glyphs(glyphs)
+    {
+    }
+    Font(const Font& that) = delete;  /**< Copy contructor not allowed, fonts are shared. */
+
+    /** Get embedded font.
+     * @param font - FONT_TERMINUS_* id, font which is not compiled in gives FONT_DEFAULT with warning
+     */
+    static const Font& get(uint8_t font);
+
+    /** Glyph width in pixels. */
+    constexpr uint8_t width() const { return _width; }
+
+    /** Glyph height in pixels. */
+    constexpr uint8_t height() const { return _height; }
+
+    /** Glyph column size in bytes. */
+    constexpr uint8_t pages() const { return _pages; }
+
+    /** Size of glyph data in bytes. */
+    constexpr size_t size() const { return (size_t)_count * _pages * _width; }
+
+    /** Get glyph bitmap.
+     * @param character - character code, Latin-1, characters which are not compiled in are drawn as space
+     * @return pages() * width() bytes
+     */
+    const uint8_t* glyph(uint8_t character) const;
+
+    /** Width of text in pixels, the longest line is measured.
+     * Tab takes three cells like in SSD1306::drawText().
+     * @param text - text to measure
+     */
+    size_t textWidth(const std::string &text) const;
+
+private:
+    uint8_t _width;
+    uint8_t _height;
+    uint8_t _pages;
+    uint8_t _first;
+    uint16_t _count;
+    const uint8_t *_glyphs;
+};
+
+#include "fonts_embedded.h"
+
+/** Get embedded font.
+ * @param font - FONT_TERMINUS_* id
+ * @return font or nullptr if it is not compiled in
+ */
+constexpr const Font* getFont(uint8_t font)
+{
+    return font < FONT_TERMINUS_COUNT ? _embedded_fonts[font] : nullptr;
+}
+
+#endif // FONT_H
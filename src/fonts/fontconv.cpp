@@ -0,0 +1,208 @@
+/* Build time font converter.
+ * Reads Terminus PSF2 fonts from C array includes (ter-*.inc) and writes the selected glyph range
+ * in SSD1306 page-major format: fonts_embedded.h with constexpr Font objects and id table,
+ * fonts_embedded.cpp with glyph data.
+ *
+ * Usage: fontconv <ascii|latin1> <output.h> <output.cpp> <name>=<input.inc>...
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/** Font names in FONT_TERMINUS_* id order. */
+static const char *_names[] = {
+    "ter-v12n", "ter-v14b", "ter-v14n", "ter-v14v", "ter-v16b", "ter-v16n", "ter-v16v",
+    "ter-v18b", "ter-v18n", "ter-v20b", "ter-v20n", "ter-v22b", "ter-v22n", "ter-v24b",
+    "ter-v24n", "ter-v28b", "ter-v28n", "ter-v32b", "ter-v32n"
+};
+static const size_t _count = sizeof(_names) / sizeof(_names[0]);
+
+struct Font {
+    std::string name;       /**< ter-v12n */
+    std::string identifier; /**< font_ter_v12n */
+    std::string id;         /**< FONT_TERMINUS_v12n */
+    size_t width;
+    size_t height;
+    std::vector<uint8_t> glyphs;
+};
+
+static int _read(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "fontconv: unable to open %s\n", path);
+        return -1;
+    }
+    std::string text;
+    char chunk[4096];
+    size_t size;
+    while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.append(chunk, size);
+    }
+    fclose(file);
+
+    // array initializer: hex bytes and comments, comments never contain "0x"
+    for (size_t position = text.find("0x"); position != std::string::npos; position = text.find("0x", position)) {
+        char *end;
+        data.push_back(strtoul(text.c_str() + position, &end, 16));
+        position = end - text.c_str();
+    }
+    return 0;
+}
+
+static uint32_t _word(const std::vector<uint8_t> &data, size_t index)
+{
+    const uint8_t *bytes = data.data() + index * 4;
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static int _convert(const char *path, size_t first, size_t count, Font &font)
+{
+    std::vector<uint8_t> psf;
+    if (_read(path, psf) < 0) {
+        return -1;
+    }
+    if (psf.size() < 32 || _word(psf, 0) != 0x864ab572 || _word(psf, 1) != 0) {
+        fprintf(stderr, "fontconv: %s is not a PSF2 font\n", path);
+        return -1;
+    }
+    uint32_t header_size = _word(psf, 2);
+    uint32_t chars_count = _word(psf, 4);
+    uint32_t char_length = _word(psf, 5);
+    uint32_t char_height = _word(psf, 6);
+    uint32_t char_width  = _word(psf, 7);
+    size_t row_size = (char_width + 7) / 8;
+    if (chars_count < first + count || psf.size() < header_size + chars_count * char_length
+        || char_length < row_size * char_height || char_width > 255 || char_height > 255) {
+        fprintf(stderr, "fontconv: %s has unexpected layout\n", path);
+        return -1;
+    }
+
+    // PSF rows are MSB first and padded to bytes, SSD1306 columns are LSB on top
+    size_t pages = (char_height + 7) / 8;
+    font.width = char_width;
+    font.height = char_height;
+    font.glyphs.assign(count * pages * char_width, 0);
+    for (size_t character=0; character<count; character++) {
+        const uint8_t *source = psf.data() + header_size + char_length * (first + character);
+        uint8_t *glyph = font.glyphs.data() + character * pages * char_width;
+        for (size_t y=0; y<char_height; y++) {
+            for (size_t x=0; x<char_width; x++) {
+                if (source[y * row_size + x / 8] & (0x80 >> (x % 8))) {
+                    glyph[(y / 8) * char_width + x] |= 1 << (y % 8);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int _write(const char *header_path, const char *source_path, const std::vector<Font> &fonts,
+                  const char *charset, size_t first, size_t count)
+{
+    FILE *header = fopen(header_path, "w");
+    if (header == nullptr) {
+        fprintf(stderr, "fontconv: unable to write %s\n", header_path);
+        return -1;
+    }
+    fprintf(header, "// Generated by fontconv, do not edit. Charset: %s\n\n", charset);
+    for (const Font &font: fonts) {
+        fprintf(header, "extern const uint8_t %s_glyphs[];\n", font.identifier.c_str());
+        fprintf(header, "constexpr Font %s(%zu, %zu, 0x%02zx, %zu, %s_glyphs);\n\n",
+                font.identifier.c_str(), font.width, font.height, first, count, font.identifier.c_str());
+    }
+    fprintf(header, "#define FONT_DEFAULT %s\n\n", fonts[0].id.c_str());
+    fprintf(header, "constexpr const Font* _embedded_fonts[FONT_TERMINUS_COUNT] = {\n");
+    for (size_t id=0; id<_count; id++) {
+        const char *entry = "nullptr";
+        for (const Font &font: fonts) {
+            if (font.name == _names[id]) {
+                entry = font.identifier.c_str();
+            }
+        }
+        fprintf(header, "    %s%s,\n", strcmp(entry, "nullptr") == 0 ? "" : "&", entry);
+    }
+    fprintf(header, "};\n");
+    if (fclose(header) != 0) {
+        fprintf(stderr, "fontconv: unable to write %s\n", header_path);
+        return -1;
+    }
+
+    FILE *source = fopen(source_path, "w");
+    if (source == nullptr) {
+        fprintf(stderr, "fontconv: unable to write %s\n", source_path);
+        return -1;
+    }
+    fprintf(source, "// Generated by fontconv, do not edit.\n\n#include <stdint.h>\n");
+    for (const Font &font: fonts) {
+        size_t glyph_size = font.glyphs.size() / count;
+        fprintf(source, "\nextern const uint8_t %s_glyphs[] = {\n", font.identifier.c_str());
+        for (size_t character=0; character<count; character++) {
+            fprintf(source, "   ");
+            for (size_t i=0; i<glyph_size; i++) {
+                fprintf(source, " 0x%02x,", font.glyphs[character * glyph_size + i]);
+            }
+            fprintf(source, "   /* 0x%02zx */\n", first + character);
+        }
+        fprintf(source, "};\n");
+    }
+    if (fclose(source) != 0) {
+        fprintf(stderr, "fontconv: unable to write %s\n", source_path);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <ascii|latin1> <output.h> <output.cpp> <name>=<input.inc>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // glyphs before space are control characters, they are drawn as space
+    size_t first = 0x20;
+    size_t count;
+    if (strcmp(argv[1], "ascii") == 0) {
+        count = 0x7F - first;
+    } else if (strcmp(argv[1], "latin1") == 0) {
+        count = 0x100 - first;
+    } else {
+        fprintf(stderr, "fontconv: unknown charset %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Font> fonts;
+    for (int i=4; i<argc; i++) {
+        const char *separator = strchr(argv[i], '=');
+        if (separator == nullptr) {
+            fprintf(stderr, "fontconv: expected <name>=<input.inc>, got %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        Font font;
+        font.name.assign(argv[i], separator - argv[i]);
+        bool known = false;
+        for (size_t id=0; id<_count; id++) {
+            known = known || font.name == _names[id];
+        }
+        if (!known) {
+            fprintf(stderr, "fontconv: unknown font %s\n", font.name.c_str());
+            return EXIT_FAILURE;
+        }
+        font.identifier = "font_" + font.name.substr(0, 3) + "_" + font.name.substr(4);
+        font.id = "FONT_TERMINUS_" + font.name.substr(4);
+        if (_convert(separator + 1, first, count, font) < 0) {
+            return EXIT_FAILURE;
+        }
+        fonts.push_back(font);
+    }
+
+    if (_write(argv[2], argv[3], fonts, argv[1], first, count) < 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
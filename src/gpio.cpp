@@ -0,0 +1,118 @@
+#include "gpio.h"
+#include "poller.h"
+#include "log.h"
+
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+GPIO::GPIO():
+    GPIO(Poller::getDefault())
+{
+
+}
+
+GPIO::GPIO(Poller *event_poller):
+    Descriptor(event_poller), onEdge(nullptr)
+{
+
+}
+
+GPIO::~GPIO()
+{
+    close();
+}
+
+const char* GPIO::name()
+{
+    return "GPIO";
+}
+
+int GPIO::open(const char *chip, uint32_t line, Edge edge)
+{
+    if (_descriptor >= 0) {
+        Error() << "Line is already requested";
+        return -1;
+    }
+
+    int chip_fd = ::open(chip, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) {
+        Error() << "Unable to open" << chip << "errno" << errno << strerror(errno);
+        return -1;
+    }
+
+    gpioevent_request request;
+    memset(&request, 0, sizeof(request));
+    request.lineoffset = line;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    switch (edge) {
+    case EdgeRising:
+        request.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+        break;
+    case EdgeFalling:
+        request.eventflags = GPIOEVENT_REQUEST_FALLING_EDGE;
+        break;
+    case EdgeBoth:
+        request.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+        break;
+    }
+    strncpy(request.consumer_label, "navio", sizeof(request.consumer_label) - 1);
+
+    int result = ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &request);
+    ::close(chip_fd);
+    if (result < 0) {
+        Error() << "Unable to request line" << line << "events. errno" << errno << strerror(errno);
+        return -1;
+    }
+
+    _descriptor = request.fd;
+    if (fcntl(_descriptor, F_SETFL, fcntl(_descriptor, F_GETFL) | O_NONBLOCK) < 0) {
+        Error() << "Unable to set line descriptor non blocking";
+        close();
+        return -1;
+    }
+    _registerRead();
+    return 0;
+}
+
+void GPIO::close()
+{
+    if (_descriptor < 0) {
+        return;
+    }
+    _unregisterRead();
+    ::close(_descriptor);
+    _descriptor = -1;
+}
+
+void GPIO::_onRead()
+{
+    gpioevent_data events[16];
+    ssize_t size = read(_descriptor, events, sizeof(events));
+    if (size < 0) {
+        if (errno != EAGAIN) {
+            Error() << "Unable to read line events. errno" << errno << strerror(errno);
+        }
+        return;
+    }
+    for (size_t i=0; i<size / sizeof(gpioevent_data); i++) {
+        _edge(events[i].timestamp);
+    }
+}
+
+void GPIO::_onWrite()
+{
+
+}
+
+void GPIO::_edge(uint64_t timestamp)
+{
+    if (onEdge) {
+        onEdge(timestamp);
+    } else {
+        Warn() << "Edge handler is not set";
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef GPIO_H
+#define GPIO_H
+
+#include "descriptor.h"
+#include <stdint.h>
+#include <functional>
+
+/** GPIO input line events.
+ *  Line is requested through gpiochip character device, edges are timestamped by kernel
+ *  and delivered in event poller thread. Used to wait for sensor interrupt pins.
+ */
+class GPIO: public Descriptor
+{
+public:
+    enum Edge {
+        EdgeRising,
+        EdgeFalling,
+        EdgeBoth
+    };
+
+    /** User set callback. Will be called on every requested edge.
+     * @param uint64_t edge timestamp in nanoseconds, CLOCK_MONOTONIC on Linux 5.7 and newer.
+     */
+    std::function<void(uint64_t)> onEdge;
+
+    /** GPIO constructor with default eventloop. */
+    GPIO();
+    /** GPIO constructor.
+     * @param event_poller - EventPoller instance which will be used to process events.
+     */
+    GPIO(Poller *event_poller);
+    GPIO(const GPIO& that) = delete;  /**< Copy contructor not allowed because of file descriptor. */
+    virtual ~GPIO();
+    virtual const char* name();
+
+    /** Request line events.
+     * @param chip - gpiochip device, e.g. "/dev/gpiochip0"
+     * @param line - line offset within the chip
+     * @param edge - edges to report
+     * @return 0 on success or negative value on error
+     */
+    int open(const char *chip, uint32_t line, Edge edge=EdgeRising);
+
+    /** Release line. */
+    void close();
+
+protected:
+    virtual void _onRead();
+    virtual void _onWrite();
+
+    /** Deliver edge to the user callback. */
+    void _edge(uint64_t timestamp);
+};
+
+#endif // GPIO_H
@@ -0,0 +1,104 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/** Lock-free log2 latency histogram.
+ * Bucket 0 counts values below 1 usec, bucket N counts values in [2^(N-1), 2^N) usec.
+ * Single writer (owning event loop), readers could query it from any thread at any time.
+ */
+class Histogram
+{
+public:
+    static const size_t buckets = 32;
+
+    Histogram()
+    {
+        reset();
+    }
+    Histogram(const Histogram& that) = delete;  /**< Copy contructor is not allowed. */
+
+    /** Add sample, must be called from single writer thread.
+     * @param nsec - sample value in nsec.
+     */
+    void add(uint64_t nsec)
+    {
+        uint64_t usec = nsec / 1000;
+        size_t bucket = usec == 0 ? 0 : 64 - __builtin_clzll(usec);
+        if (bucket >= buckets) {
+            bucket = buckets - 1;
+        }
+        // single writer, so plain load/store is enough and avoids locked instructions
+        _counts[bucket].store(_counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        _total.store(_total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (nsec > _max.load(std::memory_order_relaxed)) {
+            _max.store(nsec, std::memory_order_relaxed);
+        }
+    }
+
+    /** Get amount of samples in bucket. */
+    uint32_t count(size_t bucket) const
+    {
+        return bucket < buckets ? _counts[bucket].load(std::memory_order_relaxed) : 0;
+    }
+
+    /** Get bucket upper bound in usec. */
+    static uint64_t bound(size_t bucket)
+    {
+        return 1ull << bucket;
+    }
+
+    /** Get total amount of samples. */
+    uint64_t total() const
+    {
+        return _total.load(std::memory_order_relaxed);
+    }
+
+    /** Get maximum sample in nsec. */
+    uint64_t max() const
+    {
+        return _max.load(std::memory_order_relaxed);
+    }
+
+    /** Get percentile upper bound.
+     * @param fraction - percentile in range 0..1, e.g. 0.99.
+     * @return upper bound of bucket which contains requested percentile in usec.
+     */
+    uint64_t percentile(float fraction) const
+    {
+        uint64_t total = 0;
+        uint32_t counts[buckets];
+        for (size_t i=0; i<buckets; i++) {
+            counts[i] = count(i);
+            total += counts[i];
+        }
+        uint64_t threshold = total * fraction;
+        uint64_t accumulated = 0;
+        for (size_t i=0; i<buckets; i++) {
+            accumulated += counts[i];
+            if (accumulated > threshold) {
+                return bound(i);
+            }
+        }
+        return bound(buckets - 1);
+    }
+
+    /** Reset histogram. Samples added concurrently may be lost. */
+    void reset()
+    {
+        for (size_t i=0; i<buckets; i++) {
+            _counts[i].store(0, std::memory_order_relaxed);
+        }
+        _total.store(0, std::memory_order_relaxed);
+        _max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> _counts[buckets];
+    std::atomic<uint64_t> _total;
+    std::atomic<uint64_t> _max;
+};
+
+#endif // HISTOGRAM_H
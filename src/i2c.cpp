@@ -2,28 +2,20 @@
 #include "log.h"
 
 #include <sys/ioctl.h>
+#include <errno.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <fcntl.h>
 #include <cassert>
 
-static I2C* _default_i2c = nullptr;
-
 I2C::I2C():
-    _fd(-1)
+    _fd(-1), _path()
 {
-    if (_default_i2c == nullptr) {
-        _default_i2c = this;
-    }
 }
 
 I2C::~I2C()
 {
-    if (_default_i2c == this) {
-        _default_i2c = nullptr;
-    }
-
     if (_fd != -1) {
         close(_fd); _fd = -1;
     }
@@ -38,109 +30,14 @@ int I2C::openDevice(const char *dev_path)
         Error() << "Failed to open device. errno" << errno << strerror(errno);
         return -1;
     }
+    snprintf(_path, sizeof(_path), "%s", dev_path);
 
     return 0;
 }
 
-int I2C::readByte(const uint8_t device_address, const uint8_t register_address, uint8_t &data)
-{
-    i2c_msg read_reg[2]={
-        { device_address, I2C_M_WR, 1, const_cast<uint8_t*>(&register_address) },
-        { device_address, I2C_M_RD, 1, &data }
-    };
-
-    i2c_rdwr_ioctl_data messages;
-    messages.nmsgs = 2;
-    messages.msgs = read_reg;
-
-    return readWrite(messages);
-}
-
-int I2C::readBytes(const uint8_t device_address, const uint8_t register_address, const uint8_t size, uint8_t data[])
-{
-    assert(data != 0);
-    i2c_msg read_reg[2]={
-        { device_address, I2C_M_WR, 1, const_cast<uint8_t*>(&register_address) },
-        { device_address, I2C_M_RD, size, data }
-    };
-
-    i2c_rdwr_ioctl_data messages;
-    messages.nmsgs = 2;
-    messages.msgs = read_reg;
-
-    return readWrite(messages);
-}
-
-int I2C::write(const uint8_t device_address, const uint8_t register_address)
-{
-    uint8_t r_data[1] = {
-        register_address
-    };
-
-    i2c_msg message [1]= {
-        { device_address, I2C_M_WR, 1, r_data },
-    };
-
-    i2c_rdwr_ioctl_data messages;
-    messages.nmsgs = 1;
-    messages.msgs = message;
-
-    return readWrite(messages);
-}
-
-int I2C::writeByte(const uint8_t device_address, const uint8_t register_address, const uint8_t &data)
+const char* I2C::name()
 {
-    uint8_t r_data[2] = {
-        register_address,
-        data
-    };
-
-    i2c_msg message [1]= {
-        { device_address, I2C_M_WR, 2, r_data },
-    };
-
-    i2c_rdwr_ioctl_data messages;
-    messages.nmsgs = 1;
-    messages.msgs = message;
-
-    return readWrite(messages);
-}
-
-int I2C::writeBytes(const uint8_t device_address, const uint8_t register_address, const uint8_t size, const uint8_t data[])
-{
-    assert(data != 0);
-    if (size > 127) {
-        Error() << "Byte write count" << size << "> 127";
-        return -1;
-    }
-
-    int16_t r_size = size + 1;
-    uint8_t r_data[r_size];
-    r_data[0] = register_address;
-    memcpy(r_data+1, data, size);
-
-    i2c_msg message [] = {
-        { device_address, I2C_M_WR, r_size, r_data },
-    };
-
-    i2c_rdwr_ioctl_data messages;
-    messages.nmsgs = 1;
-    messages.msgs = message;
-
-    return readWrite(messages);
-}
-
-int I2C::writeBatch(const uint8_t device_address, const uint8_t size, const uint8_t data[])
-{
-    i2c_msg message [] = {
-        { device_address, I2C_M_WR, size, const_cast<uint8_t*>(data) },
-    };
-
-    i2c_rdwr_ioctl_data messages;
-    messages.nmsgs = 1;
-    messages.msgs = message;
-
-    return readWrite(messages);
+    return _path;
 }
 
 int I2C::readWrite(i2c_rdwr_ioctl_data &messages)
@@ -155,9 +52,3 @@ int I2C::readWrite(i2c_rdwr_ioctl_data &messages)
     }
     return 0;
 }
-
-I2C* I2C::getDefault()
-{
-    assert(_default_i2c != nullptr);
-    return _default_i2c;
-}
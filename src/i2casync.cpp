@@ -0,0 +1,184 @@
+#include "i2casync.h"
+#include "i2cbus.h"
+#include "poller.h"
+#include "log.h"
+
+#include <string.h>
+#include <cassert>
+
+I2CAsync::Transaction::Transaction():
+    _messages(), _buffer()
+{
+}
+
+void I2CAsync::Transaction::write(uint8_t device_address, size_t size, const uint8_t data[])
+{
+    size_t offset = _buffer.size();
+    _buffer.insert(_buffer.end(), data, data + size);
+    _messages.push_back(Message{device_address, I2C_M_WR, (uint16_t)size, offset});
+}
+
+void I2CAsync::Transaction::writeBytes(uint8_t device_address, uint8_t register_address, size_t size, const uint8_t data[])
+{
+    size_t offset = _buffer.size();
+    _buffer.push_back(register_address);
+    _buffer.insert(_buffer.end(), data, data + size);
+    _messages.push_back(Message{device_address, I2C_M_WR, (uint16_t)(size + 1), offset});
+}
+
+size_t I2CAsync::Transaction::readBytes(uint8_t device_address, uint8_t register_address, size_t size)
+{
+    size_t offset = _buffer.size();
+    _buffer.push_back(register_address);
+    _messages.push_back(Message{device_address, I2C_M_WR, 1, offset});
+    _buffer.resize(_buffer.size() + size);
+    _messages.push_back(Message{device_address, I2C_M_RD, (uint16_t)size, offset + 1});
+    return offset + 1;
+}
+
+const uint8_t* I2CAsync::Transaction::data(size_t handle) const
+{
+    assert(handle < _buffer.size());
+    return _buffer.data() + handle;
+}
+
+size_t I2CAsync::Transaction::size() const
+{
+    return _buffer.size();
+}
+
+size_t I2CAsync::Transaction::messages() const
+{
+    return _messages.size();
+}
+
+I2CAsync::I2CAsync(I2CBus *bus, Poller *event_poller):
+    _i2c(bus), _ep(event_poller), _mutex(), _condition(), _pending(0), _run(true), _worker()
+{
+    assert(_i2c != nullptr);
+    assert(_ep != nullptr);
+    _worker = std::thread(&I2CAsync::_work, this);
+}
+
+I2CAsync::~I2CAsync()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _run = false;
+    }
+    _condition.notify_one();
+    _worker.join();
+
+    for (auto &queue: _queues) {
+        for (Job *job: queue) {
+            delete job;
+        }
+        queue.clear();
+    }
+}
+
+int I2CAsync::submit(Transaction &&transaction, Callback callback, Priority priority)
+{
+    if (transaction._messages.empty()) {
+        Error() << "Empty transaction";
+        return -1;
+    }
+
+    Job *job = new Job{std::move(transaction), std::move(callback), 0};
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queues[priority].push_back(job);
+        _pending++;
+    }
+    _condition.notify_one();
+    return 0;
+}
+
+I2CBus* I2CAsync::bus()
+{
+    return _i2c;
+}
+
+Poller* I2CAsync::poller()
+{
+    return _ep;
+}
+
+size_t I2CAsync::pending()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _pending;
+}
+
+void I2CAsync::_work()
+{
+    std::vector<i2c_msg> messages;
+
+    for (;;) {
+        Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (;;) {
+                // on shutdown queued jobs are left for destructor
+                if (!_run) {
+                    break;
+                }
+                for (auto &queue: _queues) {
+                    if (!queue.empty()) {
+                        job = queue.front();
+                        queue.pop_front();
+                        break;
+                    }
+                }
+                if (job != nullptr) {
+                    break;
+                }
+                _condition.wait(lock);
+            }
+        }
+        if (job == nullptr) {
+            return;
+        }
+
+        Transaction &transaction = job->transaction;
+        messages.resize(transaction._messages.size());
+        for (size_t i=0; i<messages.size(); i++) {
+            const Transaction::Message &message = transaction._messages[i];
+            messages[i].addr = message.address;
+            messages[i].flags = message.flags;
+            messages[i].len = message.length;
+            messages[i].buf = transaction._buffer.data() + message.offset;
+        }
+
+        i2c_rdwr_ioctl_data data;
+        data.msgs = messages.data();
+        data.nmsgs = messages.size();
+        job->result = _i2c->readWrite(data);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending--;
+        }
+
+        // completion is delivered through poller task queue and its eventfd,
+        // a full queue is retried until shutdown, the loop may be stopped already
+        while (_ep->postFixed(&I2CAsync::_complete, job) < 0) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!_run) {
+                delete job;
+                break;
+            }
+            lock.unlock();
+            std::this_thread::yield();
+        }
+    }
+}
+
+void I2CAsync::_complete(void *argument)
+{
+    Job *job = static_cast<Job*>(argument);
+    if (job->callback) {
+        job->callback(job->result, job->transaction);
+    }
+    delete job;
+}
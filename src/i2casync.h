@@ -0,0 +1,142 @@
+#ifndef I2CASYNC_H
+#define I2CASYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Poller;
+class I2CBus;
+
+/** Asynchronous i2c transaction engine.
+ * Transactions (i2c message lists) are executed by a per bus worker thread,
+ * so long transfers like display frames never block the event loop.
+ * Completion callback is executed in the event poller thread which was passed to constructor.
+ *
+ * Transactions are not interrupted, but queued transactions are reordered by priority,
+ * so a sensor read waits at most for one transaction which is already on the bus.
+ * Split long transfers into several transactions to keep that time short.
+ */
+class I2CAsync
+{
+public:
+    enum Priority {
+        PriorityHigh,
+        PriorityNormal,
+        PriorityLow
+    };
+
+    /** I2C message list with owned buffers. */
+    class Transaction
+    {
+        friend class I2CAsync;
+    public:
+        Transaction();
+
+        /** Append write message.
+         * @param device_address - i2c device address
+         * @param size - data size
+         * @param data - data to write
+         */
+        void write(uint8_t device_address, size_t size, const uint8_t data[]);
+
+        /** Append register write message.
+         * @param device_address - i2c device address
+         * @param register_address - i2c device register
+         * @param size - data size
+         * @param data - data to write
+         */
+        void writeBytes(uint8_t device_address, uint8_t register_address, size_t size, const uint8_t data[]);
+
+        /** Append register read messages.
+         * @param device_address - i2c device address
+         * @param register_address - i2c device register
+         * @param size - data size
+         * @return read handle, use data() to get result after completion.
+         */
+        size_t readBytes(uint8_t device_address, uint8_t register_address, size_t size);
+
+        /** Get read result.
+         * @param handle - value returned by readBytes().
+         * @return pointer to received data.
+         */
+        const uint8_t* data(size_t handle) const;
+
+        /** Amount of bytes which will be transferred, not including addresses. */
+        size_t size() const;
+
+        /** Amount of i2c messages. */
+        size_t messages() const;
+
+    private:
+        struct Message {
+            uint16_t address;
+            uint16_t flags;
+            uint16_t length;
+            size_t offset;
+        };
+        std::vector<Message> _messages;
+        std::vector<uint8_t> _buffer;
+    };
+
+    /** Completion callback.
+     * @param int 0 on success or negative value on error
+     * @param Transaction completed transaction with received data.
+     */
+    typedef std::function<void(int, Transaction&)> Callback;
+
+    /** Constructor.
+     * @param bus - i2c bus, used by worker thread.
+     * @param event_poller - event poller where completion callbacks will be executed.
+     */
+    I2CAsync(I2CBus *bus, Poller *event_poller);
+    I2CAsync(const I2CAsync& that) = delete;  /**< Copy contructor not allowed because of worker thread. */
+
+    /** Destructor.
+     * Waits for running transaction, queued ones are dropped without callback.
+     */
+    ~I2CAsync();
+
+    /** Queue transaction.
+     * @param transaction - transaction, it is moved into the queue.
+     * @param callback - completion callback, could be nullptr.
+     * @param priority - queue priority.
+     * @return 0 on success or negative value on error
+     */
+    int submit(Transaction &&transaction, Callback callback, Priority priority=PriorityNormal);
+
+    /** Get underlying bus, could be used for synchronous setup paths. */
+    I2CBus* bus();
+
+    /** Get event poller where completions are delivered. */
+    Poller* poller();
+
+    /** Amount of queued and running transactions. */
+    size_t pending();
+
+private:
+    struct Job {
+        Transaction transaction;
+        Callback callback;
+        int result;
+    };
+
+    I2CBus *_i2c;
+    Poller *_ep;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<Job*> _queues[PriorityLow + 1];
+    size_t _pending;
+    bool _run;
+    std::thread _worker;
+
+    void _work();
+    static void _complete(void *job);
+};
+
+#endif // I2CASYNC_H
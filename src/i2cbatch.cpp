@@ -0,0 +1,141 @@
+#include "i2cbatch.h"
+#include "i2cbus.h"
+#include "log.h"
+
+#include <cassert>
+
+#ifndef I2C_RDWR_IOCTL_MAX_MSGS
+#define I2C_RDWR_IOCTL_MAX_MSGS 42
+#endif
+
+I2CBatch::I2CBatch(I2CBus *bus):
+    _i2c(bus), _messages(), _buffer(), _auto_increment(), _stream()
+{
+    assert(_i2c != nullptr);
+}
+
+void I2CBatch::setMerge(uint8_t device_address, Merge mode)
+{
+    _auto_increment[device_address & 0x7F] = (mode == MergeAutoIncrement);
+    _stream[device_address & 0x7F] = (mode == MergeStream);
+}
+
+void I2CBatch::writeBatch(uint8_t device_address, uint8_t size, const uint8_t data[])
+{
+    _write(device_address, -1, size, data);
+}
+
+void I2CBatch::writeByte(uint8_t device_address, uint8_t register_address, uint8_t data)
+{
+    _write(device_address, register_address, 1, &data);
+}
+
+void I2CBatch::writeBytes(uint8_t device_address, uint8_t register_address, uint8_t size, const uint8_t data[])
+{
+    _write(device_address, register_address, size, data);
+}
+
+void I2CBatch::readByte(uint8_t device_address, uint8_t register_address, uint8_t &data)
+{
+    readBytes(device_address, register_address, 1, &data);
+}
+
+void I2CBatch::readBytes(uint8_t device_address, uint8_t register_address, uint8_t size, uint8_t data[])
+{
+    size_t offset = _buffer.size();
+    _buffer.push_back(register_address);
+    _messages.push_back(Message{device_address, I2C_M_WR, 1, -1, offset, nullptr, true});
+    _messages.push_back(Message{device_address, I2C_M_RD, size, -1, 0, data, false});
+}
+
+void I2CBatch::_write(uint8_t device_address, int16_t register_address, uint8_t size, const uint8_t data[])
+{
+    if (register_address >= 0 && !_messages.empty()) {
+        Message &last = _messages.back();
+        // last message data is always at the end of buffer
+        if (last.address == device_address && last.flags == I2C_M_WR && last.register_address >= 0) {
+            bool merge = false;
+            if (_auto_increment[device_address & 0x7F]) {
+                merge = (last.register_address + last.length - 1 == register_address);
+            } else if (_stream[device_address & 0x7F]) {
+                merge = (last.register_address == register_address);
+            }
+            if (merge && last.length + size <= INT16_MAX) {
+                _buffer.insert(_buffer.end(), data, data + size);
+                last.length += size;
+                return;
+            }
+        }
+    }
+
+    size_t offset = _buffer.size();
+    if (register_address >= 0) {
+        _buffer.push_back(register_address);
+    }
+    _buffer.insert(_buffer.end(), data, data + size);
+    uint16_t length = size + (register_address >= 0 ? 1 : 0);
+    _messages.push_back(Message{device_address, I2C_M_WR, length, register_address, offset, nullptr, true});
+}
+
+size_t I2CBatch::_chunk(size_t start) const
+{
+    size_t end = start + I2C_RDWR_IOCTL_MAX_MSGS;
+    if (end >= _messages.size()) {
+        return _messages.size();
+    }
+    // don't separate register address write from its read
+    while (!_messages[end].split) {
+        end--;
+    }
+    return end;
+}
+
+int I2CBatch::submit()
+{
+    i2c_msg messages[I2C_RDWR_IOCTL_MAX_MSGS];
+    int ret = 0;
+
+    for (size_t start = 0; start < _messages.size();) {
+        size_t end = _chunk(start);
+        for (size_t i = start; i < end; i++) {
+            const Message &message = _messages[i];
+            i2c_msg &msg = messages[i - start];
+            msg.addr = message.address;
+            msg.flags = message.flags;
+            msg.len = message.length;
+            msg.buf = message.data != nullptr ? message.data : _buffer.data() + message.offset;
+        }
+
+        i2c_rdwr_ioctl_data data;
+        data.msgs = messages;
+        data.nmsgs = end - start;
+        if (_i2c->readWrite(data) < 0) {
+            ret = -1;
+            break;
+        }
+        start = end;
+    }
+
+    clear();
+    return ret;
+}
+
+void I2CBatch::clear()
+{
+    _messages.clear();
+    _buffer.clear();
+}
+
+size_t I2CBatch::messages() const
+{
+    return _messages.size();
+}
+
+size_t I2CBatch::syscalls() const
+{
+    size_t count = 0;
+    for (size_t start = 0; start < _messages.size(); start = _chunk(start)) {
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,113 @@
+#ifndef I2CBATCH_H
+#define I2CBATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bitset>
+#include <vector>
+
+class I2CBus;
+
+/** I2C operations batch.
+ * Records operations and sends them with as few I2C_RDWR ioctls as possible:
+ * up to I2C_RDWR_IOCTL_MAX_MSGS messages go in one syscall.
+ * Adjacent register writes to the same device could be merged into one message
+ * when device allows it, see setMerge().
+ *
+ * Messages in one ioctl are separated by repeated START instead of STOP,
+ * don't batch operations which need a delay between them.
+ * Read destinations must stay valid until submit() returns.
+ */
+class I2CBatch
+{
+public:
+    enum Merge {
+        MergeNone,          /**< Every operation is a separate message. */
+        MergeAutoIncrement, /**< Writes to consecutive registers are merged, device increments register address. */
+        MergeStream         /**< Writes to the same register are merged, e.g. command streams. */
+    };
+
+    /** Constructor.
+     * @param bus - i2c bus
+     */
+    I2CBatch(I2CBus *bus);
+
+    /** Set write merging mode for device, MergeNone by default.
+     * @param device_address - i2c device address
+     * @param mode - merge mode
+     */
+    void setMerge(uint8_t device_address, Merge mode);
+
+    /** Record raw write operation, it is never merged.
+     * @param device_address - i2c device address
+     * @param size - data size
+     * @param data - data to write, copied
+     */
+    void writeBatch(uint8_t device_address, uint8_t size, const uint8_t data[]);
+
+    /** Record register write operation.
+     * @param device_address - i2c device address
+     * @param register_address - i2c device register
+     * @param data - value to write
+     */
+    void writeByte(uint8_t device_address, uint8_t register_address, uint8_t data);
+
+    /** Record register write operation.
+     * @param device_address - i2c device address
+     * @param register_address - i2c device register
+     * @param size - data size
+     * @param data - data to write, copied
+     */
+    void writeBytes(uint8_t device_address, uint8_t register_address, uint8_t size, const uint8_t data[]);
+
+    /** Record register read operation.
+     * @param device_address - i2c device address
+     * @param register_address - i2c device register
+     * @param data - reference to store value on submit
+     */
+    void readByte(uint8_t device_address, uint8_t register_address, uint8_t &data);
+
+    /** Record register read operation.
+     * @param device_address - i2c device address
+     * @param register_address - i2c device register
+     * @param size - data size
+     * @param data - pointer to store data on submit
+     */
+    void readBytes(uint8_t device_address, uint8_t register_address, uint8_t size, uint8_t data[]);
+
+    /** Send recorded operations and clear batch.
+     * @return 0 on success or negative value on error
+     */
+    int submit();
+
+    /** Drop recorded operations. */
+    void clear();
+
+    /** Amount of recorded i2c messages. */
+    size_t messages() const;
+
+    /** Amount of ioctls submit() will issue. */
+    size_t syscalls() const;
+
+private:
+    struct Message {
+        uint16_t address;
+        uint16_t flags;
+        uint16_t length;
+        int16_t register_address;   /**< -1 if message is not mergeable. */
+        size_t offset;              /**< write data offset in buffer. */
+        uint8_t *data;              /**< read destination. */
+        bool split;                 /**< ioctl could start from this message. */
+    };
+
+    I2CBus *_i2c;
+    std::vector<Message> _messages;
+    std::vector<uint8_t> _buffer;
+    std::bitset<128> _auto_increment;
+    std::bitset<128> _stream;
+
+    void _write(uint8_t device_address, int16_t register_address, uint8_t size, const uint8_t data[]);
+    size_t _chunk(size_t start) const;
+};
+
+#endif // I2CBATCH_H
@@ -0,0 +1,133 @@
+#include "i2cbus.h"
+#include "log.h"
+
+#include <string.h>
+#include <cassert>
+
+static I2CBus* _default_bus = nullptr;
+
+I2CBus::I2CBus()
+{
+    if (_default_bus == nullptr) {
+        _default_bus = this;
+    }
+}
+
+I2CBus::~I2CBus()
+{
+    if (_default_bus == this) {
+        _default_bus = nullptr;
+    }
+}
+
+int I2CBus::readByte(const uint8_t device_address, const uint8_t register_address, uint8_t &data)
+{
+    i2c_msg read_reg[2]={
+        { device_address, I2C_M_WR, 1, const_cast<uint8_t*>(&register_address) },
+        { device_address, I2C_M_RD, 1, &data }
+    };
+
+    i2c_rdwr_ioctl_data messages;
+    messages.nmsgs = 2;
+    messages.msgs = read_reg;
+
+    return readWrite(messages);
+}
+
+int I2CBus::readBytes(const uint8_t device_address, const uint8_t register_address, const uint8_t size, uint8_t data[])
+{
+    assert(data != 0);
+    i2c_msg read_reg[2]={
+        { device_address, I2C_M_WR, 1, const_cast<uint8_t*>(&register_address) },
+        { device_address, I2C_M_RD, size, data }
+    };
+
+    i2c_rdwr_ioctl_data messages;
+    messages.nmsgs = 2;
+    messages.msgs = read_reg;
+
+    return readWrite(messages);
+}
+
+int I2CBus::write(const uint8_t device_address, const uint8_t register_address)
+{
+    uint8_t r_data[1] = {
+        register_address
+    };
+
+    i2c_msg message [1]= {
+        { device_address, I2C_M_WR, 1, r_data },
+    };
+
+    i2c_rdwr_ioctl_data messages;
+    messages.nmsgs = 1;
+    messages.msgs = message;
+
+    return readWrite(messages);
+}
+
+int I2CBus::writeByte(const uint8_t device_address, const uint8_t register_address, const uint8_t &data)
+{
+    uint8_t r_data[2] = {
+        register_address,
+        data
+    };
+
+    i2c_msg message [1]= {
+        { device_address, I2C_M_WR, 2, r_data },
+    };
+
+    i2c_rdwr_ioctl_data messages;
+    messages.nmsgs = 1;
+    messages.msgs = message;
+
+    return readWrite(messages);
+}
+
+int I2CBus::writeBytes(const uint8_t device_address, const uint8_t register_address, const uint8_t size, const uint8_t data[])
+{
+    assert(data != 0);
+    if (size > 127) {
+        Error() << "Byte write count" << size << "> 127";
+        return -1;
+    }
+
+    int16_t r_size = size + 1;
+    uint8_t r_data[r_size];
+    r_data[0] = register_address;
+    memcpy(r_data+1, data, size);
+
+    i2c_msg message [] = {
+        { device_address, I2C_M_WR, r_size, r_data },
+    };
+
+    i2c_rdwr_ioctl_data messages;
+    messages.nmsgs = 1;
+    messages.msgs = message;
+
+    return readWrite(messages);
+}
+
+int I2CBus::writeBatch(const uint8_t device_address, const uint8_t size, const uint8_t data[])
+{
+    i2c_msg message [] = {
+        { device_address, I2C_M_WR, size, const_cast<uint8_t*>(data) },
+    };
+
+    i2c_rdwr_ioctl_data messages;
+    messages.nmsgs = 1;
+    messages.msgs = message;
+
+    return readWrite(messages);
+}
+
+const char* I2CBus::name()
+{
+    return "i2c";
+}
+
+I2CBus* I2CBus::getDefault()
+{
+    assert(_default_bus != nullptr);
+    return _default_bus;
+}
@@ -0,0 +1,319 @@
+#include "i2cscheduler.h"
+#include "i2cbus.h"
+#include "poller.h"
+#include "log.h"
+#include "utils.h"
+
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+
+#define I2CSCHEDULER_DEFAULT_OVERHEAD_NSEC 100000
+
+I2CScheduler::I2CScheduler(I2CBus *bus, Poller *event_poller, uint32_t bus_frequency):
+    _i2c(bus), _ep(event_poller), _byte_nsec(9000000000ull / bus_frequency),
+    _overhead_nsec(I2CSCHEDULER_DEFAULT_OVERHEAD_NSEC), _bound(1.0f),
+    _mutex(), _condition(), _periodic(), _oneoff(), _running(nullptr), _next_id(0), _run(true),
+    _busy(0), _misses(0), _statistics_start(monotonicNsec()), _worker()
+{
+    assert(_i2c != nullptr);
+    assert(_ep != nullptr);
+    assert(bus_frequency > 0);
+    memset(_devices, 0, sizeof(_devices));
+    _worker = std::thread(&I2CScheduler::_work, this);
+}
+
+I2CScheduler::~I2CScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _run = false;
+    }
+    _condition.notify_one();
+    _worker.join();
+
+    for (Job *job: _periodic) {
+        delete job;
+    }
+    for (Job *job: _oneoff) {
+        delete job;
+    }
+}
+
+int I2CScheduler::addPeriodic(uint8_t device_address, uint64_t period_usec, uint64_t deadline_usec, size_t bytes,
+                              Work work, Completion completion)
+{
+    if (period_usec == 0 || deadline_usec > period_usec) {
+        Error() << "Invalid period" << period_usec << "or deadline" << deadline_usec;
+        return -1;
+    }
+
+    uint64_t job_cost = cost(bytes);
+    uint64_t period = period_usec * 1000;
+    uint64_t deadline = (deadline_usec == 0 ? period_usec : deadline_usec) * 1000;
+    if (job_cost > deadline) {
+        Error() << "Job can not meet its deadline, cost" << job_cost / 1000 << "usec";
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    float utilisation = _periodicUtilisation() + (float)job_cost / period;
+    if (utilisation > _bound) {
+        Error() << "Bus oversubscribed, utilisation would be" << utilisation;
+        return -1;
+    }
+    if (!_blockingFeasible(job_cost, deadline)) {
+        Error() << "Job blocks the bus longer than other jobs deadlines allow, cost" << job_cost / 1000 << "usec";
+        return -1;
+    }
+
+    Job *job = new Job{_next_id++, device_address, period, deadline, job_cost, bytes,
+                       std::move(work), std::move(completion), monotonicNsec(), 0, false, false};
+    _periodic.push_back(job);
+    _condition.notify_one();
+    return job->id;
+}
+
+int I2CScheduler::removePeriodic(int id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _periodic.begin(); it != _periodic.end(); it++) {
+        Job *job = *it;
+        if (job->id != id) {
+            continue;
+        }
+        _periodic.erase(it);
+        if (job == _running) {
+            job->removed = true;
+        } else {
+            delete job;
+        }
+        return 0;
+    }
+    Error() << "Unknown job" << id;
+    return -1;
+}
+
+int I2CScheduler::submit(uint8_t device_address, uint64_t deadline_usec, size_t bytes,
+                         Work work, Completion completion)
+{
+    uint64_t now = monotonicNsec();
+    uint64_t window = deadline_usec * 1000;
+    uint64_t job_cost = cost(bytes);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // demand which should be served before new job deadline
+    float demand = _periodicUtilisation() * window + job_cost;
+    for (Job *job: _oneoff) {
+        if (job->deadline <= now + window) {
+            demand += job->cost;
+        }
+    }
+    if (demand > window) {
+        Error() << "Bus oversubscribed, job can not meet its deadline";
+        return -1;
+    }
+
+    Job *job = new Job{_next_id++, device_address, 0, window, job_cost, bytes,
+                       std::move(work), std::move(completion), now, now + window, true, false};
+    _oneoff.push_back(job);
+    _condition.notify_one();
+    return 0;
+}
+
+void I2CScheduler::setUtilisationBound(float bound)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _bound = bound;
+}
+
+void I2CScheduler::setTransactionOverhead(uint64_t overhead_usec)
+{
+    _overhead_nsec.store(overhead_usec * 1000, std::memory_order_relaxed);
+}
+
+uint64_t I2CScheduler::cost(size_t bytes) const
+{
+    return _overhead_nsec.load(std::memory_order_relaxed) + bytes * _byte_nsec;
+}
+
+float I2CScheduler::admittedUtilisation()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _periodicUtilisation();
+}
+
+float I2CScheduler::utilisation()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t elapsed = monotonicNsec() - _statistics_start;
+    return elapsed > 0 ? (float)_busy / elapsed : 0.f;
+}
+
+uint64_t I2CScheduler::deadlineMisses()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _misses;
+}
+
+int I2CScheduler::getDeviceStatistics(uint8_t device_address, uint64_t &jobs, uint64_t &misses, float &throughput)
+{
+    if (device_address > 127) {
+        Error() << "Invalid device address" << device_address;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Device &device = _devices[device_address];
+    uint64_t elapsed = monotonicNsec() - _statistics_start;
+    jobs = device.jobs;
+    misses = device.misses;
+    throughput = elapsed > 0 ? device.bytes * 1e9f / elapsed : 0.f;
+    return 0;
+}
+
+void I2CScheduler::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _busy = 0;
+    _misses = 0;
+    memset(_devices, 0, sizeof(_devices));
+    _statistics_start = monotonicNsec();
+}
+
+float I2CScheduler::_periodicUtilisation() const
+{
+    float utilisation = 0.f;
+    for (const Job *job: _periodic) {
+        utilisation += (float)job->cost / job->period;
+    }
+    return utilisation;
+}
+
+bool I2CScheduler::_blockingFeasible(uint64_t cost, uint64_t deadline) const
+{
+    // job could wait for the longest other job which already took the bus
+    uint64_t blocking = 0;
+    for (const Job *job: _periodic) {
+        blocking = std::max(blocking, job->cost);
+    }
+    if (cost + blocking > deadline) {
+        return false;
+    }
+
+    for (const Job *job: _periodic) {
+        uint64_t other = cost;
+        for (const Job *next: _periodic) {
+            if (next != job) {
+                other = std::max(other, next->cost);
+            }
+        }
+        if (job->cost + other > job->relative_deadline) {
+            return false;
+        }
+    }
+    return true;
+}
+
+I2CScheduler::Job* I2CScheduler::_next(uint64_t now, uint64_t &wakeup)
+{
+    Job *next = nullptr;
+    wakeup = UINT64_MAX;
+
+    for (Job *job: _periodic) {
+        if (now >= job->release) {
+            if (job->ready) {
+                // previous instance did not get the bus before its next release, it is counted here
+                // and the pending run serves the latest release, so _finish() checks the new deadline
+                _misses++;
+                _devices[job->address & 0x7F].misses++;
+                uint64_t skipped = (now - job->release) / job->period;
+                job->deadline = job->release + skipped * job->period + job->relative_deadline;
+            } else {
+                job->ready = true;
+                job->deadline = job->release + job->relative_deadline;
+            }
+            uint64_t periods = (now - job->release) / job->period + 1;
+            job->release += periods * job->period;
+        }
+        if (job->release < wakeup) {
+            wakeup = job->release;
+        }
+        if (job->ready && (next == nullptr || job->deadline < next->deadline)) {
+            next = job;
+        }
+    }
+
+    for (Job *job: _oneoff) {
+        if (next == nullptr || job->deadline < next->deadline) {
+            next = job;
+        }
+    }
+
+    return next;
+}
+
+void I2CScheduler::_finish(Job *job, uint64_t start, uint64_t finish)
+{
+    Device &device = _devices[job->address & 0x7F];
+    _busy += finish - start;
+    device.jobs++;
+    device.bytes += job->bytes;
+    if (finish > job->deadline) {
+        _misses++;
+        device.misses++;
+    }
+
+    if (job->period == 0) {
+        for (auto it = _oneoff.begin(); it != _oneoff.end(); it++) {
+            if (*it == job) {
+                _oneoff.erase(it);
+                break;
+            }
+        }
+        delete job;
+    } else if (job->removed) {
+        delete job;
+    } else {
+        job->ready = false;
+    }
+}
+
+void I2CScheduler::_work()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (_run) {
+        uint64_t now = monotonicNsec();
+        uint64_t wakeup;
+        Job *job = _next(now, wakeup);
+
+        if (job == nullptr) {
+            if (wakeup == UINT64_MAX) {
+                _condition.wait(lock);
+            } else {
+                _condition.wait_for(lock, std::chrono::nanoseconds(wakeup - now));
+            }
+            continue;
+        }
+
+        _running = job;
+        lock.unlock();
+        uint64_t start = monotonicNsec();
+        int result = job->work(_i2c);
+        uint64_t finish = monotonicNsec();
+
+        // job is not deleted while it is running, even if it was removed
+        if (job->completion) {
+            Completion completion = job->completion;
+            while (_ep->post([completion, result]() { completion(result); }) < 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        lock.lock();
+        _running = nullptr;
+        _finish(job, start, finish);
+    }
+}
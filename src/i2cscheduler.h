@@ -0,0 +1,166 @@
+#ifndef I2CSCHEDULER_H
+#define I2CSCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Poller;
+class I2CBus;
+
+/** Earliest deadline first i2c bus scheduler.
+ * Scheduler owns the bus: all devices on it submit jobs instead of calling I2C directly.
+ * Job is a piece of bus work with a deadline and an estimate of transferred bytes,
+ * it is executed by scheduler thread. Among released jobs the one with the earliest
+ * absolute deadline runs first. Jobs are not preempted, so a long job delays
+ * everything released while it runs: split long transfers into short jobs.
+ *
+ * Job cost is estimated as transaction overhead plus bytes * 9 bit times, admission
+ * rejects jobs which would oversubscribe the bus:
+ *  periodic - sum of cost/period of all periodic jobs should stay below utilisation bound,
+ *             and every job plus the longest other job should fit in its relative deadline.
+ *  one-off - periodic demand plus queued one-off jobs due earlier should fit before its deadline.
+ * Completion callbacks are executed in the event poller thread.
+ */
+class I2CScheduler
+{
+public:
+    /** Job body, executed in scheduler thread with exclusive bus access.
+     * @return 0 on success or negative value on error
+     */
+    typedef std::function<int(I2CBus*)> Work;
+
+    /** Job completion callback with work result. */
+    typedef std::function<void(int)> Completion;
+
+    /** Constructor.
+     * @param bus - i2c bus, scheduler should be the only user of it.
+     * @param event_poller - event poller where completion callbacks will be executed.
+     * @param bus_frequency - i2c clock in Hz, used for cost estimation.
+     */
+    I2CScheduler(I2CBus *bus, Poller *event_poller, uint32_t bus_frequency=400000);
+    I2CScheduler(const I2CScheduler& that) = delete;  /**< Copy contructor not allowed because of worker thread. */
+    ~I2CScheduler();
+
+    /** Add periodic job, first instance is released immediately.
+     * @param device_address - device address used for statistics.
+     * @param period_usec - job period in microseconds.
+     * @param deadline_usec - relative deadline in microseconds, 0 means equal to period.
+     * @param bytes - amount of bytes transferred by one job instance.
+     * @param work - job body.
+     * @param completion - completion callback, could be nullptr.
+     * @return job id or negative value if job was rejected.
+     */
+    int addPeriodic(uint8_t device_address, uint64_t period_usec, uint64_t deadline_usec, size_t bytes,
+                    Work work, Completion completion=nullptr);
+
+    /** Remove periodic job.
+     * @param id - value returned by addPeriodic().
+     * @return 0 on success or negative value on error
+     */
+    int removePeriodic(int id);
+
+    /** Submit one-off job.
+     * @param device_address - device address used for statistics.
+     * @param deadline_usec - deadline in microseconds from now.
+     * @param bytes - amount of bytes transferred by job.
+     * @param work - job body.
+     * @param completion - completion callback, could be nullptr.
+     * @return 0 on success or negative value if job was rejected.
+     */
+    int submit(uint8_t device_address, uint64_t deadline_usec, size_t bytes,
+               Work work, Completion completion=nullptr);
+
+    /** Set admission utilisation bound, 1.0 by default.
+     * @param bound - maximum sum of periodic cost/period.
+     */
+    void setUtilisationBound(float bound);
+
+    /** Set fixed per job cost which is added to bytes transfer time.
+     * @param overhead_usec - syscall, start/stop conditions and adapter setup time.
+     */
+    void setTransactionOverhead(uint64_t overhead_usec);
+
+    /** Estimated job duration.
+     * @param bytes - transferred bytes.
+     * @return duration in nanoseconds.
+     */
+    uint64_t cost(size_t bytes) const;
+
+    /** Utilisation reserved by admitted periodic jobs. */
+    float admittedUtilisation();
+
+    /** Measured bus utilisation: time spent in jobs over time since last statistics reset. */
+    float utilisation();
+
+    /** Amount of jobs finished after their deadline or not run before next release. */
+    uint64_t deadlineMisses();
+
+    /** Get device counters since last statistics reset.
+     * @param device_address - device address
+     * @param jobs - finished jobs
+     * @param misses - deadline misses
+     * @param throughput - estimated bytes per second
+     * @return 0 on success or negative value on error
+     */
+    int getDeviceStatistics(uint8_t device_address, uint64_t &jobs, uint64_t &misses, float &throughput);
+
+    /** Reset counters. */
+    void resetStatistics();
+
+private:
+    struct Job {
+        int id;
+        uint8_t address;
+        uint64_t period;    /**< 0 for one-off job. */
+        uint64_t relative_deadline;
+        uint64_t cost;
+        size_t bytes;
+        Work work;
+        Completion completion;
+        uint64_t release;
+        uint64_t deadline;
+        bool ready;
+        bool removed;
+    };
+
+    struct Device {
+        uint64_t jobs;
+        uint64_t misses;
+        uint64_t bytes;
+    };
+
+    I2CBus *_i2c;
+    Poller *_ep;
+    uint64_t _byte_nsec;
+    std::atomic<uint64_t> _overhead_nsec; /**< read by cost() outside of _mutex */
+    float _bound;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::vector<Job*> _periodic;
+    std::vector<Job*> _oneoff;
+    Job *_running;
+    int _next_id;
+    bool _run;
+
+    uint64_t _busy;
+    uint64_t _misses;
+    uint64_t _statistics_start;
+    Device _devices[128];
+
+    std::thread _worker;
+
+    float _periodicUtilisation() const;
+    bool _blockingFeasible(uint64_t cost, uint64_t deadline) const;
+    Job* _next(uint64_t now, uint64_t &wakeup);
+    void _finish(Job *job, uint64_t start, uint64_t finish);
+    void _work();
+};
+
+#endif // I2CSCHEDULER_H
@@ -2,8 +2,15 @@
 
 #include "poller.h"
 #include "timer.h"
-#include "i2c.h"
+#include "i2cbus.h"
+#include "i2casync.h"
+#include "gpio.h"
+#include "convert.h"
 #include "log.h"
+#include "utils.h"
+
+#include <time.h>
+#include <unistd.h>
 
 #define L3GD20H_RA_WHO_AM_I             0x0F
 #define L3GD20H_RA_CTRL1                0x20
@@ -40,6 +47,11 @@
 #define L3GD20H_CTRL1_FLAG_Z_EN         0x04
 #define L3GD20H_CTRL1_FLAG_POWER_EN     0x08
 
+#define L3GD20H_CTRL3_FLAG_INT2_EMPTY   0x01
+#define L3GD20H_CTRL3_FLAG_INT2_ORUN    0x02
+#define L3GD20H_CTRL3_FLAG_INT2_FTH     0x04
+#define L3GD20H_CTRL3_FLAG_INT2_DRDY    0x08
+
 #define L3GD20H_CTRL5_FLAG_HPF_EN       0x10
 #define L3GD20H_CTRL5_FLAG_FTH_EN       0x20
 #define L3GD20H_CTRL5_FLAG_FIFO_EN      0x40
@@ -73,30 +85,85 @@
 
 #define L3GD20H_AUTOINCREMENT           0x80
 
+#define L3GD20H_BOOT_MSEC               10
+
+static const float _range_scale[] = {
+    245.0f / 65535.0f,
+    500.0f / 65535.0f,
+    2000.0f / 65535.0f
+};
+
 L3GD20H::L3GD20H():
-    L3GD20H(L3GD20H_DEFAULT_ADDRESS, I2C::getDefault(), Poller::getDefault())
+    L3GD20H(L3GD20H_DEFAULT_ADDRESS, I2CBus::getDefault(), Poller::getDefault())
+{
+}
+
+L3GD20H::L3GD20H(uint8_t address, I2CBus *bus, Poller *event_poller):
+    _state(NotReady), _i2c(bus), _async(nullptr), _timer(new Timer(event_poller)), _int2(nullptr),
+    _address(address), _range(L3GD20H_RANGE_245), _scale(_range_scale[L3GD20H_RANGE_245]),
+    _sample_period(10000000), _last_timestamp(0), _watermark(16), _reading(false),
+    _edges(0), _watchdog_edges(0)
 {
+    _timer->onTimeout = std::bind(&L3GD20H::_onTimer, this);
 }
 
-L3GD20H::L3GD20H(uint8_t address, I2C *bus, Poller *event_poller):
-    _state(NotReady), _i2c(bus), _timer(new Timer(event_poller)),
-    _address(address), _range(L3GD20H_RANGE_245)
+L3GD20H::L3GD20H(uint8_t address, I2CAsync *bus, Poller *event_poller):
+    _state(NotReady), _i2c(bus->bus()), _async(bus), _timer(new Timer(event_poller)), _int2(nullptr),
+    _address(address), _range(L3GD20H_RANGE_245), _scale(_range_scale[L3GD20H_RANGE_245]),
+    _sample_period(10000000), _last_timestamp(0), _watermark(16), _reading(false),
+    _edges(0), _watchdog_edges(0)
 {
-    _timer->onTimeout = std::bind(&L3GD20H::_readData, this);
+    _timer->onTimeout = std::bind(&L3GD20H::_onTimer, this);
 }
 
 L3GD20H::~L3GD20H()
 {
+    if (_int2 != nullptr) {
+        _int2->onEdge = nullptr;
+    }
     delete _timer; _timer = nullptr;
 }
 
 int L3GD20H::initialize()
+{
+    if (_state == Booting || _state == Running) {
+        Error() << "Unable to initialize device that in use";
+        return -1;
+    }
+    if (_reset() < 0) {
+        return -1;
+    }
+    usleep(L3GD20H_BOOT_MSEC * 1000);
+    return _configure();
+}
+
+int L3GD20H::initializeAsync(std::function<void(int)> callback)
+{
+    if (_state == Booting || _state == Running) {
+        Error() << "Unable to initialize device that in use";
+        return -1;
+    }
+    if (_reset() < 0) {
+        return -1;
+    }
+    _initialized = callback;
+    _state = Booting;
+    _timer->singleShot(L3GD20H_BOOT_MSEC);
+    return 0;
+}
+
+int L3GD20H::_reset()
 {
     if (_i2c->writeByte(_address, L3GD20H_RA_LOW_ODR, L3GD20H_LOW_ODR_FLAG_SW_RES) < 0) {
         Error() << "Unable to turn on device, device communication error";
         return -1;
     }
+    _state = NotReady;
+    return 0;
+}
 
+int L3GD20H::_configure()
+{
     uint8_t data;
     if (_i2c->readByte(_address, L3GD20H_RA_WHO_AM_I, data) < 0) {
         Error() << "Who am i check failed, device communication error";
@@ -131,14 +198,39 @@ int L3GD20H::setRange(uint8_t range)
         Error() << "Device is not ready";
         return -1;
     }
-    if (range < 0 && range > 3) {
+    if (range > L3GD20H_RANGE_2000) {
         Error() << "Invalid range" << range;
+        return -1;
     }
     uint8_t data = range << 4;
     if (_i2c->writeByte(_address, L3GD20H_RA_CTRL4, data) < 0) {
-        Error() << "Unable to set range, device communication problem";;
+        Error() << "Unable to set range, device communication problem";
+        return -1;
     }
     _range = range;
+    _scale = _range_scale[range];
+    return 0;
+}
+
+int L3GD20H::setInterrupt(GPIO *int2, uint8_t watermark)
+{
+    if (_state == Running) {
+        Error() << "Unable to change interrupt mode while running";
+        return -1;
+    }
+    if (watermark == 0 || watermark > 31) {
+        Error() << "Wrong watermark value" << watermark;
+        return -1;
+    }
+
+    if (_int2 != nullptr) {
+        _int2->onEdge = nullptr;
+    }
+    _int2 = int2;
+    _watermark = watermark;
+    if (_int2 != nullptr) {
+        _int2->onEdge = std::bind(&L3GD20H::_onEdge, this);
+    }
     return 0;
 }
 
@@ -156,33 +248,37 @@ int L3GD20H::start(uint8_t rate, uint8_t bandwidth)
         return -1;
     }
 
+    if (_int2 != nullptr) {
+        if (_i2c->writeByte(_address, L3GD20H_RA_FIFO_CTRL, L3GD20H_FIFO_CTRL_MODE_DS << 5 | _watermark) < 0
+                || _i2c->writeByte(_address, L3GD20H_RA_CTRL5, L3GD20H_CTRL5_FLAG_FIFO_EN | L3GD20H_CTRL5_FLAG_FTH_EN) < 0
+                || _i2c->writeByte(_address, L3GD20H_RA_CTRL3, L3GD20H_CTRL3_FLAG_INT2_FTH) < 0) {
+            Error() << "Unable to setup watermark interrupt, device communication error";
+            return -1;
+        }
+    }
+
     uint8_t data = rate << 6 | bandwidth << 4
             | L3GD20H_CTRL1_FLAG_POWER_EN
             | L3GD20H_CTRL1_FLAG_X_EN
             | L3GD20H_CTRL1_FLAG_Y_EN
             | L3GD20H_CTRL1_FLAG_Z_EN;
 
+    uint64_t write_start = monotonicNsec();
     if (_i2c->writeByte(_address, L3GD20H_RA_CTRL1, data) < 0) {
         Error() << "Unable to start sampling";
         return -1;
     }
 
+    // data rate clock starts with CTRL1 write, timeline counts samples from it
+    _sample_period = 1000000000ull / (100 << rate);
+    _last_timestamp = write_start + (monotonicNsec() - write_start) / 2;
+
+    // polling reads 24 samples per tick, with interrupt the timer is watchdog for two watermarks
+    uint64_t ticks = _int2 != nullptr ? _watermark * 2 : 24;
     timespec interval;
-    interval.tv_sec = 0;
-    switch (rate) {
-    case L3GD20H_RATE_NORMAL:
-        interval.tv_nsec = 1000000000/100*24;
-        break;
-    case L3GD20H_RATE_DOUBLE:
-        interval.tv_nsec = 1000000000/200*24;
-        break;
-    case L3GD20H_RATE_QUAD:
-        interval.tv_nsec = 1000000000/400*24;
-        break;
-    case L3GD20H_RATE_OCTA:
-        interval.tv_nsec = 1000000000/800*24;
-        break;
-    }
+    interval.tv_sec = _sample_period * ticks / 1000000000ull;
+    interval.tv_nsec = _sample_period * ticks % 1000000000ull;
+    _watchdog_edges = _edges;
     _timer->start(interval);
 
     _state = Running;
@@ -202,62 +298,171 @@ int L3GD20H::stop()
         return -1;
     }
 
+    if (_int2 != nullptr && (_i2c->writeByte(_address, L3GD20H_RA_CTRL3, 0) < 0
+            || _i2c->writeByte(_address, L3GD20H_RA_CTRL5, L3GD20H_CTRL5_FLAG_FIFO_EN) < 0
+            || _i2c->writeByte(_address, L3GD20H_RA_FIFO_CTRL, L3GD20H_FIFO_CTRL_MODE_DS << 5) < 0)) {
+        Error() << "Unable to disable watermark interrupt";
+    }
+
     _timer->stop();
     _state = Ready;
 
     return 0;
 }
 
+void L3GD20H::_onTimer()
+{
+    if (_state == Booting) {
+        _state = NotReady;
+        int result = _configure();
+        std::function<void(int)> callback = std::move(_initialized);
+        _initialized = nullptr;
+        if (callback) callback(result);
+        return;
+    }
+
+    if (_int2 != nullptr) {
+        // watchdog: read only if no edge came since previous tick
+        bool lost = (_edges == _watchdog_edges);
+        _watchdog_edges = _edges;
+        if (!lost) {
+            return;
+        }
+    }
+    _read();
+}
+
+void L3GD20H::_onEdge()
+{
+    _edges++;
+    if (_state == Running) {
+        _read();
+    }
+}
+
+void L3GD20H::_read()
+{
+    if (_async != nullptr) {
+        _readDataAsync();
+    } else {
+        _readData();
+    }
+}
+
 void L3GD20H::_readData()
 {
     uint8_t fifo;
+    uint64_t read_start = monotonicNsec();
     if (_i2c->readByte(_address, L3GD20H_RA_FIFO_SRC, fifo) < 0) {
         Error() << "Unable to get fifo control data, device communication error";
         return;
     }
+    uint64_t read_end = monotonicNsec();
 
-    if (fifo & L3GD20H_FIFO_SRC_FLAG_EMPTY) {
-        Debug() << "FIFO is empty";
+    uint8_t size = _checkFifo(fifo);
+    if (size == 0) {
         return;
-    } else if (fifo & L3GD20H_FIFO_SRC_FLAG_OVERRUN) {
-        Debug() << "FIFO overrun";
     }
 
-    uint8_t size = fifo & 0x1F; // last 5 bits is size
     uint8_t data[size * 2 * 3];
     if (_i2c->readBytes(_address, L3GD20H_RA_OUT_X_L | L3GD20H_AUTOINCREMENT, size * 2 * 3, data) < 0) {
         Error() << "Unable to retrive data from fifo, device communication error";
         return;
     }
 
-    for (uint8_t i=0; i<size; i++) {
-        float x,y,z;
-
-        x = (int16_t)(data[i*6+0] | (data[i*6+1] << 8));
-        y = (int16_t)(data[i*6+2] | (data[i*6+3] << 8));
-        z = (int16_t)(data[i*6+4] | (data[i*6+5] << 8));
-        switch (_range) {
-        case L3GD20H_RANGE_245:
-            x *= (245.0f / 65535.0f);
-            y *= (245.0f / 65535.0f);
-            z *= (245.0f / 65535.0f);
-            break;
-        case L3GD20H_RANGE_500:
-            x *= (500.0f / 65535.0f);
-            y *= (500.0f / 65535.0f);
-            z *= (500.0f / 65535.0f);
-            break;
-        case L3GD20H_RANGE_2000:
-            x *= (2000.0f / 65535.0f);
-            y *= (2000.0f / 65535.0f);
-            z *= (2000.0f / 65535.0f);
-            break;
+    _processData(data, size, fifo & L3GD20H_FIFO_SRC_FLAG_OVERRUN, read_start, read_end);
+}
+
+void L3GD20H::_readDataAsync()
+{
+    if (_reading) {
+        // previous read is still queued, data will be taken from FIFO by it
+        return;
+    }
+
+    I2CAsync::Transaction transaction;
+    size_t handle = transaction.readBytes(_address, L3GD20H_RA_FIFO_SRC, 1);
+    uint64_t read_start = monotonicNsec();
+    int result = _async->submit(std::move(transaction), [this, handle, read_start](int result, I2CAsync::Transaction &transaction) {
+        if (result < 0) {
+            Error() << "Unable to get fifo control data, device communication error";
+            _reading = false;
+            return;
         }
+        _readFifoAsync(*transaction.data(handle), read_start, monotonicNsec());
+    }, I2CAsync::PriorityHigh);
+    _reading = (result == 0);
+}
+
+void L3GD20H::_readFifoAsync(uint8_t fifo, uint64_t read_start, uint64_t read_end)
+{
+    uint8_t size = _checkFifo(fifo);
+    if (size == 0 || _state != Running) {
+        _reading = false;
+        return;
+    }
+
+    I2CAsync::Transaction transaction;
+    size_t handle = transaction.readBytes(_address, L3GD20H_RA_OUT_X_L | L3GD20H_AUTOINCREMENT, size * 2 * 3);
+    int result = _async->submit(std::move(transaction), [this, handle, size, fifo, read_start, read_end](int result, I2CAsync::Transaction &transaction) {
+        _reading = false;
+        if (result < 0) {
+            Error() << "Unable to retrive data from fifo, device communication error";
+            return;
+        }
+        if (_state == Running) {
+            _processData(transaction.data(handle), size, fifo & L3GD20H_FIFO_SRC_FLAG_OVERRUN, read_start, read_end);
+        }
+    }, I2CAsync::PriorityHigh);
+    _reading = (result == 0);
+}
+
+uint8_t L3GD20H::_checkFifo(uint8_t fifo)
+{
+    if (fifo & L3GD20H_FIFO_SRC_FLAG_EMPTY) {
+        Debug() << "FIFO is empty";
+        return 0;
+    } else if (fifo & L3GD20H_FIFO_SRC_FLAG_OVERRUN) {
+        WarnLimited(1) << "FIFO overrun";
+    }
+
+    return fifo & 0x1F; // last 5 bits is size
+}
+
+void L3GD20H::_processData(const uint8_t data[], uint8_t size, bool overrun, uint64_t read_start, uint64_t read_end)
+{
+    float *axes[] = {_x, _y, _z};
+    convert(ConvertInt16LE, data, size, 3, _scale, 0.0f, axes);
+
+    // Timeline counts samples on the data rate grid started by CTRL1 write in start().
+    // Newest sample in FIFO was taken within one period before FIFO_SRC was latched during the read,
+    // when the count does not land there (lost samples, clock drift) it moves by whole periods
+    // to the grid point nearest to the middle of that window, so the phase is kept.
+    // Full FIFO reports 31 samples, the newest one is left for the next read.
+    uint64_t earliest = read_start - _sample_period;
+    uint64_t newest = _last_timestamp + size * _sample_period;
+    if (newest <= earliest || newest > read_end) {
+        int64_t shift = (int64_t)((earliest + read_end) / 2 - newest);
+        int64_t half = shift < 0 ? -(int64_t)_sample_period / 2 : (int64_t)_sample_period / 2;
+        newest += (shift + half) / (int64_t)_sample_period * (int64_t)_sample_period;
+    }
+    if (overrun) {
+        newest -= (32 - size) * _sample_period;
+    }
+    for (uint8_t i=0; i<size; i++) {
+        _timestamps[i] = newest - (size - 1 - i) * _sample_period;
+    }
+    _last_timestamp = newest;
 
-        if (onData) {
-            onData(x, y, z);
-        } else {
-            Warn() << "No data callback was set";
+    if (onBlock) {
+        Block block = {size, _x, _y, _z, _timestamps};
+        onBlock(block);
+    }
+    if (onData) {
+        for (uint8_t i=0; i<size; i++) {
+            onData(_x[i], _y[i], _z[i]);
         }
+    } else if (!onBlock) {
+        WarnLimited(1) << "No data callback was set";
     }
 }
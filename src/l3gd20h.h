@@ -20,41 +20,112 @@
 
 
 #include <stdint.h>
+#include <stddef.h>
 #include <functional>
 
 class Poller;
-class I2C;
+class I2CBus;
+class I2CAsync;
 class Timer;
+class GPIO;
 
 class L3GD20H
 {
     enum State {
         NotReady,
+        Booting,
         Ready,
         Running
     };
 
 public:
+    /** Samples of one FIFO read in structure of arrays layout.
+     * Pointers are valid only during onBlock call.
+     */
+    struct Block {
+        size_t size;
+        const float *x;             /**< degrees per second */
+        const float *y;
+        const float *z;
+        const uint64_t *timestamp;  /**< CLOCK_MONOTONIC ns, reconstructed from data rate and read time */
+    };
+
+    /** Per sample callback, degrees per second. */
     std::function<void(float, float, float)> onData;
+    /** Called once per FIFO read with all samples taken, oldest first. */
+    std::function<void(const Block&)> onBlock;
 
     L3GD20H();
-    L3GD20H(uint8_t address, I2C *bus, Poller *event_poller);
+    L3GD20H(uint8_t address, I2CBus *bus, Poller *event_poller);
+    /** Constructor with asynchronous FIFO reads.
+     * Setup is still synchronous, data is read by bus worker so event loop is never blocked by transfer.
+     * Object must outlive transactions submitted to the engine.
+     * @param address - device address
+     * @param bus - asynchronous i2c engine, its poller should be the same as event_poller.
+     * @param event_poller - event poller
+     */
+    L3GD20H(uint8_t address, I2CAsync *bus, Poller *event_poller);
     ~L3GD20H();
 
+    /** Reset device, wait for boot and configure FIFO.
+     * Blocks for boot time, see initializeAsync().
+     * @return 0 on success or negative value on error
+     */
     int initialize();
 
+    /** Initialize device without blocking event loop, boot time is waited for with the driver timer.
+     * @param callback - called from event loop with 0 on success or negative value on error
+     * @return 0 if initialization started or negative value on error, callback is not called then
+     */
+    int initializeAsync(std::function<void(int)> callback);
+
     int setRange(uint8_t range=L3GD20H_RANGE_245);
+
+    /** Read FIFO on watermark interrupt instead of polling it.
+     * Watermark is routed to INT2 pin, FIFO is read when line rises.
+     * Polling timer is kept as a slow watchdog for lost edges.
+     * Must be called before start().
+     * @param int2 - line connected to INT2 pin, nullptr returns to polling
+     * @param watermark - FIFO level which raises INT2, 1..31 samples
+     * @return 0 on success or negative value on error
+     */
+    int setInterrupt(GPIO *int2, uint8_t watermark=16);
+
     int start(uint8_t rate=L3GD20H_RATE_NORMAL, uint8_t bandwidth=L3GD20H_BANDWITH_A);
     int stop();
 
 private:
     State _state;
-    I2C *_i2c;
+    I2CBus *_i2c;
+    I2CAsync *_async;
     Timer *_timer;
+    GPIO *_int2;
     uint8_t _address;
     uint8_t _range;
+    float _scale;
+    uint64_t _sample_period;
+    uint64_t _last_timestamp;
+    uint8_t _watermark;
+    bool _reading;
+    uint64_t _edges;
+    uint64_t _watchdog_edges;
+    std::function<void(int)> _initialized;
 
+    int _reset();
+    int _configure();
+    void _onTimer();
+    void _onEdge();
+    void _read();
     void _readData();
+    void _readDataAsync();
+    void _readFifoAsync(uint8_t fifo, uint64_t read_start, uint64_t read_end);
+    uint8_t _checkFifo(uint8_t fifo);
+    void _processData(const uint8_t data[], uint8_t size, bool overrun, uint64_t read_start, uint64_t read_end);
+
+    float _x[32];
+    float _y[32];
+    float _z[32];
+    uint64_t _timestamps[32];
 };
 
 #endif
@@ -1,4 +1,356 @@
 #include "log.h"
+#include "logring.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef LogRing<MessageRecord, 64 * 1024> MessageRing;
+
+/** Records drained from per thread rings are formatted here and written with write(2). */
+class LogBackend
+{
+public:
+    static LogBackend *instance()
+    {
+        // Never destroyed: messages could be logged from static destructors.
+        static LogBackend *backend = new LogBackend();
+        return backend;
+    }
+
+    void commit(const MessageRecord &record, const uint8_t *payload)
+    {
+        MessageRing *ring = _threadRing();
+        if (ring == nullptr || !_running.load(std::memory_order_acquire)) {
+            // Logger thread is gone (process exit) or calling thread is being torn down.
+            std::lock_guard<std::mutex> lock(_mutex);
+            _drain();
+            _format(record, payload);
+            _flushOutput();
+            return;
+        }
+
+        if (!ring->push(record, payload, record.size)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        // only the first record after logger thread went idle pays for the wakeup
+        if (_sleeping.load(std::memory_order_relaxed) && _sleeping.exchange(false)) {
+            _wakeup.notify_one();
+        }
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (!_running.load(std::memory_order_acquire)) {
+            _drain();
+            return;
+        }
+        // logger thread drains with mutex held, so the next pass starts after this point
+        uint64_t pass = _pass;
+        _wakeup.notify_one();
+        _drained.wait(lock, [this, pass]() { return _pass > pass || !_running.load(); });
+    }
+
+    uint64_t dropped() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    LogBackend(): _running(true), _sleeping(false), _dropped(0), _pass(0), _length(0)
+    {
+        _thread = std::thread(&LogBackend::_run, this);
+        atexit(&LogBackend::_stop);
+    }
+
+    static void _stop()
+    {
+        LogBackend *backend = instance();
+        {
+            std::lock_guard<std::mutex> lock(backend->_mutex);
+            backend->_running.store(false, std::memory_order_release);
+        }
+        backend->_wakeup.notify_one();
+        backend->_thread.join();
+
+        std::lock_guard<std::mutex> lock(backend->_mutex);
+        backend->_drain();
+    }
+
+    MessageRing *_threadRing()
+    {
+        static thread_local MessageRing *ring = nullptr;
+        static thread_local bool exited = false;
+
+        struct Release {
+            MessageRing *&ring;
+            bool &exited;
+            ~Release() {
+                if (ring != nullptr) {
+                    ring->released.store(true, std::memory_order_release);
+                    ring = nullptr;
+                }
+                exited = true;
+            }
+        };
+
+        if (ring != nullptr || exited) {
+            return ring;
+        }
+
+        static thread_local Release release{ring, exited};
+        (void)release;
+
+        ring = new MessageRing();
+        std::lock_guard<std::mutex> lock(_mutex);
+        _rings.push_back(ring);
+        return ring;
+    }
+
+    void _run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (_running.load(std::memory_order_acquire)) {
+            _drain();
+            _pass++;
+            _drained.notify_all();
+
+            _sleeping.store(true);
+            if (!_pending()) {
+                // timeout covers notify racing with going to sleep
+                _wakeup.wait_for(lock, std::chrono::milliseconds(50));
+            }
+            _sleeping.store(false);
+        }
+        _drained.notify_all();
+    }
+
+    bool _pending() const
+    {
+        for (MessageRing *ring: _rings) {
+            if (!ring->empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Merge rings by record timestamp, must be called with mutex held. */
+    void _drain()
+    {
+        MessageRecord record;
+        uint8_t payload[Message::PayloadCapacity];
+
+        for (;;) {
+            MessageRing *oldest = nullptr;
+            MessageRecord oldest_record;
+            for (MessageRing *ring: _rings) {
+                if (ring->peek(record) && (oldest == nullptr || record.timestamp < oldest_record.timestamp)) {
+                    oldest = ring;
+                    oldest_record = record;
+                }
+            }
+            if (oldest == nullptr) {
+                break;
+            }
+            oldest->pop(payload, oldest_record.size);
+            _format(oldest_record, payload);
+        }
+
+        for (size_t i=0; i<_rings.size();) {
+            MessageRing *ring = _rings[i];
+            size_t dropped = ring->takeDropped();
+            if (dropped > 0) {
+                char line[64];
+                int length = snprintf(line, sizeof(line), "log: %zu messages dropped\n", dropped);
+                _append(line, length);
+            }
+            if (ring->released.load(std::memory_order_acquire) && ring->empty()) {
+                _rings[i] = _rings.back();
+                _rings.pop_back();
+                delete ring;
+            } else {
+                i++;
+            }
+        }
+        _flushOutput();
+    }
+
+    void _format(const MessageRecord &record, const uint8_t *payload)
+    {
+        char line[256];
+        int length = snprintf(line, sizeof(line), "[%" PRIu64 ".%06" PRIu64 "] %s:%d %s(): ",
+                              (uint64_t)(record.timestamp / 1000000000ull), (uint64_t)(record.timestamp % 1000000000ull / 1000),
+                              record.file, record.line, record.function);
+        _append(line, length < (int)sizeof(line) ? length : sizeof(line) - 1);
+
+        size_t position = 0;
+        while (position < record.size) {
+            uint8_t tag = payload[position++];
+            const uint8_t *value = payload + position;
+            length = 0;
+            switch (tag) {
+            case Message::TagSpace:
+                _append(" ", 1);
+                break;
+            case Message::TagBool:
+                length = snprintf(line, sizeof(line), "%s", *value ? "true" : "false");
+                position += 1;
+                break;
+            case Message::TagChar:
+                _append((const char*)value, 1);
+                position += 1;
+                break;
+            case Message::TagInt32: {
+                int32_t v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%" PRId32, v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagUInt32: {
+                uint32_t v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%" PRIu32, v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagInt64: {
+                int64_t v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%" PRId64, v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagUInt64: {
+                uint64_t v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%" PRIu64, v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagFloat: {
+                float v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%g", v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagDouble: {
+                double v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%g", v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagString: {
+                uint16_t size;
+                memcpy(&size, value, sizeof(size));
+                _append((const char*)value + sizeof(size), size);
+                position += sizeof(size) + size;
+                break;
+            }
+            case Message::TagPointer: {
+                const void *v;
+                memcpy(&v, value, sizeof(v));
+                length = snprintf(line, sizeof(line), "%p", v);
+                position += sizeof(v);
+                break;
+            }
+            case Message::TagTruncated:
+                _append("...", 3);
+                break;
+            default:
+                position = record.size;
+                break;
+            }
+            if (length > 0) {
+                _append(line, length);
+            }
+        }
+        if (record.suppressed > 0) {
+            length = snprintf(line, sizeof(line), "(%" PRIu32 " similar messages suppressed)", record.suppressed);
+            _append(line, length);
+        }
+        _append("\n", 1);
+    }
+
+    void _append(const char *data, size_t size)
+    {
+        if (_length + size > sizeof(_output)) {
+            _flushOutput();
+        }
+        if (size > sizeof(_output)) {
+            size = sizeof(_output);
+        }
+        memcpy(_output + _length, data, size);
+        _length += size;
+    }
+
+    void _flushOutput()
+    {
+        size_t written = 0;
+        while (written < _length) {
+            ssize_t result = write(STDERR_FILENO, _output + written, _length - written);
+            if (result <= 0) {
+                break;
+            }
+            written += result;
+        }
+        _length = 0;
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::condition_variable _drained;
+    std::thread _thread;
+    std::vector<MessageRing*> _rings;
+    std::atomic<bool> _running;
+    std::atomic<bool> _sleeping;
+    std::atomic<uint64_t> _dropped;
+    uint64_t _pass;
+    char _output[8192];
+    size_t _length;
+};
+
+}
+
+std::atomic<int> Logger::_level(MessageDebug);
+
+MessageRateLimit::Decision MessageRateLimit::check(uint32_t per_second)
+{
+    uint32_t second = monotonicNsec() / 1000000000ull;
+
+    // window start races between threads only shift the budget by a few messages
+    if (_window.load(std::memory_order_relaxed) != second) {
+        _window.store(second, std::memory_order_relaxed);
+        _count.store(0, std::memory_order_relaxed);
+    }
+
+    Decision decision{false, 0};
+    if (_count.fetch_add(1, std::memory_order_relaxed) < per_second) {
+        decision.suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+    } else {
+        _suppressed.fetch_add(1, std::memory_order_relaxed);
+        decision.drop = true;
+    }
+    return decision;
+}
+
+void Message::_commit()
+{
+    LogBackend::instance()->commit(_record, _payload);
+}
 
 Message MessageLogger::debug() const
 {
@@ -20,4 +372,12 @@ Message MessageLogger::error() const
     return Message(context, MessageType::MessageError);
 }
 
+void Logger::flush()
+{
+    LogBackend::instance()->flush();
+}
 
+uint64_t Logger::dropped()
+{
+    return LogBackend::instance()->dropped();
+}
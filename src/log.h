@@ -1,9 +1,19 @@
 #ifndef LOG_H
 #define LOG_H
 
-#include "iostream"
-#include "sstream"
-#include "string"
+#include "utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/** Lowest level compiled in, messages below it compile to nothing.
+ * 0 - debug, 1 - info, 2 - warn, 3 - error. Set from CMake with NAVIO_LOG_LEVEL.
+ */
+#ifndef NAVIO_LOG_LEVEL
+#define NAVIO_LOG_LEVEL 0
+#endif
 
 enum MessageType {
     MessageDebug,
@@ -22,52 +32,161 @@ public:
     const char *_function;
 };
 
-class Message
+/** Binary log record header.
+ * Call site is kept as pointers to string literals, arguments follow the header as tagged raw values.
+ * Formatting happens in logger thread.
+ */
+struct MessageRecord
 {
-    struct Stream {
-        Stream(const MessageContext &ctx, MessageType type)
-            : ref(1), space(true), ss(), context(ctx), type(type){}
-        int ref;
-        bool space;
-        std::stringstream ss;
-        MessageContext context;
-        MessageType type;
-    } *stream;
+    uint64_t timestamp;     /**< CLOCK_MONOTONIC, nanoseconds */
+    const char *file;
+    const char *function;
+    int32_t line;
+    uint32_t suppressed;    /**< messages dropped by call site rate limit since previous one */
+    uint16_t size;          /**< payload size in bytes */
+    uint8_t type;
+    uint8_t reserved;
+};
 
+/** Log message.
+ * Arguments are stored in place without formatting, record is handed to per thread ring on destruction.
+ * No allocation happens on this path once calling thread has logged at least once.
+ */
+class Message
+{
 public:
-    inline Message(const MessageContext &context, MessageType type) : stream(new Stream(context, type)) {}
-    inline Message(const Message &o):stream(o.stream) { ++stream->ref; }
-    inline Message &operator=(const Message &other);
+    enum {
+        PayloadCapacity = 192   /**< argument bytes per message, longer messages are truncated */
+    };
+
+    enum Tag {
+        TagSpace,
+        TagBool,
+        TagChar,
+        TagInt32,
+        TagUInt32,
+        TagInt64,
+        TagUInt64,
+        TagFloat,
+        TagDouble,
+        TagString,
+        TagPointer,
+        TagTruncated
+    };
+
+    inline Message(const MessageContext &context, MessageType type):
+        _record(), _space(true), _active(true), _truncated(false)
+    {
+        _record.timestamp = monotonicNsec();
+        _record.file = context._file;
+        _record.function = context._function;
+        _record.line = context._line;
+        _record.suppressed = 0;
+        _record.size = 0;
+        _record.type = type;
+    }
+    inline Message(Message &&other):
+        _record(other._record), _space(other._space), _active(other._active), _truncated(other._truncated)
+    {
+        memcpy(_payload, other._payload, _record.size);
+        other._active = false;
+    }
+    Message(const Message &that) = delete;  /**< Copy contructor is not allowed because record is committed once. */
+    Message &operator=(const Message &that) = delete;
+
     inline ~Message() {
-        if (!--stream->ref) {
-            std::cerr << stream->context._file << ":";
-            std::cerr << stream->context._line << " ";
-            std::cerr << stream->context._function << "(): ";
-            std::cerr << stream->ss.str() << std::endl;
-            delete stream;
+        if (_active) {
+            _commit();
         }
     }
 
-    inline Message &space() { stream->space = true; stream->ss << ' '; return *this; }
-    inline Message &nospace() { stream->space = false; return *this; }
-    inline Message &maybeSpace() { if (stream->space) stream->ss << ' '; return *this; }
-
-    bool autoInsertSpaces() const { return stream->space; }
-    void setAutoInsertSpaces(bool b) { stream->space = b; }
-
-    inline Message &operator<<(bool t) { stream->ss << (t ? "true" : "false"); return maybeSpace(); }
-    inline Message &operator<<(char t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(signed short t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(unsigned short t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(signed int t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(unsigned int t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(signed long t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(unsigned long t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(unsigned long long t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(float t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(double t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(const char* t) { stream->ss << t; return maybeSpace(); }
-    inline Message &operator<<(const void * t) { stream->ss << t; return maybeSpace(); }
+    inline Message &space() { _space = true; return _putTag(TagSpace); }
+    inline Message &nospace() { _space = false; return *this; }
+    inline Message &maybeSpace() { return _space ? _putTag(TagSpace) : *this; }
+
+    /** Attach amount of messages suppressed at this call site, printed after the arguments. */
+    inline Message &suppressed(uint32_t count) { _record.suppressed = count; return *this; }
+
+    bool autoInsertSpaces() const { return _space; }
+    void setAutoInsertSpaces(bool b) { _space = b; }
+
+    inline Message &operator<<(bool t) { return _put(TagBool, (uint8_t)t).maybeSpace(); }
+    inline Message &operator<<(char t) { return _put(TagChar, t).maybeSpace(); }
+    inline Message &operator<<(signed short t) { return _put(TagInt32, (int32_t)t).maybeSpace(); }
+    inline Message &operator<<(unsigned short t) { return _put(TagUInt32, (uint32_t)t).maybeSpace(); }
+    inline Message &operator<<(signed int t) { return _put(TagInt32, (int32_t)t).maybeSpace(); }
+    inline Message &operator<<(unsigned int t) { return _put(TagUInt32, (uint32_t)t).maybeSpace(); }
+    inline Message &operator<<(signed long t) { return _put(TagInt64, (int64_t)t).maybeSpace(); }
+    inline Message &operator<<(unsigned long t) { return _put(TagUInt64, (uint64_t)t).maybeSpace(); }
+    inline Message &operator<<(unsigned long long t) { return _put(TagUInt64, (uint64_t)t).maybeSpace(); }
+    inline Message &operator<<(float t) { return _put(TagFloat, t).maybeSpace(); }
+    inline Message &operator<<(double t) { return _put(TagDouble, t).maybeSpace(); }
+    inline Message &operator<<(const char* t) { _putString(t); return maybeSpace(); }
+    inline Message &operator<<(const void * t) { return _put(TagPointer, t).maybeSpace(); }
+
+private:
+    inline Message &_putTag(Tag tag)
+    {
+        if (_truncated || _record.size + 1 > PayloadCapacity - 1) {
+            _truncate();
+            return *this;
+        }
+        _payload[_record.size++] = tag;
+        return *this;
+    }
+
+    /** Fixed size values keep memcpy a plain store. */
+    template<typename T>
+    inline Message &_put(Tag tag, T value)
+    {
+        if (_truncated || _record.size + 1 + sizeof(T) > PayloadCapacity - 1) {
+            _truncate();
+            return *this;
+        }
+        _payload[_record.size++] = tag;
+        memcpy(_payload + _record.size, &value, sizeof(T));
+        _record.size += sizeof(T);
+        return *this;
+    }
+
+    inline void _putString(const char *t)
+    {
+        if (t == nullptr) {
+            t = "(null)";
+        }
+        size_t length = strlen(t);
+        size_t room = PayloadCapacity - 1 - _record.size;
+        if (_truncated || room < 1 + sizeof(uint16_t)) {
+            _truncate();
+            return;
+        }
+        room -= 1 + sizeof(uint16_t);
+        uint16_t stored = length < room ? length : room;
+        _payload[_record.size++] = TagString;
+        memcpy(_payload + _record.size, &stored, sizeof(stored));
+        memcpy(_payload + _record.size + sizeof(stored), t, stored);
+        _record.size += sizeof(stored) + stored;
+        if (stored < length) {
+            _truncate();
+        }
+    }
+
+    /** Last payload byte is reserved for truncation mark. */
+    inline void _truncate()
+    {
+        if (!_truncated) {
+            _truncated = true;
+            _payload[_record.size++] = TagTruncated;
+        }
+    }
+
+    void _commit();
+
+    MessageRecord _record;
+    bool _space;
+    bool _active;
+    bool _truncated;
+    uint8_t _payload[PayloadCapacity];
 };
 
 class MessageLogger
@@ -85,9 +204,78 @@ private:
     MessageContext context;
 };
 
-#define Debug MessageLogger(__LINE__, __FILE__, __FUNCTION__).debug
-#define Info  MessageLogger(__LINE__, __FILE__, __FUNCTION__).info
-#define Warn  MessageLogger(__LINE__, __FILE__, __FUNCTION__).warn
-#define Error MessageLogger(__LINE__, __FILE__, __FUNCTION__).error
+/** Per call site rate limit, at most given amount of messages per second.
+ * Created by the *Limited macros, one static instance per call site.
+ */
+class MessageRateLimit
+{
+public:
+    struct Decision {
+        bool drop;
+        uint32_t suppressed;    /**< messages dropped since last passed one */
+        explicit operator bool() const { return drop; }
+    };
+
+    MessageRateLimit(): _window(0), _count(0), _suppressed(0) {}
+    MessageRateLimit(const MessageRateLimit& that) = delete;
+
+    /** @param per_second - messages allowed within one second window */
+    Decision check(uint32_t per_second);
+
+private:
+    std::atomic<uint32_t> _window;     /**< CLOCK_MONOTONIC second of current window */
+    std::atomic<uint32_t> _count;
+    std::atomic<uint32_t> _suppressed;
+};
+
+/** Logger back end.
+ * Each thread owns a lock-free ring of binary records, background thread merges them by
+ * timestamp, formats and writes to stderr. Records which do not fit into a full ring are
+ * dropped and reported by the logger thread.
+ */
+class Logger
+{
+public:
+    /** Block until every record committed before this call is written. */
+    static void flush();
+
+    /** @return total amount of dropped records. */
+    static uint64_t dropped();
+
+    /** Set runtime threshold, messages below it are skipped before arguments are evaluated.
+     * @param type - lowest level which is logged
+     */
+    static void setLevel(MessageType type) { _level.store(type, std::memory_order_relaxed); }
+    static MessageType level() { return (MessageType)_level.load(std::memory_order_relaxed); }
+
+    static bool enabled(MessageType type)
+    {
+        return type >= NAVIO_LOG_LEVEL && type >= _level.load(std::memory_order_relaxed);
+    }
+
+private:
+    static std::atomic<int> _level;
+};
+
+/* Dangling else safe: "if (x) Warn() << ...; else ..." keeps the user's else. */
+#define NAVIO_LOG(type, method) \
+    if (!Logger::enabled(type)) {} else MessageLogger(__LINE__, __FILE__, __FUNCTION__).method
+
+#define NAVIO_LOG_LIMITED(type, method, per_second) \
+    if (!Logger::enabled(type)) {} \
+    else if (MessageRateLimit::Decision _navio_log_decision = \
+             []() -> MessageRateLimit& { static MessageRateLimit limit; return limit; }().check(per_second)) {} \
+    else MessageLogger(__LINE__, __FILE__, __FUNCTION__).method().suppressed(_navio_log_decision.suppressed)
+
+#define Debug NAVIO_LOG(MessageDebug, debug)
+#define Info  NAVIO_LOG(MessageInfo, info)
+#define Warn  NAVIO_LOG(MessageWarn, warn)
+#define Error NAVIO_LOG(MessageError, error)
+
+/* Rate limited call sites, e.g. WarnLimited(1) << "overrun"; */
+#define DebugLimited(per_second) NAVIO_LOG_LIMITED(MessageDebug, debug, per_second)
+#define InfoLimited(per_second)  NAVIO_LOG_LIMITED(MessageInfo, info, per_second)
+#define WarnLimited(per_second)  NAVIO_LOG_LIMITED(MessageWarn, warn, per_second)
+#define ErrorLimited(per_second) NAVIO_LOG_LIMITED(MessageError, error, per_second)
 
 #endif
@@ -0,0 +1,104 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/** Bounded lock-free single producer single consumer byte ring.
+ * Holds variable sized log records, each one header followed by payload.
+ * Producer never waits: record which does not fit is dropped and counted.
+ * Capacity must be power of two.
+ */
+template<typename Header, size_t Capacity>
+class LogRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "LogRing capacity must be power of two");
+
+public:
+    LogRing(): released(false), _head(0), _padding(), _tail(0), _dropped(0) {}
+    LogRing(const LogRing& that) = delete;  /**< Copy contructor is not allowed. */
+
+    /** Append record, must be called from producer thread only.
+     * @param header - record header
+     * @param payload - record payload
+     * @param size - payload size
+     * @return false if ring has no room for the record.
+     */
+    bool push(const Header &header, const void *payload, size_t size)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t record = sizeof(Header) + size;
+        if (head - _tail.load(std::memory_order_acquire) + record > Capacity) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        _copyIn(head, &header, sizeof(Header));
+        _copyIn(head + sizeof(Header), payload, size);
+        _head.store(head + record, std::memory_order_release);
+        return true;
+    }
+
+    /** Read header of the oldest record, must be called from consumer thread only.
+     * @return false if ring is empty.
+     */
+    bool peek(Header &header) const
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        _copyOut(tail, &header, sizeof(Header));
+        return true;
+    }
+
+    /** Remove oldest record returned by peek(), must be called from consumer thread only.
+     * @param payload - buffer for record payload
+     * @param size - payload size stored in the header
+     */
+    void pop(void *payload, size_t size)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        _copyOut(tail + sizeof(Header), payload, size);
+        _tail.store(tail + sizeof(Header) + size, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+    /** @return records dropped since last call. */
+    size_t takeDropped()
+    {
+        return _dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> released;     /**< Producer thread has exited, ring is freed once drained. */
+
+private:
+    void _copyIn(size_t position, const void *data, size_t size)
+    {
+        size_t offset = position & (Capacity - 1);
+        size_t first = size < Capacity - offset ? size : Capacity - offset;
+        memcpy(_data + offset, data, first);
+        memcpy(_data, static_cast<const uint8_t*>(data) + first, size - first);
+    }
+
+    void _copyOut(size_t position, void *data, size_t size) const
+    {
+        size_t offset = position & (Capacity - 1);
+        size_t first = size < Capacity - offset ? size : Capacity - offset;
+        memcpy(data, _data + offset, first);
+        memcpy(static_cast<uint8_t*>(data) + first, _data, size - first);
+    }
+
+    std::atomic<size_t> _head;
+    char _padding[64];
+    std::atomic<size_t> _tail;
+    std::atomic<size_t> _dropped;
+    uint8_t _data[Capacity];
+};
+
+#endif // LOGRING_H
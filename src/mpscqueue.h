@@ -0,0 +1,103 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <utility>
+
+/** Bounded lock-free multi producer single consumer queue.
+ * Ring of cells with per cell sequence counters (D. Vyukov bounded queue).
+ * Producers reserve a cell with one CAS, consumer never blocks producers.
+ * Capacity is rounded up to power of two.
+ */
+template<typename T>
+class MPSCQueue
+{
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+public:
+    /** Constructor.
+     * @param capacity - maximum amount of queued items.
+     */
+    explicit MPSCQueue(size_t capacity):
+        _cells(nullptr), _mask(0), _head(0), _tail(0)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _mask = size - 1;
+        _cells = new Cell[size];
+        for (size_t i=0; i<size; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MPSCQueue(const MPSCQueue& that) = delete;  /**< Copy contructor is not allowed. */
+
+    ~MPSCQueue()
+    {
+        delete [] _cells; _cells = nullptr;
+    }
+
+    /** Enqueue item, could be called from any thread.
+     * @return false if queue is full.
+     */
+    bool push(T &&item)
+    {
+        Cell *cell;
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Dequeue item, must be called from consumer thread only.
+     * @return false if queue is empty.
+     */
+    bool pop(T &item)
+    {
+        Cell *cell = &_cells[_head & _mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(_head + 1) < 0) {
+            return false;
+        }
+        item = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    /** Queue capacity. */
+    size_t capacity() const
+    {
+        return _mask + 1;
+    }
+
+private:
+    Cell *_cells;
+    size_t _mask;
+    size_t _head;
+    char _padding[64];
+    std::atomic<size_t> _tail;
+};
+
+#endif // MPSCQUEUE_H
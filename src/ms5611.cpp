@@ -1,22 +1,90 @@
 #include "ms5611.h"
-#include "i2c.h"
+#include "i2cbus.h"
+#include "i2cbatch.h"
 #include "timer.h"
 #include "log.h"
+#include "utils.h"
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <cassert>
-#include <cmath>
 
 #define MS5611_REG_ADC          0x00
 #define MS5611_REG_PROM         0xA0
-#define MS5611_REG_TEMPERATURE  0x40
-#define MS5611_REG_PRESSURE     0x50
+#define MS5611_REG_TEMPERATURE  0x50
+#define MS5611_REG_PRESSURE     0x40
 #define MS5611_REG_RESET        0x1E
 
+#define MS5611_RESET_NSEC       2800000
+
 static const float _delays_ms[] = { 1, 2, 3, 5, 10 };
+/* Datasheet maximum conversion times */
+static const uint64_t _conversion_ns[] = { 600000, 1170000, 2280000, 4540000, 9040000 };
+
+/* Powers of two used by datasheet compensation formulas. */
+enum Shift {
+    ShiftTREF,      /**< dT = D2 - C5 * 2^8 */
+    ShiftTEMPSENS,  /**< TEMP = 2000 + dT * C6 / 2^23 */
+    ShiftOFFT1,     /**< OFF = C2 * 2^16 + ... */
+    ShiftTCO,       /**< ... + C4 * dT / 2^7 */
+    ShiftSENST1,    /**< SENS = C1 * 2^15 + ... */
+    ShiftTCS,       /**< ... + C3 * dT / 2^8 */
+    ShiftT2,        /**< T2 = dT^2 / 2^31 */
+    ShiftSENS,      /**< P = (D1 * SENS / 2^21 - OFF) / 2^15 */
+    ShiftP
+};
+
+static constexpr uint8_t _shifts[] = { 8, 23, 16, 7, 15, 8, 31, 21, 15 };
+
+MS5611::Calibration::Calibration():
+    coefficients(), _tref(0), _offt1(0), _senst1(0), _tco(0), _tcs(0), _tempsens(0)
+{
+}
+
+void MS5611::Calibration::set(const uint16_t c[6])
+{
+    memcpy(coefficients, c, sizeof(coefficients));
+    _senst1 = (int64_t)c[0] << _shifts[ShiftSENST1];
+    _offt1 = (int64_t)c[1] << _shifts[ShiftOFFT1];
+    _tcs = c[2];
+    _tco = c[3];
+    _tref = (int32_t)c[4] << _shifts[ShiftTREF];
+    _tempsens = c[5];
+}
+
+void MS5611::Calibration::compensate(uint32_t raw_temperature, uint32_t raw_pressure,
+                                     int32_t &temperature, int32_t &pressure) const
+{
+    int64_t dT = (int32_t)raw_temperature - _tref;
+    int64_t temp = 2000 + ((dT * _tempsens) >> _shifts[ShiftTEMPSENS]);
+    int64_t off = _offt1 + ((_tco * dT) >> _shifts[ShiftTCO]);
+    int64_t sens = _senst1 + ((_tcs * dT) >> _shifts[ShiftTCS]);
+
+    if (temp < 2000) {
+        // second order compensation below 20 Celsius
+        int64_t low = (temp - 2000) * (temp - 2000);
+        int64_t t2 = (dT * dT) >> _shifts[ShiftT2];
+        int64_t off2 = (5 * low) >> 1;
+        int64_t sens2 = (5 * low) >> 2;
+        if (temp < -1500) {
+            int64_t very_low = (temp + 1500) * (temp + 1500);
+            off2 += 7 * very_low;
+            sens2 += (11 * very_low) >> 1;
+        }
+        temp -= t2;
+        off -= off2;
+        sens -= sens2;
+    }
+
+    temperature = temp;
+    pressure = ((((int64_t)raw_pressure * sens) >> _shifts[ShiftSENS]) - off) >> _shifts[ShiftP];
+}
 
 MS5611::MS5611():
-    MS5611(MS5611_I2C_ADDRESS, I2C::getDefault(), Poller::getDefault())
+    MS5611(MS5611_I2C_ADDRESS, I2CBus::getDefault(), Poller::getDefault())
 {
 }
 
@@ -25,16 +93,23 @@ MS5611::~MS5611()
     delete _timer; _timer = nullptr;
 }
 
-MS5611::MS5611(uint8_t address, I2C *bus, Poller *event_poller):
+MS5611::MS5611(uint8_t address, I2CBus *bus, Poller *event_poller):
     _state(NotReady), _i2c(bus), _timer(new Timer(event_poller)),
     _address(address), _oversampling(MS5611_OVERSAMPLING_1024),
-    _temperature(0), _pressure(0)
+    _raw_temperature(0), _raw_pressure(0), _temperature(0), _pressure(0),
+    _temperature_every(0), _pressure_samples(0), _converting_pressure(false), _resync(false),
+    _conversion_start(0), _period(0), _next_start(0),
+    _samples_head(0), _samples_tail(0), _samples_dropped(0)
 {
     assert(_i2c != nullptr);
     _timer->onTimeout = [this]() {
         assert(_state != NotReady);
         assert(_state != Ready);
-        if (_state == ReadingTemperature) {
+        if (_state == Resetting) {
+            _onReset();
+        } else if (_state == Continuous) {
+            _onContinuous();
+        } else if (_state == ReadingTemperature) {
             if (_readTemperatureADC() < 0) {
                 Error() << "_readTemperatureADC error";
                 if (onError) onError();
@@ -77,32 +152,49 @@ int MS5611::initialize()
         Error() << "Unable to initialize device that in use";
         return -1;
     }
+
+    // PROM which matches verified copy is loaded already, reset is not needed.
+    // PROM is not loaded yet after power up, mismatch is expected then and leads to reset.
+    uint16_t cached[8], prom[8];
+    if (_loadCache(cached) == 0 && _readPROM(prom) == 0 && memcmp(cached, prom, sizeof(prom)) == 0) {
+        _calibration.set(prom + 1);
+        _state = Ready;
+        if (onReady) onReady();
+        _finishInitialize(0);
+        return 0;
+    }
+
     // ensure that PROM data properly propogated by the chip.
     if (reset() < 0) {
         Error() << "Unable to reset device";
         return -1;
     }
-    // read PROM data from device
-    uint8_t buff[16];
-    for (size_t i=0; i<16; i+=2) {
-        if (_i2c->readBytes(_address, MS5611_REG_PROM + i, 2, buff + i) < 0) {
-            Error() << "Unable to read calibration data";
-            return -1;
-        }
+    return 0;
+}
+
+int MS5611::initializeAsync(std::function<void(int)> callback)
+{
+    if (_state != NotReady) {
+        Error() << "Unable to initialize device that in use";
+        return -1;
     }
-    // first 2 bytes reserved for manufacturer
-    _c1 = buff[2]<<8 | buff[3];
-    _c2 = buff[4]<<8 | buff[5];
-    _c3 = buff[6]<<8 | buff[7];
-    _c4 = buff[8]<<8 | buff[9];
-    _c5 = buff[10]<<8 | buff[11];
-    _c6 = buff[12]<<8 | buff[13];
-    // last 3 bits of last 2 bytes is CRC4
-    // TODO: implement crc check
+    _initialized = callback;
+    if (initialize() < 0) {
+        _initialized = nullptr;
+        return -1;
+    }
+    return 0;
+}
 
-    _state = Ready;
+void MS5611::setCalibrationCache(const char *directory)
+{
+    // bus name is usually a device path, e.g. /dev/i2c-1 gives ms5611-i2c-1-77
+    const char *bus = strrchr(_i2c->name(), '/');
+    bus = bus != nullptr ? bus + 1 : _i2c->name();
 
-    return 0;
+    char name[64];
+    snprintf(name, sizeof(name), "/ms5611-%s-%02x", bus, _address);
+    _cache_path = std::string(directory) + name;
 }
 
 int MS5611::setOversampling(uint8_t oversampling)
@@ -152,13 +244,271 @@ int MS5611::getTemperatureAndPressure()
     return 0;
 }
 
-int MS5611::reset() {
-    int ret = _i2c->write(_address, MS5611_REG_RESET);
-    if (ret < 0) return ret;
-    usleep(2800);
+int MS5611::startContinuous(float rate, unsigned temperature_every)
+{
+    if (_state != Ready) {
+        Error() << "Device is not ready";
+        return -1;
+    }
+    if (temperature_every == 0 || rate <= 0 || rate > maximumRate(_oversampling, temperature_every)) {
+        Error() << "Invalid continuous mode rate" << rate << "temperature every" << temperature_every
+                << "maximum" << maximumRate(_oversampling, temperature_every);
+        return -1;
+    }
+
+    if (_i2c->write(_address, MS5611_REG_TEMPERATURE | (_oversampling << 1)) < 0) {
+        Error() << "Can not start conversion";
+        return -1;
+    }
+
+    // temperature conversions take slots of pressure ones
+    _period = 1e9f / (rate * (temperature_every + 1) / temperature_every);
+    _temperature_every = temperature_every;
+    _pressure_samples = 0;
+    _converting_pressure = false;
+    _resync = false;
+    _conversion_start = monotonicNsec();
+    _next_start = _conversion_start + _period;
+    _state = Continuous;
+
+    timespec timeout = {(time_t)(_period / 1000000000), (long)(_period % 1000000000)};
+    _timer->start(timeout, timespec{0, 0});
+
     return 0;
 }
 
+int MS5611::stopContinuous()
+{
+    if (_state != Continuous) {
+        Error() << "Continuous mode is not running";
+        return -1;
+    }
+    _timer->stop();
+    _state = Ready;
+    return 0;
+}
+
+size_t MS5611::readSamples(Sample samples[], size_t max)
+{
+    size_t count = 0;
+    while (count < max && _samples_tail != _samples_head) {
+        samples[count++] = _samples[_samples_tail % SampleCapacity];
+        _samples_tail++;
+    }
+    return count;
+}
+
+uint64_t MS5611::droppedSamples() const
+{
+    return _samples_dropped;
+}
+
+float MS5611::maximumRate(uint8_t oversampling, unsigned temperature_every)
+{
+    if (oversampling > MS5611_OVERSAMPLING_4096 || temperature_every == 0) {
+        return 0;
+    }
+    return 1e9f / _conversion_ns[oversampling] * temperature_every / (temperature_every + 1);
+}
+
+int MS5611::reset()
+{
+    _timer->stop();
+    if (_i2c->write(_address, MS5611_REG_RESET) < 0) {
+        _state = NotReady;
+        return -1;
+    }
+    timespec timeout = {0, MS5611_RESET_NSEC};
+    _timer->start(timeout, timespec{0, 0});
+    _state = Resetting;
+    return 0;
+}
+
+void MS5611::_onReset()
+{
+    uint16_t prom[8];
+    if (_readPROM(prom) < 0) {
+        Error() << "Unable to read calibration data";
+        _state = NotReady;
+        if (onError) onError();
+        _finishInitialize(-1);
+        return;
+    }
+    // first word is reserved for manufacturer, low nibble of the last one is CRC4
+    uint8_t crc = _crc4(prom);
+    if (crc != (prom[7] & 0x0F)) {
+        Error() << "PROM CRC mismatch, expected" << (unsigned)(prom[7] & 0x0F) << "got" << (unsigned)crc;
+        _state = NotReady;
+        if (onError) onError();
+        _finishInitialize(-1);
+        return;
+    }
+    _calibration.set(prom + 1);
+    _storeCache(prom);
+    _state = Ready;
+    if (onReady) onReady();
+    _finishInitialize(0);
+}
+
+void MS5611::_finishInitialize(int result)
+{
+    if (_initialized) {
+        std::function<void(int)> callback = std::move(_initialized);
+        _initialized = nullptr;
+        callback(result);
+    }
+}
+
+int MS5611::_readPROM(uint16_t prom[8])
+{
+    uint8_t buff[16];
+    I2CBatch batch(_i2c);
+    for (size_t i=0; i<16; i+=2) {
+        batch.readBytes(_address, MS5611_REG_PROM + i, 2, buff + i);
+    }
+    if (batch.submit() < 0) {
+        return -1;
+    }
+    for (size_t i=0; i<8; i++) {
+        prom[i] = buff[i*2]<<8 | buff[i*2 + 1];
+    }
+    return 0;
+}
+
+uint8_t MS5611::_crc4(const uint16_t prom[8])
+{
+    // AN520: CRC over all PROM words with the CRC nibble itself zeroed
+    uint16_t remainder = 0;
+    for (int i=0; i<16; i++) {
+        uint16_t word = i == 15 ? prom[7] & 0xFF00 : prom[i >> 1];
+        remainder ^= i % 2 == 1 ? word & 0x00FF : word >> 8;
+        for (int bit=8; bit>0; bit--) {
+            if (remainder & 0x8000) {
+                remainder = (remainder << 1) ^ 0x3000;
+            } else {
+                remainder = remainder << 1;
+            }
+        }
+    }
+    return (remainder >> 12) & 0x0F;
+}
+
+int MS5611::_loadCache(uint16_t prom[8])
+{
+    if (_cache_path.empty()) {
+        return -1;
+    }
+    FILE *file = fopen(_cache_path.c_str(), "r");
+    if (file == nullptr) {
+        return -1;
+    }
+    int count = fscanf(file, "%hx %hx %hx %hx %hx %hx %hx %hx",
+                       &prom[0], &prom[1], &prom[2], &prom[3], &prom[4], &prom[5], &prom[6], &prom[7]);
+    fclose(file);
+    if (count != 8 || _crc4(prom) != (prom[7] & 0x0F)) {
+        Warn() << "Ignoring invalid calibration cache" << _cache_path.c_str();
+        return -1;
+    }
+    return 0;
+}
+
+void MS5611::_storeCache(const uint16_t prom[8])
+{
+    if (_cache_path.empty()) {
+        return;
+    }
+    // written aside and renamed, so interrupted write never leaves broken cache
+    std::string temporary = _cache_path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "w");
+    if (file == nullptr) {
+        Warn() << "Unable to write calibration cache" << temporary.c_str() << strerror(errno);
+        return;
+    }
+    fprintf(file, "%04x %04x %04x %04x %04x %04x %04x %04x\n",
+            prom[0], prom[1], prom[2], prom[3], prom[4], prom[5], prom[6], prom[7]);
+    if (fclose(file) != 0 || rename(temporary.c_str(), _cache_path.c_str()) != 0) {
+        Warn() << "Unable to write calibration cache" << _cache_path.c_str() << strerror(errno);
+        unlink(temporary.c_str());
+    }
+}
+
+void MS5611::_onContinuous()
+{
+    // after an error the running conversion could be either one or none,
+    // its result is not read and temperature is converted first
+    bool resync = _resync;
+    bool pressure = _converting_pressure;
+    bool next_pressure = !resync && (!pressure || _pressure_samples + 1 < _temperature_every);
+    uint64_t conversion_start = _conversion_start;
+
+    // read finished conversion and start the next one in one transaction
+    uint8_t buffer[3];
+    uint8_t command = (next_pressure ? MS5611_REG_PRESSURE : MS5611_REG_TEMPERATURE) | (_oversampling << 1);
+    I2CBatch batch(_i2c);
+    if (!resync) {
+        batch.readBytes(_address, MS5611_REG_ADC, 3, buffer);
+    }
+    batch.writeBatch(_address, 1, &command);
+    int ret = batch.submit();
+    uint64_t now = monotonicNsec();
+
+    // next conversion must not be read before it is finished even if this tick was late
+    _next_start += _period;
+    if (_next_start < now + _conversion_ns[_oversampling]) {
+        _next_start = now + _conversion_ns[_oversampling];
+    }
+    timespec timeout = {(time_t)((_next_start - now) / 1000000000), (long)((_next_start - now) % 1000000000)};
+    _timer->start(timeout, timespec{0, 0});
+
+    if (ret < 0) {
+        ErrorLimited(1) << "Unable to read ADC data";
+        if (onError) onError();
+        // command could have reached the device or not
+        _resync = true;
+        _conversion_start = now;
+        return;
+    }
+    _resync = false;
+    _converting_pressure = next_pressure;
+    _conversion_start = now;
+    if (resync) {
+        return;
+    }
+
+    uint32_t value = (buffer[0] << 16) | (buffer[1] << 8) | buffer[2];
+    if (value == 0) {
+        // device returns 0 when conversion was interrupted or not finished
+        WarnLimited(1) << "Conversion result is not ready";
+        if (!pressure) {
+            // pressure conversion which was just started would be compensated with stale temperature
+            _resync = true;
+        }
+        return;
+    }
+
+    if (!pressure) {
+        _raw_temperature = value;
+        _pressure_samples = 0;
+        return;
+    }
+
+    _raw_pressure = value;
+    _pressure_samples++;
+    _calculate();
+
+    if (_samples_head - _samples_tail == SampleCapacity) {
+        _samples_tail++;
+        _samples_dropped++;
+    }
+    Sample &sample = _samples[_samples_head % SampleCapacity];
+    sample.timestamp = conversion_start + _conversion_ns[_oversampling] / 2;
+    sample.temperature = _temperature;
+    sample.pressure = _pressure;
+    _samples_head++;
+
+    if (onSamples) onSamples();
+}
+
 int MS5611::_readTemperatureADC()
 {
     uint8_t buffer[3];
@@ -183,32 +533,8 @@ int MS5611::_readPressureADC()
 
 void MS5611::_calculate()
 {
-    float dT = _raw_temperature - _c5 * powf(2, 8);
-    _temperature = (2000 + ((dT * _c6) / powf(2, 23)));
-    float OFF = _c2 * powf(2, 16) + (_c4 * dT) / powf(2, 7);
-    float SENS = _c1 * powf(2, 15) + (_c3 * dT) / powf(2, 8);
-
-    float T2, OFF2, SENS2;
-
-    if (_temperature >= 2000) {
-        T2 = 0;
-        OFF2 = 0;
-        SENS2 = 0;
-    } else {
-        T2 = dT * dT / powf(2, 31);
-        OFF2 = 5 * powf(_temperature - 2000, 2) / 2;
-        SENS2 = OFF2 / 2;
-
-        if (_temperature < -1500) {
-            OFF2 = OFF2 + 7 * powf(_temperature + 1500, 2);
-            SENS2 = SENS2 + 11 * powf(_temperature + 1500, 2) / 2;
-        }
-    }
-
-    _temperature = _temperature - T2;
-    OFF = OFF - OFF2;
-    SENS = SENS - SENS2;
-
-    _pressure = ((_raw_pressure * SENS) / powf(2, 21) - OFF) / powf(2, 15) / 100;
-    _temperature = _temperature / 100;
+    int32_t temperature, pressure;
+    _calibration.compensate(_raw_temperature, _raw_pressure, temperature, pressure);
+    _temperature = temperature / 100.0f;
+    _pressure = pressure / 100.0f;
 }
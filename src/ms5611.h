@@ -11,11 +11,13 @@
 
 
 #include <stdint.h>
+#include <stddef.h>
 #include <functional>
+#include <string>
 
 class Poller;
 class Timer;
-class I2C;
+class I2CBus;
 
 /** MEAS MS5611 pressure sensor.
  * Class provides methods and callbacks to read temperature and pressure from MS5611 sensor.
@@ -24,13 +26,56 @@ class MS5611
 {
     enum State {
         NotReady,
+        Resetting,
         Ready,
         ReadingTemperature,
         ReadingComboTemperature,
-        ReadingComboPressure
+        ReadingComboPressure,
+        Continuous
     };
 
 public:
+    /** Calibration coefficients C1..C6 with constant terms of compensation precomputed. */
+    class Calibration
+    {
+    public:
+        Calibration();
+
+        /** Store coefficients and derive constant terms from them.
+         * @param coefficients - PROM words 1..6 (C1..C6)
+         */
+        void set(const uint16_t coefficients[6]);
+
+        /** Datasheet first and second order compensation in 64-bit integer arithmetic.
+         * @param raw_temperature - D2 ADC value
+         * @param raw_pressure - D1 ADC value
+         * @param temperature - result in 0.01 Celsius
+         * @param pressure - result in Pa (0.01 mbar)
+         */
+        void compensate(uint32_t raw_temperature, uint32_t raw_pressure, int32_t &temperature, int32_t &pressure) const;
+
+        uint16_t coefficients[6];
+
+    private:
+        int32_t _tref;      /**< C5 * 2^8 */
+        int64_t _offt1;     /**< C2 * 2^16 */
+        int64_t _senst1;    /**< C1 * 2^15 */
+        int64_t _tco;       /**< C4 */
+        int64_t _tcs;       /**< C3 */
+        int64_t _tempsens;  /**< C6 */
+    };
+
+    /** Continuous mode sample. */
+    struct Sample {
+        uint64_t timestamp;     /**< CLOCK_MONOTONIC ns, middle of pressure conversion */
+        float temperature;      /**< Celsius, from the latest temperature conversion */
+        float pressure;         /**< hPa */
+    };
+
+    enum {
+        SampleCapacity = 32     /**< continuous mode samples kept until readSamples() */
+    };
+
     /** This callback will be called on error. */
     std::function<void(void)> onError;
 
@@ -46,6 +91,14 @@ public:
      */
     std::function<void(float, float)> onTemperatureAndPressure;
 
+    /** This callback will be called when device became ready after initialize() or reset(). */
+    std::function<void(void)> onReady;
+
+    /** This callback will be called when continuous mode stored new sample.
+     * Take samples with readSamples(), they could also be collected later in batches.
+     */
+    std::function<void(void)> onSamples;
+
     /** Constructor with default address, i2c bus and event loop. */
     MS5611();
 
@@ -54,15 +107,32 @@ public:
      * @param bus - but instance, where sensor located.
      * @param address - device address.
      */
-    MS5611(uint8_t address, I2C *bus, Poller *event_poller);
+    MS5611(uint8_t address, I2CBus *bus, Poller *event_poller);
     MS5611(const MS5611& that) = delete; /**< Copy contructor not allowed because of sensor state and timers. */
     ~MS5611();
 
     /** Initialize sensor and read calibration data.
+     * If calibration cache is set and device PROM matches it, device is ready on return.
+     * Otherwise device is reset and becomes ready asynchronously when PROM is reloaded and verified.
+     * onReady is called in both cases, start measurements from it.
      * @return 0 on success or negative value on error
      */
     int initialize();
 
+    /** Keep verified calibration in a file, so restarts could skip reset.
+     * File is named after bus and device address, call it after the bus is opened.
+     * @param directory - writable directory, e.g. /var/lib/navio
+     */
+    void setCalibrationCache(const char *directory);
+
+    /** Initialize sensor without blocking event loop.
+     * Same as initialize(), completion is reported to the callback as well as to onReady/onError.
+     * Callback is called before return if calibration cache made reset unnecessary.
+     * @param callback - called with 0 on success or negative value on error
+     * @return 0 if initialization started or negative value on error, callback is not called then
+     */
+    int initializeAsync(std::function<void(int)> callback);
+
     /** Set sensor oversampling.
      * Set how many samples should be used for approximation by sensor.
      * Use predefined constants: BMP180_OVERSAMPLING_*.
@@ -83,33 +153,92 @@ public:
      */
     int getTemperatureAndPressure();
 
+    /** Start continuous pressure sampling.
+     * Conversions run back to back from the driver timer: every tick reads finished conversion
+     * and starts the next one in a single bus transaction. Temperature is converted once per
+     * temperature_every pressure samples and used to compensate the following ones.
+     * Samples are stored in a ring of SampleCapacity entries, oldest are dropped on overflow.
+     *
+     * Achievable pressure rate is limited by conversion time, see maximumRate().
+     * Upper bounds from datasheet conversion times (temperature_every = 16):
+     *   OSR 256 - 1568 Hz, 512 - 804 Hz, 1024 - 413 Hz, 2048 - 207 Hz, 4096 - 104 Hz,
+     * bus transaction (about 0.2 ms at 400 kHz) comes on top of conversion time.
+     *
+     * @param rate - pressure samples per second
+     * @param temperature_every - pressure samples per temperature conversion
+     * @return 0 on success or negative value on error
+     */
+    int startContinuous(float rate, unsigned temperature_every = 16);
+
+    /** Stop continuous sampling, stored samples stay available.
+     * @return 0 on success or negative value on error
+     */
+    int stopContinuous();
+
+    /** Take samples stored by continuous mode, oldest first.
+     * @param samples - destination
+     * @param max - destination capacity
+     * @return amount of samples taken
+     */
+    size_t readSamples(Sample samples[], size_t max);
+
+    /** Amount of samples dropped because ring was full. */
+    uint64_t droppedSamples() const;
+
+    /** Upper bound of continuous mode pressure rate.
+     * @param oversampling - MS5611_OVERSAMPLING_* constant
+     * @param temperature_every - pressure samples per temperature conversion
+     * @return pressure samples per second
+     */
+    static float maximumRate(uint8_t oversampling, unsigned temperature_every);
+
     /** Perform device soft reset.
+     * Running conversions are cancelled. Reset takes 2.8 ms, it is waited for with the driver
+     * timer, then PROM is read and checked with CRC4. onReady is called on success, onError otherwise.
      * @return 0 on success or negative value on error
      */
     int reset();
 
 private:
     State _state;
-    I2C *_i2c;
+    I2CBus *_i2c;
     Timer *_timer;
     uint8_t _address;
     uint8_t _oversampling;
 
-    uint16_t _c1; /** SENST1 - Pressure sensitivity */
-    uint16_t _c2; /** OFFT1 - Pressure offset */
-    uint16_t _c3; /** TCS - Temperature coefficient of pressure sensitivity */
-    uint16_t _c4; /** TCO - Temperature coefficient of pressure offset */
-    uint16_t _c5; /** TREF - Reference temperature */
-    uint16_t _c6; /** TEMPSENS - Temperature coefficient of the temperature */
+    Calibration _calibration;
+    std::string _cache_path;
+    std::function<void(int)> _initialized;
 
     uint32_t _raw_temperature;
     uint32_t _raw_pressure;
     float _temperature;
     float _pressure;
 
+    unsigned _temperature_every;
+    unsigned _pressure_samples;     /**< pressure samples since temperature conversion */
+    bool _converting_pressure;
+    bool _resync;                   /**< running conversion is unknown, drop it and convert temperature */
+    uint64_t _conversion_start;
+    uint64_t _period;               /**< ns between conversion starts */
+    uint64_t _next_start;
+
+    Sample _samples[SampleCapacity];
+    size_t _samples_head;
+    size_t _samples_tail;
+    uint64_t _samples_dropped;
+
+    int _readPROM(uint16_t prom[8]);
+    void _onReset();
+    void _finishInitialize(int result);
+    int _loadCache(uint16_t prom[8]);
+    void _storeCache(const uint16_t prom[8]);
+    static uint8_t _crc4(const uint16_t prom[8]);
+
     int _readTemperatureADC();
     int _readPressureADC();
     void _calculate();
+    void _onContinuous();
 };
 
 #endif // MS5611_H
@@ -1,5 +1,6 @@
 #include "pca9685.h"
-#include "i2c.h"
+#include "i2cbus.h"
+#include "i2cbatch.h"
 #include "log.h"
 
 #include <cassert>
@@ -33,11 +34,11 @@
 #define PCA9685_MODE2_OUTNE0_BIT    0
 
 PCA9685::PCA9685():
-    PCA9685(PCA9685_I2C_DEFAULT_ADDR, I2C::getDefault())
+    PCA9685(PCA9685_I2C_DEFAULT_ADDR, I2CBus::getDefault())
 {
 
 }
-PCA9685::PCA9685(uint8_t address, I2C *i2c):
+PCA9685::PCA9685(uint8_t address, I2CBus *i2c):
     _i2c(i2c), _address(address), _frequency(0), _clock(25000000.f)
 {
     assert(i2c != nullptr);
@@ -106,14 +107,22 @@ int PCA9685::setPrescale(float prescale)
 
     uint8_t prescale_data = prescale;
     uint8_t oldmode;
-    _i2c->readByte(_address, PCA9685_RA_MODE1, oldmode);
+    if (_i2c->readByte(_address, PCA9685_RA_MODE1, oldmode) < 0) {
+        Error() << "Unable to read mode, device communication error";
+        return -1;
+    }
 
     uint8_t newmode = (oldmode ^ PCA9685_MODE1_FLAG_RESTART) | PCA9685_MODE1_FLAG_SLEEP;
-    _i2c->writeByte(_address, PCA9685_RA_MODE1, newmode);
-    _i2c->writeByte(_address, PCA9685_RA_PRE_SCALE, prescale_data);
-    _i2c->writeByte(_address, PCA9685_RA_MODE1, oldmode);
+    I2CBatch batch(_i2c);
+    batch.writeByte(_address, PCA9685_RA_MODE1, newmode);
+    batch.writeByte(_address, PCA9685_RA_PRE_SCALE, prescale_data);
+    batch.writeByte(_address, PCA9685_RA_MODE1, oldmode);
     oldmode |= PCA9685_MODE1_FLAG_AI;
-    _i2c->writeByte(_address, PCA9685_RA_MODE1, oldmode);
+    batch.writeByte(_address, PCA9685_RA_MODE1, oldmode);
+    if (batch.submit() < 0) {
+        Error() << "Unable to set prescale, device communication error";
+        return -1;
+    }
 
     _frequency = _clock / 4096.f / (prescale + 1);
 
@@ -5,7 +5,7 @@
 
 #define PCA9685_I2C_DEFAULT_ADDR    0x40
 
-class I2C;
+class I2CBus;
 
 /** NXP pca9685 pwm driver.
  * Class provides methods to control pwm output.
@@ -22,7 +22,7 @@ public:
      * @param i2c - pointer to i2c driver instance.
      * @param address - pca9685 i2c address.
      */
-    PCA9685(uint8_t address, I2C *i2c);
+    PCA9685(uint8_t address, I2CBus *i2c);
     PCA9685(const PCA9685& that) = delete; /**< Copy contructor not allowed because of sensor state. */
     ~PCA9685();
 
@@ -122,7 +122,7 @@ public:
     int setAllPWMuS(float length_uS);
 
  private:
-    I2C *_i2c;          /**< i2c bus driver. */
+    I2CBus *_i2c;          /**< i2c bus driver. */
     uint8_t _address;   /**< PCA9685 i2c address. */
     float _frequency;   /**< pwm frequency. */
     float _clock;       /**< oscillator frequency. */
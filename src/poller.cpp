@@ -1,30 +1,57 @@
 #include "poller.h"
 #include "descriptor.h"
+#include "event.h"
 #include "log.h"
+#include "utils.h"
 
 #include <sys/epoll.h>
 #include <string.h>
 #include <sched.h>
 #include <stdio.h>
 #include <cassert>
+#include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 static Poller *_default_event_poller=nullptr;
 
-Poller::Poller():
+static inline uint64_t _timespecToUsec(const timespec &ts)
+{
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline uint64_t _monotonicUsec()
+{
+    return monotonicNsec() / 1000;
+}
+
+Poller::Poller(size_t task_capacity, bool realtime):
     _epoll_mono_time(0), _callback_mono_time(0), _epoll_cpu_time(0), _callback_cpu_time(0),
+    _syscall_count(0), _iteration_count(0), _wakeup_count(0), _event_count(0),
     _fd(-1), _run(false),
-    _fd_read_pool(), _fd_write_pool()
+    _slots(64, Slot{nullptr, nullptr, 0}),
+    _tasks(task_capacity), _wakeup_pending(false), _wakeup(nullptr), _timer_wheel(nullptr),
+    _events(nullptr), _event_capacity(16), _requested_event_capacity(16),
+    _max_callbacks(0), _max_callback_usec(0), _busy_poll_usec(0)
 {
+    _events = new epoll_event[_event_capacity];
+
     _fd = epoll_create(1);
     assert(_fd >= 0);
 
-    sched_param schedparm;
-    schedparm.sched_priority = sched_get_priority_min(SCHED_FIFO);
-    if (schedparm.sched_priority == -1 || sched_setscheduler(0, SCHED_FIFO, &schedparm) == -1) {
-        Error() << "Unable to set scheduller priority. Events may coalesce.";
+    if (realtime) {
+        sched_param schedparm;
+        schedparm.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (schedparm.sched_priority == -1 || sched_setscheduler(0, SCHED_FIFO, &schedparm) == -1) {
+            Error() << "Unable to set scheduller priority. Events may coalesce.";
+        }
     }
 
+    _wakeup = new Event(this);
+    _wakeup->onEvent = [this](uint64_t) {
+        _runTasks();
+    };
+
     if (_default_event_poller == nullptr) {
         _default_event_poller = this;
     }
@@ -32,43 +59,64 @@ Poller::Poller():
 
 Poller::~Poller()
 {
-    if (!_fd_read_pool.empty()) {
-        for (auto i=_fd_read_pool.begin(); i!=_fd_read_pool.end(); i++) {
-            Error()<< "fd:" << i->first << "holder:" << i->second->name() << "is still in read event pool.";
+    delete _wakeup; _wakeup = nullptr;
+
+    for (size_t fd=0; fd<_slots.size(); fd++) {
+        if (_slots[fd].read != nullptr) {
+            Error()<< "fd:" << fd << "holder:" << _slots[fd].read->name() << "is still in read event pool.";
         }
-    }
-    if (!_fd_write_pool.empty()) {
-        for (auto i=_fd_write_pool.begin(); i!=_fd_write_pool.end(); i++) {
-            Error()<< "fd:" << i->first << "holder:" << i->second->name() << "is still in write event pool.";
+        if (_slots[fd].write != nullptr) {
+            Error()<< "fd:" << fd << "holder:" << _slots[fd].write->name() << "is still in write event pool.";
         }
     }
+
+    if (_default_event_poller == this) {
+        _default_event_poller = nullptr;
+    }
+    close(_fd);
+    delete [] _events; _events = nullptr;
 }
 
 void Poller::loop()
 {
     int count;
     timespec a_mono_time, b_mono_time, c_mono_time, a_cpu_time, b_cpu_time, c_cpu_time;
-    epoll_event events[16];
 
     _run = true;
     while (_run) {
+        if (_requested_event_capacity != _event_capacity) {
+            delete [] _events;
+            _event_capacity = _requested_event_capacity;
+            _events = new epoll_event[_event_capacity];
+        }
+
         clock_gettime(CLOCK_MONOTONIC, &a_mono_time);
         clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &a_cpu_time);
 
-        count = epoll_wait(_fd, events, 16, -1);
+        count = _wait();
 
         clock_gettime(CLOCK_MONOTONIC, &b_mono_time);
         clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &b_cpu_time);
 
-        if (count) {
-            for (int i=0; i<count; i++) {
-                if (events[i].events & EPOLLOUT) {
-                    _fd_write_pool[events[i].data.fd]->_onWrite();
-                } else {
-                    _fd_read_pool[events[i].data.fd]->_onRead();
-                }
+        if (count > 0) {
+            _wakeup_count++;
+            _event_count += count;
+        }
+
+        uint64_t deadline = 0;
+        if (_max_callback_usec > 0) {
+            deadline = _timespecToUsec(b_mono_time) + _max_callback_usec;
+        }
+        for (int i=0; i<count; i++) {
+            if (_max_callbacks > 0 && (size_t)i >= _max_callbacks) {
+                break;
+            }
+            if (deadline > 0 && i > 0 && _monotonicUsec() >= deadline) {
+                break;
             }
+            _dispatch(_events[i]);
         }
+        _iteration_count++;
 
         clock_gettime(CLOCK_MONOTONIC, &c_mono_time);
         clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c_cpu_time);
@@ -87,6 +135,17 @@ void Poller::loop()
 void Poller::stop()
 {
     _run = false;
+    _wakeup->notify();
+}
+
+int Poller::post(std::function<void()> task)
+{
+    return _post(Task{std::move(task), nullptr, nullptr});
+}
+
+int Poller::postFixed(void (*function)(void*), void *argument)
+{
+    return _post(Task{nullptr, function, argument});
 }
 
 void Poller::getTimings(float &epoll_mono, float &callback_mono, float &epoll_cpu, float &callback_cpu)
@@ -96,6 +155,46 @@ void Poller::getTimings(float &epoll_mono, float &callback_mono, float &epoll_cp
     epoll_cpu = _epoll_cpu_time;
     callback_cpu = _callback_cpu_time;
     _epoll_mono_time = _callback_mono_time = _epoll_cpu_time = _callback_cpu_time = 0;
+    _syscall_count = _iteration_count = _wakeup_count = _event_count = 0;
+}
+
+void Poller::getTimings(float &epoll_mono, float &callback_mono, float &epoll_cpu, float &callback_cpu,
+                        float &syscalls_per_iteration, float &events_per_wakeup)
+{
+    syscalls_per_iteration = _iteration_count ? (float)_syscall_count / _iteration_count : 0;
+    events_per_wakeup = _wakeup_count ? (float)_event_count / _wakeup_count : 0;
+    getTimings(epoll_mono, callback_mono, epoll_cpu, callback_cpu);
+}
+
+int Poller::setEventCapacity(size_t capacity)
+{
+    if (capacity == 0) {
+        Error() << "Event capacity should be positive";
+        return -1;
+    }
+    _requested_event_capacity = capacity;
+    return 0;
+}
+
+void Poller::setCallbackBudget(size_t max_callbacks, uint64_t max_usec)
+{
+    _max_callbacks = max_callbacks;
+    _max_callback_usec = max_usec;
+}
+
+void Poller::setBusyPoll(uint64_t spin_usec)
+{
+    _busy_poll_usec = spin_usec;
+}
+
+void Poller::setTimerWheel(TimerWheel *wheel)
+{
+    _timer_wheel = wheel;
+}
+
+TimerWheel* Poller::timerWheel()
+{
+    return _timer_wheel;
 }
 
 Poller* Poller::getDefault()
@@ -104,79 +203,194 @@ Poller* Poller::getDefault()
     return _default_event_poller;
 }
 
+int Poller::_wait()
+{
+    if (_busy_poll_usec > 0) {
+        uint64_t deadline = _monotonicUsec() + _busy_poll_usec;
+        do {
+            _syscall_count++;
+            int count = epoll_wait(_fd, _events, _event_capacity, 0);
+            if (count != 0) {
+                return count;
+            }
+        } while (_run && _monotonicUsec() < deadline);
+    }
+
+    _syscall_count++;
+    return epoll_wait(_fd, _events, _event_capacity, -1);
+}
+
+void Poller::_dispatch(const epoll_event &event)
+{
+    // Slot may be reallocated or reused by any callback, so it is looked up again after each call.
+    uint32_t fd = (uint32_t)event.data.u64;
+    uint32_t generation = (uint32_t)(event.data.u64 >> 32);
+
+    if (event.events & EPOLLOUT) {
+        Slot *slot = _slot(fd);
+        if (slot != nullptr && slot->generation == generation && slot->write != nullptr) {
+            slot->write->_onWrite();
+        }
+    }
+    if (event.events & ~EPOLLOUT) {
+        Slot *slot = _slot(fd);
+        if (slot == nullptr || slot->generation != generation) {
+            return;
+        }
+        if (slot->read != nullptr) {
+            slot->read->_onRead();
+        } else if (slot->write != nullptr && !(event.events & EPOLLOUT)) {
+            // error or hangup on write only descriptor
+            slot->write->_onWrite();
+        }
+    }
+}
+
+int Poller::_post(Task &&task)
+{
+    if (!_tasks.push(std::move(task))) {
+        return -1;
+    }
+    // Poller will drain queue after reset of pending flag, so only the first producer needs a syscall.
+    if (!_wakeup_pending.exchange(true)) {
+        return _wakeup->notify();
+    }
+    return 0;
+}
+
+void Poller::_runTasks()
+{
+    _wakeup_pending = false;
+
+    Task task{nullptr, nullptr, nullptr};
+    size_t executed = 0;
+    while (executed < _tasks.capacity() && _tasks.pop(task)) {
+        if (task.fixed_function != nullptr) {
+            task.fixed_function(task.argument);
+        } else if (task.function) {
+            task.function();
+        }
+        executed++;
+    }
+
+    // queue is refilled faster than drained, give other descriptors a chance
+    if (executed == _tasks.capacity() && !_wakeup_pending.exchange(true)) {
+        _wakeup->notify();
+    }
+}
+
+Poller::Slot* Poller::_slot(int fd)
+{
+    if (fd < 0 || (size_t)fd >= _slots.size()) {
+        return nullptr;
+    }
+    return &_slots[fd];
+}
+
+int Poller::_updateSlot(int fd, Slot &slot, bool existed)
+{
+    epoll_event e;
+    e.events = 0;
+    if (slot.read != nullptr) {
+        e.events |= EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP;
+    }
+    if (slot.write != nullptr) {
+        e.events |= EPOLLOUT;
+    }
+    e.data.u64 = ((uint64_t)slot.generation << 32) | (uint32_t)fd;
+
+    if (e.events == 0) {
+        return epoll_ctl(_fd, EPOLL_CTL_DEL, fd, &e);
+    }
+    return epoll_ctl(_fd, existed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &e);
+}
+
 bool Poller::_registerDescriptorRead(int fd, Descriptor *fd_event)
 {
-    if (!_fd_read_pool.empty() && _fd_read_pool.count(fd)) {
+    if (fd < 0) {
+        Error() << "Invalid fd:" << fd;
+        return false;
+    }
+    if ((size_t)fd >= _slots.size()) {
+        _slots.resize(fd + 1, Slot{nullptr, nullptr, 0});
+    }
+
+    Slot &slot = _slots[fd];
+    if (slot.read != nullptr) {
         Error() << "Read event already registred. fd:" << fd;
         return false;
     }
 
-    epoll_event e;
-    e.events = EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP;
-    e.data.fd = fd;
-    int ret = epoll_ctl(_fd, EPOLL_CTL_ADD, fd, &e);
-    if (ret != 0) {
+    bool existed = slot.write != nullptr;
+    slot.read = fd_event;
+    if (_updateSlot(fd, slot, existed) != 0) {
         Error() << "Unable to register read event for fd:" << fd << "errno:" << errno << strerror(errno);
+        slot.read = nullptr;
         return false;
     }
 
-    _fd_read_pool[fd] = fd_event;
     return true;
 }
 
 bool Poller::_registerDescriptorWrite(int fd, Descriptor *fd_event)
 {
-    if (!_fd_write_pool.empty() && _fd_write_pool.count(fd)) {
+    if (fd < 0) {
+        Error() << "Invalid fd:" << fd;
+        return false;
+    }
+    if ((size_t)fd >= _slots.size()) {
+        _slots.resize(fd + 1, Slot{nullptr, nullptr, 0});
+    }
+
+    Slot &slot = _slots[fd];
+    if (slot.write != nullptr) {
         Error() << "Write event already registred. fd:" << fd;
         return false;
     }
 
-    epoll_event e;
-    e.events = EPOLLOUT;
-    int ret = epoll_ctl(_fd, EPOLL_CTL_ADD, fd, &e);
-    if (ret != 0) {
+    bool existed = slot.read != nullptr;
+    slot.write = fd_event;
+    if (_updateSlot(fd, slot, existed) != 0) {
         Error() << "Unable to register write event for fd:" << fd << "errno:" << errno << strerror(errno);
+        slot.write = nullptr;
         return false;
     }
 
-    _fd_write_pool[fd] = fd_event;
     return true;
 }
 
 bool Poller::_unregisterDescriptorRead(int fd)
 {
-    if (_fd_read_pool.empty() || !_fd_read_pool.count(fd)) {
+    Slot *slot = _slot(fd);
+    if (slot == nullptr || slot->read == nullptr) {
         Error() << "Read event not exists. fd:" << fd;
         return false;
     }
 
-    epoll_event e;
-    e.events = EPOLLIN;
-    int ret = epoll_ctl(_fd, EPOLL_CTL_DEL, fd, &e);
-    if (ret != 0) {
-        Error() << "Unable to unregister write event for fd:" << fd << "errno:" << errno << strerror(errno);
+    slot->read = nullptr;
+    slot->generation++;
+    if (_updateSlot(fd, *slot, true) != 0) {
+        Error() << "Unable to unregister read event for fd:" << fd << "errno:" << errno << strerror(errno);
         return false;
     }
 
-    _fd_read_pool.erase(fd);
     return true;
 }
 
 bool Poller::_unregisterDescriptorWrite(int fd)
 {
-    if (_fd_write_pool.empty() || !_fd_write_pool.count(fd)) {
+    Slot *slot = _slot(fd);
+    if (slot == nullptr || slot->write == nullptr) {
         Error() << "Write event not exists. fd:" << fd;
         return false;
     }
 
-    epoll_event e;
-    e.events = EPOLLOUT;
-    int ret = epoll_ctl(_fd, EPOLL_CTL_DEL, fd, &e);
-    if (ret != 0) {
-        Error() << "Unable to register write event for fd:" << fd << "errno:" << errno << strerror(errno);
+    slot->write = nullptr;
+    slot->generation++;
+    if (_updateSlot(fd, *slot, true) != 0) {
+        Error() << "Unable to unregister write event for fd:" << fd << "errno:" << errno << strerror(errno);
         return false;
     }
 
-    _fd_write_pool.erase(fd);
     return true;
 }
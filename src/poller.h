@@ -1,9 +1,18 @@
 #ifndef POLLER_H
 #define POLLER_H
 
-#include <map>
+#include "mpscqueue.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <functional>
+#include <vector>
 
 class Descriptor;
+class Event;
+class TimerWheel;
+struct epoll_event;
 
 /** Linux epoll wrapper.
  *  Class provides event loop based on linux epoll.
@@ -12,7 +21,12 @@ class Poller
 {
     friend class Descriptor;
 public:
-    Poller();
+    /** Poller constructor.
+     * @param task_capacity - size of cross thread task queue, see post().
+     * @param realtime - switch calling thread to SCHED_FIFO with minimal priority.
+     * Pass false if scheduling is managed by somebody else, for example by Runtime.
+     */
+    Poller(size_t task_capacity=1024, bool realtime=true);
     Poller(const Poller& that) = delete;  /**< Copy contructor not allowed because of the file descriptor. */
     ~Poller();
 
@@ -22,9 +36,26 @@ public:
 
     /** Stop event processing.
      * And return from pollEvents(); after callback execution finish.
+     * Thread safe, could be called from any thread.
      */
     void stop();
 
+    /** Execute task in event poller thread.
+     * Thread safe and lock-free, could be called from any thread.
+     * Only first task posted after poller wakeup costs an eventfd write, rest are just queued.
+     * @param task - function which will be called from event loop.
+     * @return 0 on success or negative value if task queue is full.
+     */
+    int post(std::function<void()> task);
+
+    /** Execute plain function in event poller thread.
+     * Same as post(), but never allocates memory.
+     * @param function - function pointer which will be called from event loop.
+     * @param argument - function argument.
+     * @return 0 on success or negative value if task queue is full.
+     */
+    int postFixed(void (*function)(void*), void *argument);
+
     /** Request poller runtime statistics.
      * @param epoll_mono variable where will be stored amount of real time spent in epoll syscall
      * @param callback_mono variable where will be stored amount of real time spent in descriptor callback
@@ -33,21 +64,103 @@ public:
      */
     void getTimings(float &epoll_mono, float &callback_mono, float &epoll_cpu, float &callback_cpu);
 
+    /** Request poller runtime statistics including wakeup counters.
+     * @param syscalls_per_iteration variable where will be stored average amount of epoll syscalls per loop iteration
+     * @param events_per_wakeup variable where will be stored average amount of events returned by non empty epoll call
+     * Other parameters are the same as in getTimings(float&, float&, float&, float&).
+     */
+    void getTimings(float &epoll_mono, float &callback_mono, float &epoll_cpu, float &callback_cpu,
+                    float &syscalls_per_iteration, float &events_per_wakeup);
+
+    /** Set amount of events which could be received with one epoll call.
+     * New capacity is applied on next loop iteration.
+     * @param capacity - event array size, 16 by default.
+     * @return 0 on success or negative value on error
+     */
+    int setEventCapacity(size_t capacity);
+
+    /** Limit amount of work done between two epoll calls.
+     * When budget is exhausted rest of received events are left in kernel and will be returned by next epoll call,
+     * so new events from other descriptors are not starved by a long burst.
+     * @param max_callbacks - maximum callbacks per iteration, 0 means unlimited.
+     * @param max_usec - maximum time in usec spent in callbacks per iteration, 0 means unlimited.
+     */
+    void setCallbackBudget(size_t max_callbacks, uint64_t max_usec=0);
+
+    /** Enable hybrid busy polling.
+     * Poller will spin with non blocking epoll calls for given amount of time before going to sleep.
+     * Makes sense only for loops which own an isolated CPU core.
+     * @param spin_usec - spin duration in usec, 0 disables busy polling.
+     */
+    void setBusyPoll(uint64_t spin_usec);
+
+    /** Attach timer wheel to poller.
+     * Timers created on this poller afterwards will be multiplexed onto the wheel.
+     * Poller does not own the wheel.
+     * @param wheel - timer wheel instance or nullptr to go back to one timerfd per timer.
+     */
+    void setTimerWheel(TimerWheel *wheel);
+
+    /** Get attached timer wheel.
+     * @return timer wheel or nullptr.
+     */
+    TimerWheel* timerWheel();
+
     /** Get default event poller instance.
      * @return default event poller instance or nullptr.
      */
     static Poller* getDefault();
 
 private:
+    /** Per fd dispatch entry.
+     * Table is indexed by fd, so event dispatch is a single array access.
+     * Generation is incremented on every unregistration, events which carry old
+     * generation belong to descriptor that is already gone and will be dropped.
+     */
+    struct Slot {
+        Descriptor *read;
+        Descriptor *write;
+        uint32_t generation;
+    };
+
+    /** Cross thread task. Either function or fixed_function is set. */
+    struct Task {
+        std::function<void()> function;
+        void (*fixed_function)(void*);
+        void *argument;
+    };
+
     float _epoll_mono_time;
     float _callback_mono_time;
     float _epoll_cpu_time;
     float _callback_cpu_time;
+    uint64_t _syscall_count;
+    uint64_t _iteration_count;
+    uint64_t _wakeup_count;
+    uint64_t _event_count;
 
     int _fd;
-    bool _run;
-    std::map<int, Descriptor*> _fd_read_pool;
-    std::map<int, Descriptor*> _fd_write_pool;
+    std::atomic<bool> _run;
+    std::vector<Slot> _slots;
+
+    MPSCQueue<Task> _tasks;
+    std::atomic<bool> _wakeup_pending;
+    Event *_wakeup;
+    TimerWheel *_timer_wheel;
+
+    epoll_event *_events;
+    size_t _event_capacity;
+    size_t _requested_event_capacity;
+    size_t _max_callbacks;
+    uint64_t _max_callback_usec;
+    uint64_t _busy_poll_usec;
+
+    int _wait();
+    int _post(Task &&task);
+    void _runTasks();
+    void _dispatch(const epoll_event &event);
+    Slot* _slot(int fd);
+    int _updateSlot(int fd, Slot &slot, bool existed);
 
     bool _registerDescriptorRead(int fd, Descriptor *fd_event);
     bool _registerDescriptorWrite(int fd, Descriptor *fd_event);
@@ -0,0 +1,125 @@
+#include "runtime.h"
+#include "poller.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+#include <cassert>
+
+Runtime::Runtime(bool lock_memory):
+    _lock_memory(lock_memory), _started(false), _loops()
+{
+
+}
+
+Runtime::~Runtime()
+{
+    stop();
+    for (Loop *loop: _loops) {
+        delete loop->poller;
+        delete loop;
+    }
+    _loops.clear();
+}
+
+Poller* Runtime::addLoop(int cpu, int priority, const char *name)
+{
+    if (_started) {
+        Error() << "Unable to add loop to running runtime";
+        return nullptr;
+    }
+
+    Loop *loop = new Loop;
+    loop->poller = new Poller(1024, false);
+    loop->cpu = cpu;
+    loop->priority = priority;
+    loop->name = name;
+    _loops.push_back(loop);
+    return loop->poller;
+}
+
+Poller* Runtime::loop(size_t index)
+{
+    assert(index < _loops.size());
+    return _loops[index]->poller;
+}
+
+size_t Runtime::loopCount()
+{
+    return _loops.size();
+}
+
+int Runtime::start()
+{
+    if (_started) {
+        Error() << "Runtime is already started";
+        return -1;
+    }
+
+    if (_lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        Error() << "Unable to lock memory. errno" << errno << strerror(errno);
+        return -1;
+    }
+
+    _started = true;
+    for (Loop *loop: _loops) {
+        loop->thread = std::thread(&Runtime::_run, loop);
+    }
+
+    return 0;
+}
+
+void Runtime::stop()
+{
+    if (!_started) {
+        return;
+    }
+
+    // stop is posted as a task, so it is not lost if loop thread has not entered loop() yet,
+    // full task queue is drained by the loop, so retry until it takes the task
+    for (Loop *loop: _loops) {
+        Poller *poller = loop->poller;
+        while (poller->post([poller]() { poller->stop(); }) < 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (Loop *loop: _loops) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+    _started = false;
+}
+
+void Runtime::_run(Loop *loop)
+{
+    // signals are handled by the main thread signalfd
+    sigset_t sigset;
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_BLOCK, &sigset, nullptr);
+
+    pthread_setname_np(pthread_self(), loop->name);
+
+    if (loop->cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(loop->cpu, &cpuset);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if (ret != 0) {
+            Error() << "Unable to pin" << loop->name << "to cpu" << loop->cpu << strerror(ret);
+        }
+    }
+
+    sched_param schedparm;
+    schedparm.sched_priority = loop->priority;
+    int ret = pthread_setschedparam(pthread_self(), loop->priority > 0 ? SCHED_FIFO : SCHED_OTHER, &schedparm);
+    if (ret != 0) {
+        Error() << "Unable to set" << loop->name << "priority" << loop->priority << strerror(ret);
+    }
+
+    loop->poller->loop();
+}
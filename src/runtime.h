@@ -0,0 +1,71 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+class Poller;
+
+/** Multi loop runtime.
+ *  Runs several event pollers, each one in a dedicated thread with own cpu affinity and realtime priority.
+ *  Typical usage: fast sensor path on isolated core with high SCHED_FIFO priority, slow peripherals elsewhere.
+ *
+ *  Descriptors (Timer, Signal, drivers) are assigned to a loop by passing loop(i) to their constructors.
+ *  Create them before start(), or from inside the loop thread (see Poller::post()),
+ *  because poller registration is not thread safe.
+ */
+class Runtime
+{
+public:
+    /** Runtime constructor.
+     * @param lock_memory - lock all current and future pages with mlockall() on start.
+     */
+    Runtime(bool lock_memory=false);
+    Runtime(const Runtime& that) = delete;  /**< Copy contructor not allowed because of threads. */
+    ~Runtime();
+
+    /** Create new event loop.
+     * @param cpu - cpu core which loop thread will be pinned to, negative value means any core.
+     * @param priority - SCHED_FIFO priority of loop thread, 0 means SCHED_OTHER.
+     * @param name - thread name, shown by ps and top.
+     * @return poller instance or nullptr if runtime is already started.
+     */
+    Poller* addLoop(int cpu=-1, int priority=0, const char *name="navio-loop");
+
+    /** Get event loop.
+     * @param index - loop index in order of addLoop() calls.
+     * @return poller instance.
+     */
+    Poller* loop(size_t index);
+
+    /** Get amount of event loops. */
+    size_t loopCount();
+
+    /** Start all loop threads.
+     * @return 0 on success or negative value on error
+     */
+    int start();
+
+    /** Stop all loops and wait for threads termination.
+     * Could be called from any thread except loop threads.
+     */
+    void stop();
+
+private:
+    struct Loop {
+        Poller *poller;
+        int cpu;
+        int priority;
+        const char *name;
+        std::thread thread;
+    };
+
+    bool _lock_memory;
+    bool _started;
+    std::vector<Loop*> _loops;
+
+    static void _run(Loop *loop);
+};
+
+#endif // RUNTIME_H
@@ -0,0 +1,858 @@
+#include "simdevices.h"
+#include "simgpio.h"
+#include "log.h"
+#include "utils.h"
+
+#include <string.h>
+#include <math.h>
+
+SimRegisterDevice::SimRegisterDevice(uint8_t address):
+    SimI2CDevice(address), _pointer(0)
+{
+    memset(_registers, 0, sizeof(_registers));
+}
+
+int SimRegisterDevice::write(const uint8_t data[], size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    _pointer = _select(data[0]);
+    for (size_t i=1; i<size; i++) {
+        _writeRegister(_pointer, data[i]);
+        _pointer = _nextRegister(_pointer);
+    }
+    return 0;
+}
+
+int SimRegisterDevice::read(uint8_t data[], size_t size)
+{
+    for (size_t i=0; i<size; i++) {
+        data[i] = _readRegister(_pointer);
+        _pointer = _nextRegister(_pointer);
+    }
+    return 0;
+}
+
+uint8_t SimRegisterDevice::getRegister(uint8_t reg) const
+{
+    return _registers[reg];
+}
+
+void SimRegisterDevice::setRegister(uint8_t reg, uint8_t value)
+{
+    _registers[reg] = value;
+}
+
+uint8_t SimRegisterDevice::_select(uint8_t pointer)
+{
+    return pointer;
+}
+
+uint8_t SimRegisterDevice::_readRegister(uint8_t reg)
+{
+    return _registers[reg];
+}
+
+void SimRegisterDevice::_writeRegister(uint8_t reg, uint8_t value)
+{
+    _registers[reg] = value;
+}
+
+uint8_t SimRegisterDevice::_nextRegister(uint8_t reg)
+{
+    return reg + 1;
+}
+
+/* L3GD20H */
+
+#define L3GD20H_WHO_AM_I        0x0F
+#define L3GD20H_CTRL1           0x20
+#define L3GD20H_CTRL3           0x22
+#define L3GD20H_CTRL5           0x24
+#define L3GD20H_STATUS          0x27
+#define L3GD20H_OUT_X_L         0x28
+#define L3GD20H_OUT_Z_H         0x2D
+#define L3GD20H_FIFO_CTRL       0x2E
+#define L3GD20H_FIFO_SRC        0x2F
+#define L3GD20H_LOW_ODR         0x39
+
+SimL3GD20H::SimL3GD20H(uint8_t address):
+    SimRegisterDevice(address), _int2(nullptr), _int2_deadline(0), _int2_high(false)
+{
+    _reset();
+}
+
+int SimL3GD20H::write(const uint8_t data[], size_t size)
+{
+    int result = SimRegisterDevice::write(data, size);
+    _updateInterrupt();
+    return result;
+}
+
+int SimL3GD20H::read(uint8_t data[], size_t size)
+{
+    int result = SimRegisterDevice::read(data, size);
+    _updateInterrupt();
+    return result;
+}
+
+void SimL3GD20H::setInterrupt(SimGPIO *int2)
+{
+    if (_int2 != nullptr && _int2_deadline != 0) {
+        _int2->cancel();
+    }
+    _int2 = int2;
+    _int2_deadline = 0;
+    _int2_high = false;
+    _updateInterrupt();
+}
+
+uint64_t SimL3GD20H::samplesRead() const
+{
+    return _samples_read;
+}
+
+uint64_t SimL3GD20H::overruns() const
+{
+    return _overruns;
+}
+
+uint64_t SimL3GD20H::lastSampleTime() const
+{
+    return _last_read_timestamp;
+}
+
+void SimL3GD20H::_reset()
+{
+    memset(_registers, 0, sizeof(_registers));
+    memset(_fifo, 0, sizeof(_fifo));
+    memset(_timestamps, 0, sizeof(_timestamps));
+    memset(_output, 0, sizeof(_output));
+    _output_timestamp = 0;
+    _last_read_timestamp = 0;
+    _registers[L3GD20H_WHO_AM_I] = 0xD7;
+    _registers[L3GD20H_CTRL1] = 0x07;
+    _head = 0;
+    _level = 0;
+    _overrun = false;
+    _increment = false;
+    _last_sample = monotonicNsec();
+    _samples = 0;
+    _samples_read = 0;
+    _overruns = 0;
+    _int2_high = false;
+}
+
+uint64_t SimL3GD20H::_period() const
+{
+    static const uint64_t rates[] = {100, 200, 400, 800};
+    return 1000000000ull / rates[_registers[L3GD20H_CTRL1] >> 6];
+}
+
+bool SimL3GD20H::_fifoEnabled() const
+{
+    return (_registers[L3GD20H_CTRL5] & 0x40) && (_registers[L3GD20H_FIFO_CTRL] >> 5) != 0;
+}
+
+void SimL3GD20H::_update()
+{
+    uint64_t now = monotonicNsec();
+    uint8_t ctrl1 = _registers[L3GD20H_CTRL1];
+    if (!(ctrl1 & 0x08) || !(ctrl1 & 0x07)) {
+        _last_sample = now;
+        return;
+    }
+
+    uint64_t period = _period();
+    while (_last_sample + period <= now) {
+        _last_sample += period;
+        _samples++;
+
+        int16_t sample[3];
+        for (int axis=0; axis<3; axis++) {
+            sample[axis] = 8000 * sinf(_samples * 0.01f + axis);
+        }
+
+        if (!_fifoEnabled()) {
+            memcpy(_output, sample, sizeof(_output));
+            _output_timestamp = _last_sample;
+            continue;
+        }
+        if (_level == 32) {
+            _overrun = true;
+            _overruns++;
+            if ((_registers[L3GD20H_FIFO_CTRL] >> 5) == 1) {
+                // FIFO mode stops collecting data when full
+                continue;
+            }
+            _head = (_head + 1) % 32;
+            _level--;
+        }
+        memcpy(_fifo[(_head + _level) % 32], sample, sizeof(sample));
+        _timestamps[(_head + _level) % 32] = _last_sample;
+        _level++;
+    }
+}
+
+void SimL3GD20H::_updateInterrupt()
+{
+    if (_int2 == nullptr) {
+        return;
+    }
+
+    _update();
+    uint8_t ctrl1 = _registers[L3GD20H_CTRL1];
+    uint8_t threshold = _registers[L3GD20H_FIFO_CTRL] & 0x1F;
+    bool enabled = (_registers[L3GD20H_CTRL3] & 0x04) && (_registers[L3GD20H_CTRL5] & 0x20)
+            && _fifoEnabled() && threshold > 0 && (ctrl1 & 0x08) && (ctrl1 & 0x07);
+    bool high = enabled && _level >= threshold;
+
+    if (high) {
+        if (!_int2_high && _int2_deadline == 0) {
+            // routed while FIFO is already above watermark
+            _int2->trigger();
+        }
+        // crossing edge was scheduled in the past and has fired or is pending
+        _int2_deadline = 0;
+    } else if (enabled) {
+        uint64_t deadline = _last_sample + (threshold - _level) * _period();
+        if (deadline != _int2_deadline) {
+            _int2->schedule(deadline);
+            _int2_deadline = deadline;
+        }
+    } else if (_int2_deadline != 0) {
+        _int2->cancel();
+        _int2_deadline = 0;
+    }
+    _int2_high = high;
+}
+
+uint8_t SimL3GD20H::_select(uint8_t pointer)
+{
+    _increment = pointer & 0x80;
+    return pointer & 0x7F;
+}
+
+uint8_t SimL3GD20H::_readRegister(uint8_t reg)
+{
+    _update();
+
+    switch (reg) {
+    case L3GD20H_STATUS:
+        return (_fifoEnabled() ? _level > 0 : true) ? 0x0F : 0x00;
+    case L3GD20H_FIFO_SRC: {
+        uint8_t threshold = _registers[L3GD20H_FIFO_CTRL] & 0x1F;
+        uint8_t value = _level < 31 ? _level : 31;
+        if (_level >= threshold && threshold > 0) value |= 0x80;
+        if (_overrun) value |= 0x40;
+        if (_level == 0) value |= 0x20;
+        return value;
+    }
+    default:
+        break;
+    }
+
+    if (reg < L3GD20H_OUT_X_L || reg > L3GD20H_OUT_Z_H) {
+        return _registers[reg];
+    }
+
+    const int16_t *sample = _output;
+    if (_fifoEnabled()) {
+        sample = _fifo[_head];
+    }
+    uint8_t index = reg - L3GD20H_OUT_X_L;
+    uint8_t value = sample[index / 2] >> ((index % 2) * 8);
+
+    if (reg == L3GD20H_OUT_Z_H && _fifoEnabled() && _level > 0) {
+        _last_read_timestamp = _timestamps[_head];
+        _head = (_head + 1) % 32;
+        _level--;
+        _overrun = false;
+        _samples_read++;
+    } else if (reg == L3GD20H_OUT_Z_H && !_fifoEnabled()) {
+        _last_read_timestamp = _output_timestamp;
+        _samples_read++;
+    }
+    return value;
+}
+
+void SimL3GD20H::_writeRegister(uint8_t reg, uint8_t value)
+{
+    _update();
+
+    if (reg == L3GD20H_LOW_ODR && (value & 0x04)) {
+        _reset();
+        return;
+    }
+
+    _registers[reg] = value;
+    if (reg == L3GD20H_FIFO_CTRL && (value >> 5) == 0) {
+        _level = 0;
+        _overrun = false;
+    }
+}
+
+uint8_t SimL3GD20H::_nextRegister(uint8_t reg)
+{
+    if (!_increment) {
+        return reg;
+    }
+    if (reg == L3GD20H_OUT_Z_H && _fifoEnabled()) {
+        return L3GD20H_OUT_X_L;
+    }
+    return reg + 1;
+}
+
+/* MS5611 */
+
+static uint8_t _crc4(uint16_t prom[8])
+{
+    // AN520 reference algorithm, crc is stored in low nibble of the last word
+    uint16_t remainder = 0;
+    uint16_t crc_read = prom[7];
+    prom[7] &= 0xFF00;
+    for (int i=0; i<16; i++) {
+        if (i % 2 == 1) {
+            remainder ^= prom[i >> 1] & 0x00FF;
+        } else {
+            remainder ^= prom[i >> 1] >> 8;
+        }
+        for (int bit=8; bit>0; bit--) {
+            if (remainder & 0x8000) {
+                remainder = (remainder << 1) ^ 0x3000;
+            } else {
+                remainder = remainder << 1;
+            }
+        }
+    }
+    prom[7] = crc_read;
+    return (remainder >> 12) & 0x0F;
+}
+
+SimMS5611::SimMS5611(uint8_t address):
+    SimI2CDevice(address), _d1(9085466), _d2(8569150), _result(0),
+    _conversion_end(0), _conversions(0), _mode(ModeNone), _prom_index(0), _converting(false)
+{
+    static const uint16_t coefficients[6] = {40127, 36924, 23317, 23282, 33464, 28312};
+    setCalibration(coefficients);
+}
+
+void SimMS5611::setRaw(uint32_t d1, uint32_t d2)
+{
+    _d1 = d1;
+    _d2 = d2;
+}
+
+void SimMS5611::setCalibration(const uint16_t coefficients[6])
+{
+    _prom[0] = 0x0000;
+    memcpy(_prom + 1, coefficients, 6 * sizeof(uint16_t));
+    _prom[7] = 0x0000;
+    _prom[7] |= _crc4(_prom);
+}
+
+uint64_t SimMS5611::conversions() const
+{
+    return _conversions;
+}
+
+int SimMS5611::write(const uint8_t data[], size_t size)
+{
+    static const uint64_t conversion_nsec[] = {600000, 1170000, 2280000, 4540000, 9040000};
+
+    if (size == 0) {
+        return 0;
+    }
+
+    uint8_t command = data[0];
+    if (command == 0x1E) {
+        _mode = ModeNone;
+        _converting = false;
+        _result = 0;
+    } else if (command >= 0xA0 && command <= 0xAE) {
+        _mode = ModeProm;
+        _prom_index = (command - 0xA0) / 2;
+    } else if ((command & 0xF0) == 0x40 || (command & 0xF0) == 0x50) {
+        uint8_t osr = (command & 0x0F) / 2;
+        if (osr > 4) {
+            return -1;
+        }
+        _converting = true;
+        _conversion_end = monotonicNsec() + conversion_nsec[osr];
+        _result = (command & 0xF0) == 0x40 ? _d1 : _d2;
+    } else if (command == 0x00) {
+        _mode = ModeAdc;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int SimMS5611::read(uint8_t data[], size_t size)
+{
+    uint32_t value = 0;
+    size_t width = 0;
+    if (_mode == ModeProm) {
+        value = _prom[_prom_index];
+        width = 2;
+    } else if (_mode == ModeAdc) {
+        if (_converting && monotonicNsec() >= _conversion_end) {
+            value = _result;
+            _conversions++;
+        }
+        _converting = false;
+        width = 3;
+    }
+
+    for (size_t i=0; i<size; i++) {
+        data[i] = i < width ? value >> ((width - 1 - i) * 8) : 0;
+    }
+    return 0;
+}
+
+/* BMP180 */
+
+#define BMP180_CALIBRATION      0xAA
+#define BMP180_ID               0xD0
+#define BMP180_SOFT_RESET       0xE0
+#define BMP180_CTRL_MEAS        0xF4
+#define BMP180_OUT_MSB          0xF6
+
+SimBMP180::SimBMP180(uint8_t address):
+    SimRegisterDevice(address), _ut(27898), _up(23843), _pending(0), _conversion_end(0), _converting(false)
+{
+    _reset();
+}
+
+void SimBMP180::setRaw(uint16_t ut, uint32_t up)
+{
+    _ut = ut;
+    _up = up;
+}
+
+void SimBMP180::_reset()
+{
+    static const int16_t calibration[11] = {
+        408, -72, -14383, (int16_t)32741, (int16_t)32757, 23153, 6190, 4, -32768, -8711, 2868
+    };
+
+    memset(_registers, 0, sizeof(_registers));
+    _registers[BMP180_ID] = 0x55;
+    for (int i=0; i<11; i++) {
+        _registers[BMP180_CALIBRATION + i * 2] = (uint16_t)calibration[i] >> 8;
+        _registers[BMP180_CALIBRATION + i * 2 + 1] = (uint16_t)calibration[i] & 0xFF;
+    }
+    _converting = false;
+}
+
+void SimBMP180::_update()
+{
+    if (!_converting || monotonicNsec() < _conversion_end) {
+        return;
+    }
+    _converting = false;
+    _registers[BMP180_CTRL_MEAS] &= ~0x20;
+    _registers[BMP180_OUT_MSB] = _pending >> 16;
+    _registers[BMP180_OUT_MSB + 1] = _pending >> 8;
+    _registers[BMP180_OUT_MSB + 2] = _pending;
+}
+
+uint8_t SimBMP180::_readRegister(uint8_t reg)
+{
+    _update();
+    return _registers[reg];
+}
+
+void SimBMP180::_writeRegister(uint8_t reg, uint8_t value)
+{
+    static const uint64_t conversion_nsec[] = {4500000, 7500000, 13500000, 25500000};
+
+    _update();
+    if (reg == BMP180_SOFT_RESET) {
+        if (value == 0xB6) {
+            _reset();
+        }
+        return;
+    }
+    if (reg != BMP180_CTRL_MEAS) {
+        return;
+    }
+
+    _registers[reg] = value | 0x20;
+    _converting = true;
+    if (value == 0x2E) {
+        _pending = (uint32_t)_ut << 8;
+        _conversion_end = monotonicNsec() + conversion_nsec[0];
+    } else {
+        uint8_t oss = value >> 6;
+        _pending = _up << (8 - oss);
+        _conversion_end = monotonicNsec() + conversion_nsec[oss];
+    }
+}
+
+/* ADS1115 */
+
+SimADS1115::SimADS1115(uint8_t address):
+    SimI2CDevice(address), _conversion_timestamp(0), _pointer(0), _conversion_end(0), _conversions(0), _converting(false)
+{
+    _registers[0] = 0x0000;
+    _registers[1] = 0x8583;
+    _registers[2] = 0x8000;
+    _registers[3] = 0x7FFF;
+    memset(_inputs, 0, sizeof(_inputs));
+}
+
+void SimADS1115::setInput(uint8_t channel, float volts)
+{
+    if (channel < 4) {
+        _inputs[channel] = volts;
+    }
+}
+
+uint64_t SimADS1115::conversions() const
+{
+    return _conversions;
+}
+
+uint64_t SimADS1115::lastConversionTime() const
+{
+    return _conversion_timestamp;
+}
+
+uint64_t SimADS1115::_conversionTime() const
+{
+    static const uint64_t rates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+    return 1000000000ull / rates[(_registers[1] >> 5) & 0x07];
+}
+
+int16_t SimADS1115::_convert() const
+{
+    static const float scales[] = {6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f, 0.256f, 0.256f};
+    static const uint8_t positive[] = {0, 0, 1, 2, 0, 1, 2, 3};
+    static const int8_t negative[] = {1, 3, 3, 3, -1, -1, -1, -1};
+
+    uint8_t mux = (_registers[1] >> 12) & 0x07;
+    float volts = _inputs[positive[mux]] - (negative[mux] < 0 ? 0.f : _inputs[negative[mux]]);
+    float code = volts / scales[(_registers[1] >> 9) & 0x07] * 32768.f;
+    if (code > 32767.f) return 32767;
+    if (code < -32768.f) return -32768;
+    return code;
+}
+
+void SimADS1115::_update()
+{
+    bool single_shot = _registers[1] & 0x0100;
+    uint64_t now = monotonicNsec();
+    if (single_shot) {
+        if (_converting && now >= _conversion_end) {
+            _converting = false;
+            _registers[0] = _convert();
+            _registers[1] |= 0x8000;
+            _conversion_timestamp = _conversion_end;
+            _conversions++;
+        }
+    } else {
+        if (now >= _conversion_end) {
+            uint64_t count = (now - _conversion_end) / _conversionTime() + 1;
+            _registers[0] = _convert();
+            _conversion_timestamp = _conversion_end + (count - 1) * _conversionTime();
+            _conversion_end += count * _conversionTime();
+            _conversions += count;
+        }
+    }
+}
+
+int SimADS1115::write(const uint8_t data[], size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    _update();
+    _pointer = data[0] & 0x03;
+    if (size < 3) {
+        return 0;
+    }
+
+    uint16_t value = data[1] << 8 | data[2];
+    if (_pointer == 0) {
+        return 0;
+    }
+    _registers[_pointer] = value;
+    if (_pointer != 1) {
+        return 0;
+    }
+
+    if (value & 0x0100) {
+        if (value & 0x8000) {
+            // start single conversion, OS reads 0 until it is done
+            _converting = true;
+            _conversion_end = monotonicNsec() + _conversionTime();
+        }
+        _registers[1] = _converting ? value & ~0x8000 : value | 0x8000;
+    } else {
+        _converting = false;
+        _conversion_end = monotonicNsec() + _conversionTime();
+    }
+    return 0;
+}
+
+int SimADS1115::read(uint8_t data[], size_t size)
+{
+    _update();
+    uint16_t value = _registers[_pointer];
+    for (size_t i=0; i<size; i++) {
+        data[i] = i == 0 ? value >> 8 : (i == 1 ? value & 0xFF : 0);
+    }
+    return 0;
+}
+
+/* PCA9685 */
+
+#define PCA9685_MODE1           0x00
+#define PCA9685_MODE2           0x01
+#define PCA9685_LED0            0x06
+#define PCA9685_ALL_LED         0xFA
+#define PCA9685_PRE_SCALE       0xFE
+
+SimPCA9685::SimPCA9685(uint8_t address):
+    SimRegisterDevice(address), _updates(0)
+{
+    _registers[PCA9685_MODE1] = 0x11;
+    _registers[PCA9685_MODE2] = 0x04;
+    _registers[PCA9685_PRE_SCALE] = 0x1E;
+}
+
+void SimPCA9685::getChannel(uint8_t channel, uint16_t &on, uint16_t &off) const
+{
+    const uint8_t *led = _registers + PCA9685_LED0 + 4 * (channel & 0x0F);
+    on = led[0] | (led[1] << 8);
+    off = led[2] | (led[3] << 8);
+}
+
+uint64_t SimPCA9685::updates() const
+{
+    return _updates;
+}
+
+uint8_t SimPCA9685::_readRegister(uint8_t reg)
+{
+    if (reg >= PCA9685_ALL_LED && reg < PCA9685_PRE_SCALE) {
+        return 0;
+    }
+    return _registers[reg];
+}
+
+void SimPCA9685::_writeRegister(uint8_t reg, uint8_t value)
+{
+    if (reg == PCA9685_PRE_SCALE) {
+        if (_registers[PCA9685_MODE1] & 0x10) {
+            _registers[reg] = value < 3 ? 3 : value;
+        }
+        return;
+    }
+    if (reg >= PCA9685_ALL_LED && reg < PCA9685_PRE_SCALE) {
+        for (int channel=0; channel<16; channel++) {
+            _registers[PCA9685_LED0 + 4 * channel + reg - PCA9685_ALL_LED] = value;
+        }
+        _updates++;
+        return;
+    }
+    if (reg >= PCA9685_LED0 && reg < PCA9685_LED0 + 64) {
+        _updates++;
+    }
+    _registers[reg] = value;
+}
+
+uint8_t SimPCA9685::_nextRegister(uint8_t reg)
+{
+    return (_registers[PCA9685_MODE1] & 0x20) ? reg + 1 : reg;
+}
+
+/* SSD1306 */
+
+SimSSD1306::SimSSD1306(uint8_t address):
+    SimI2CDevice(address), _command_size(0), _mode(2),
+    _column(0), _column_start(0), _column_end(127),
+    _page(0), _page_start(0), _page_end(7),
+    _on(false), _data_bytes(0), _commands(0), _frames(0)
+{
+    memset(_ram, 0, sizeof(_ram));
+    memset(_command, 0, sizeof(_command));
+}
+
+const uint8_t* SimSSD1306::ram() const
+{
+    return _ram;
+}
+
+bool SimSSD1306::isOn() const
+{
+    return _on;
+}
+
+uint64_t SimSSD1306::dataBytes() const
+{
+    return _data_bytes;
+}
+
+uint64_t SimSSD1306::commands() const
+{
+    return _commands;
+}
+
+uint64_t SimSSD1306::frames() const
+{
+    return _frames;
+}
+
+int SimSSD1306::write(const uint8_t data[], size_t size)
+{
+    size_t i = 0;
+    while (i < size) {
+        uint8_t control = data[i++];
+        bool is_data = control & 0x40;
+        if (!(control & 0x80)) {
+            // Co = 0, the rest of message is a stream
+            for (; i < size; i++) {
+                is_data ? _dataByte(data[i]) : _commandByte(data[i]);
+            }
+            break;
+        }
+        if (i < size) {
+            is_data ? _dataByte(data[i]) : _commandByte(data[i]);
+            i++;
+        }
+    }
+    return 0;
+}
+
+int SimSSD1306::read(uint8_t data[], size_t size)
+{
+    // status register: bit 6 is display off
+    for (size_t i=0; i<size; i++) {
+        data[i] = _on ? 0x00 : 0x40;
+    }
+    return 0;
+}
+
+void SimSSD1306::_commandByte(uint8_t byte)
+{
+    _command[_command_size++] = byte;
+
+    uint8_t arguments = 0;
+    switch (_command[0]) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        arguments = 1;
+        break;
+    case 0x21: case 0x22: case 0xA3:
+        arguments = 2;
+        break;
+    case 0x29: case 0x2A:
+        arguments = 5;
+        break;
+    case 0x26: case 0x27:
+        arguments = 6;
+        break;
+    }
+
+    if (_command_size > arguments) {
+        _execute();
+        _command_size = 0;
+        _commands++;
+    }
+}
+
+void SimSSD1306::_execute()
+{
+    uint8_t command = _command[0];
+    switch (command) {
+    case 0x20:
+        _mode = _command[1] & 0x03;
+        break;
+    case 0x21:
+        _column_start = _command[1] & 0x7F;
+        _column_end = _command[2] & 0x7F;
+        _column = _column_start;
+        break;
+    case 0x22:
+        _page_start = _command[1] & 0x07;
+        _page_end = _command[2] & 0x07;
+        _page = _page_start;
+        break;
+    case 0xAE:
+        _on = false;
+        break;
+    case 0xAF:
+        _on = true;
+        break;
+    default:
+        if (command >= 0xB0 && command <= 0xB7) {
+            _page = command & 0x07;
+        } else if (command <= 0x0F) {
+            _column = (_column & 0xF0) | command;
+        } else if (command >= 0x10 && command <= 0x17) {
+            _column = (_column & 0x0F) | ((command & 0x07) << 4);
+        }
+        break;
+    }
+}
+
+void SimSSD1306::_dataByte(uint8_t byte)
+{
+    _ram[_page * 128 + _column] = byte;
+    _data_bytes++;
+
+    if (_mode == 0) {
+        if (_column++ == _column_end) {
+            _column = _column_start;
+            if (_page++ == _page_end) {
+                _page = _page_start;
+                _frames++;
+            }
+        }
+    } else if (_mode == 1) {
+        if (_page++ == _page_end) {
+            _page = _page_start;
+            if (_column++ == _column_end) {
+                _column = _column_start;
+                _frames++;
+            }
+        }
+    } else {
+        _column = (_column + 1) & 0x7F;
+    }
+}
+
+/* VZ89 */
+
+SimVZ89::SimVZ89(uint8_t address):
+    SimI2CDevice(address), _command(0)
+{
+    memset(_status, 0, sizeof(_status));
+    setStatus(400, 50, 0);
+}
+
+void SimVZ89::setStatus(float co2, uint8_t reactivity, float tvoc)
+{
+    _status[0] = (co2 - 400) * 229 / 1600 + 13.5f;
+    _status[1] = reactivity;
+    _status[2] = tvoc * 229 / 1000 + 13.5f;
+}
+
+int SimVZ89::write(const uint8_t data[], size_t size)
+{
+    if (size > 0) {
+        _command = data[0];
+    }
+    return 0;
+}
+
+int SimVZ89::read(uint8_t data[], size_t size)
+{
+    for (size_t i=0; i<size; i++) {
+        data[i] = (_command == 0x09 && i < sizeof(_status)) ? _status[i] : 0;
+    }
+    return 0;
+}
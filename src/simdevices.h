@@ -0,0 +1,308 @@
+#ifndef SIMDEVICES_H
+#define SIMDEVICES_H
+
+#include "simi2c.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SimGPIO;
+
+/** Register based device model.
+ * First byte of a write message selects register, following bytes are written
+ * to consecutive registers, read messages continue from selected register.
+ * Models override hooks to implement side effects.
+ */
+class SimRegisterDevice: public SimI2CDevice
+{
+public:
+    SimRegisterDevice(uint8_t address);
+
+    int write(const uint8_t data[], size_t size) override;
+    int read(uint8_t data[], size_t size) override;
+
+    /** Get raw register value without side effects. */
+    uint8_t getRegister(uint8_t reg) const;
+
+    /** Set raw register value without side effects. */
+    void setRegister(uint8_t reg, uint8_t value);
+
+protected:
+    uint8_t _registers[256];
+    uint8_t _pointer;
+
+    /** Decode register address byte. */
+    virtual uint8_t _select(uint8_t pointer);
+    virtual uint8_t _readRegister(uint8_t reg);
+    virtual void _writeRegister(uint8_t reg, uint8_t value);
+    /** Register address after access. */
+    virtual uint8_t _nextRegister(uint8_t reg);
+};
+
+/** ST L3GD20H gyroscope model.
+ * Samples are generated at configured output data rate from CTRL1,
+ * FIFO supports bypass, FIFO and stream like modes with watermark and overrun flags.
+ * Output registers roll back from OUT_Z_H to OUT_X_L in FIFO mode like the chip does.
+ * FIFO watermark could be routed to INT2 (CTRL3 INT2_FTH, CTRL5 FTH_EN).
+ */
+class SimL3GD20H: public SimRegisterDevice
+{
+public:
+    SimL3GD20H(uint8_t address=0x6B);
+
+    int write(const uint8_t data[], size_t size) override;
+    int read(uint8_t data[], size_t size) override;
+
+    /** Connect INT2 pin.
+     * Rising edge is scheduled at the moment FIFO level reaches watermark.
+     * @param int2 - simulated line, nullptr to disconnect
+     */
+    void setInterrupt(SimGPIO *int2);
+
+    /** Amount of samples taken out of FIFO. */
+    uint64_t samplesRead() const;
+
+    /** Amount of samples lost because of FIFO overrun. */
+    uint64_t overruns() const;
+
+    /** CLOCK_MONOTONIC time when the last read sample was measured, in nanoseconds. */
+    uint64_t lastSampleTime() const;
+
+protected:
+    uint8_t _select(uint8_t pointer) override;
+    uint8_t _readRegister(uint8_t reg) override;
+    void _writeRegister(uint8_t reg, uint8_t value) override;
+    uint8_t _nextRegister(uint8_t reg) override;
+
+private:
+    int16_t _fifo[32][3];
+    uint64_t _timestamps[32];
+    int16_t _output[3];
+    uint64_t _output_timestamp;
+    uint64_t _last_read_timestamp;
+    uint8_t _head;
+    uint8_t _level;
+    bool _overrun;
+    bool _increment;
+    uint64_t _last_sample;
+    uint64_t _samples;
+    uint64_t _samples_read;
+    uint64_t _overruns;
+    SimGPIO *_int2;
+    uint64_t _int2_deadline;
+    bool _int2_high;
+
+    void _reset();
+    void _update();
+    void _updateInterrupt();
+    uint64_t _period() const;
+    bool _fifoEnabled() const;
+};
+
+/** MEAS MS5611 barometer model.
+ * Command based: reset, PROM read with valid CRC4, D1/D2 conversions with
+ * datasheet conversion times per oversampling and ADC read.
+ * ADC read returns 0 if conversion is not finished.
+ * Default raw values and calibration are datasheet example: 20.07 C, 1000.09 mbar.
+ */
+class SimMS5611: public SimI2CDevice
+{
+public:
+    SimMS5611(uint8_t address=0x77);
+
+    int write(const uint8_t data[], size_t size) override;
+    int read(uint8_t data[], size_t size) override;
+
+    /** Set raw ADC values.
+     * @param d1 - digital pressure value
+     * @param d2 - digital temperature value
+     */
+    void setRaw(uint32_t d1, uint32_t d2);
+
+    /** Set calibration coefficients C1..C6, CRC is recalculated. */
+    void setCalibration(const uint16_t coefficients[6]);
+
+    /** Amount of finished conversions. */
+    uint64_t conversions() const;
+
+private:
+    enum Mode {
+        ModeNone,
+        ModeProm,
+        ModeAdc
+    };
+
+    uint16_t _prom[8];
+    uint32_t _d1;
+    uint32_t _d2;
+    uint32_t _result;
+    uint64_t _conversion_end;
+    uint64_t _conversions;
+    Mode _mode;
+    uint8_t _prom_index;
+    bool _converting;
+};
+
+/** Bosch BMP180 barometer model.
+ * Chip id, calibration PROM, temperature and pressure conversions with
+ * datasheet conversion times, SCO bit and soft reset.
+ * Defaults are datasheet example: 15.0 C, 699.64 hPa.
+ */
+class SimBMP180: public SimRegisterDevice
+{
+public:
+    SimBMP180(uint8_t address=0x77);
+
+    /** Set raw ADC values.
+     * @param ut - uncompensated temperature
+     * @param up - uncompensated pressure for oversampling 0
+     */
+    void setRaw(uint16_t ut, uint32_t up);
+
+protected:
+    uint8_t _readRegister(uint8_t reg) override;
+    void _writeRegister(uint8_t reg, uint8_t value) override;
+
+private:
+    uint16_t _ut;
+    uint32_t _up;
+    uint32_t _pending;
+    uint64_t _conversion_end;
+    bool _converting;
+
+    void _reset();
+    void _update();
+};
+
+/** TI ADS1115 ADC model.
+ * 16 bit big endian registers behind pointer register, single shot and continuous modes,
+ * conversion time from data rate, input voltages are converted with configured mux and gain.
+ */
+class SimADS1115: public SimI2CDevice
+{
+public:
+    SimADS1115(uint8_t address=0x48);
+
+    int write(const uint8_t data[], size_t size) override;
+    int read(uint8_t data[], size_t size) override;
+
+    /** Set analog input voltage.
+     * @param channel - AIN0..AIN3
+     * @param volts - voltage
+     */
+    void setInput(uint8_t channel, float volts);
+
+    /** Amount of finished conversions. */
+    uint64_t conversions() const;
+
+    /** CLOCK_MONOTONIC time when conversion register was updated, in nanoseconds. */
+    uint64_t lastConversionTime() const;
+
+private:
+    uint16_t _registers[4];
+    uint64_t _conversion_timestamp;
+    uint8_t _pointer;
+    float _inputs[4];
+    uint64_t _conversion_end;
+    uint64_t _conversions;
+    bool _converting;
+
+    void _update();
+    int16_t _convert() const;
+    uint64_t _conversionTime() const;
+};
+
+/** NXP PCA9685 PWM controller model.
+ * Auto increment follows MODE1 AI bit, prescale is writable in sleep mode only,
+ * ALL_LED registers update every channel.
+ */
+class SimPCA9685: public SimRegisterDevice
+{
+public:
+    SimPCA9685(uint8_t address=0x40);
+
+    /** Get channel registers.
+     * @param channel - channel 0..15
+     * @param on - ON counter value
+     * @param off - OFF counter value
+     */
+    void getChannel(uint8_t channel, uint16_t &on, uint16_t &off) const;
+
+    /** Amount of written LED registers. */
+    uint64_t updates() const;
+
+protected:
+    uint8_t _readRegister(uint8_t reg) override;
+    void _writeRegister(uint8_t reg, uint8_t value) override;
+    uint8_t _nextRegister(uint8_t reg) override;
+
+private:
+    uint64_t _updates;
+};
+
+/** Solomon SSD1306 OLED controller model.
+ * Parses control bytes, command streams and data streams, implements horizontal,
+ * vertical and page addressing into 128x64 display RAM.
+ */
+class SimSSD1306: public SimI2CDevice
+{
+public:
+    SimSSD1306(uint8_t address=0x3C);
+
+    int write(const uint8_t data[], size_t size) override;
+    int read(uint8_t data[], size_t size) override;
+
+    /** Display RAM, page major 128x8 bytes. */
+    const uint8_t* ram() const;
+
+    /** Display is on. */
+    bool isOn() const;
+
+    /** Amount of received data bytes. */
+    uint64_t dataBytes() const;
+
+    /** Amount of received commands. */
+    uint64_t commands() const;
+
+    /** Amount of times address window was written completely. */
+    uint64_t frames() const;
+
+private:
+    uint8_t _ram[128 * 8];
+    uint8_t _command[8];
+    uint8_t _command_size;
+    uint8_t _mode;
+    uint8_t _column, _column_start, _column_end;
+    uint8_t _page, _page_start, _page_end;
+    bool _on;
+    uint64_t _data_bytes;
+    uint64_t _commands;
+    uint64_t _frames;
+
+    void _commandByte(uint8_t byte);
+    void _execute();
+    void _dataByte(uint8_t byte);
+};
+
+/** SGX VZ89 air quality sensor model. */
+class SimVZ89: public SimI2CDevice
+{
+public:
+    SimVZ89(uint8_t address=0x70);
+
+    int write(const uint8_t data[], size_t size) override;
+    int read(uint8_t data[], size_t size) override;
+
+    /** Set reported values.
+     * @param co2 - CO2 equivalent in ppm, 400..2000
+     * @param reactivity - raw reactivity
+     * @param tvoc - TVOC in ppb, 0..1000
+     */
+    void setStatus(float co2, uint8_t reactivity, float tvoc);
+
+private:
+    uint8_t _status[6];
+    uint8_t _command;
+};
+
+#endif // SIMDEVICES_H
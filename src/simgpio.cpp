@@ -0,0 +1,87 @@
+#include "simgpio.h"
+#include "poller.h"
+#include "log.h"
+#include "utils.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <cassert>
+
+SimGPIO::SimGPIO():
+    SimGPIO(Poller::getDefault())
+{
+
+}
+
+SimGPIO::SimGPIO(Poller *event_poller):
+    GPIO(event_poller), _scheduled(0), _edges(0)
+{
+    _descriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    assert(_descriptor >= 0);
+    _registerRead();
+}
+
+SimGPIO::~SimGPIO()
+{
+}
+
+const char* SimGPIO::name()
+{
+    return "SimGPIO";
+}
+
+int SimGPIO::schedule(uint64_t timestamp)
+{
+    if (timestamp == 0) {
+        // zero it_value would disarm timer
+        timestamp = 1;
+    }
+    _scheduled.store(timestamp, std::memory_order_relaxed);
+
+    itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = timestamp / 1000000000ull;
+    spec.it_value.tv_nsec = timestamp % 1000000000ull;
+    if (timerfd_settime(_descriptor, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        Error() << "Unable to schedule edge. errno" << errno << strerror(errno);
+        return -1;
+    }
+    return 0;
+}
+
+int SimGPIO::trigger()
+{
+    return schedule(monotonicNsec());
+}
+
+int SimGPIO::cancel()
+{
+    itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (timerfd_settime(_descriptor, 0, &spec, nullptr) < 0) {
+        Error() << "Unable to cancel edge. errno" << errno << strerror(errno);
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t SimGPIO::edges() const
+{
+    return _edges.load(std::memory_order_relaxed);
+}
+
+void SimGPIO::_onRead()
+{
+    uint64_t expirations;
+    if (read(_descriptor, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        if (errno != EAGAIN) {
+            Error() << "Unable to read edge timer";
+        }
+        return;
+    }
+    _edges.fetch_add(1, std::memory_order_relaxed);
+    _edge(_scheduled.load(std::memory_order_relaxed));
+}
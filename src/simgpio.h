@@ -0,0 +1,51 @@
+#ifndef SIMGPIO_H
+#define SIMGPIO_H
+
+#include "gpio.h"
+
+#include <stdint.h>
+#include <atomic>
+
+/** Simulated GPIO input line.
+ *  Device models drive the line by scheduling edges at absolute CLOCK_MONOTONIC time,
+ *  edges are delivered through onEdge from event poller like kernel line events.
+ *  Backed by timerfd so a model does not need its own thread to raise an interrupt
+ *  at the moment its state changes. Scheduling is thread safe.
+ */
+class SimGPIO: public GPIO
+{
+public:
+    /** SimGPIO constructor with default eventloop. */
+    SimGPIO();
+    /** SimGPIO constructor.
+     * @param event_poller - EventPoller instance which will be used to process events.
+     */
+    SimGPIO(Poller *event_poller);
+    virtual ~SimGPIO();
+    virtual const char* name();
+
+    /** Schedule edge, replaces previously scheduled one.
+     * Time in the past fires immediately.
+     * @param timestamp - CLOCK_MONOTONIC time in nanoseconds
+     * @return 0 on success or negative value on error
+     */
+    int schedule(uint64_t timestamp);
+
+    /** Raise edge now. */
+    int trigger();
+
+    /** Cancel scheduled edge. */
+    int cancel();
+
+    /** Amount of delivered edges. */
+    uint64_t edges() const;
+
+protected:
+    virtual void _onRead();
+
+private:
+    std::atomic<uint64_t> _scheduled;
+    std::atomic<uint64_t> _edges;
+};
+
+#endif // SIMGPIO_H
@@ -0,0 +1,157 @@
+#include "simi2c.h"
+#include "log.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cassert>
+
+SimI2CDevice::SimI2CDevice(uint8_t address):
+    _address(address)
+{
+    assert(address < 128);
+}
+
+SimI2CDevice::~SimI2CDevice()
+{
+}
+
+uint8_t SimI2CDevice::address() const
+{
+    return _address;
+}
+
+SimI2C::SimI2C(uint32_t frequency):
+    _mutex(), _byte_nsec(0), _overhead_nsec(0), _realtime(true),
+    _error_rate(0.f), _fail_next(0), _seed(1),
+    _transfers(0), _messages(0), _bytes(0), _errors(0), _busy(0)
+{
+    memset(_devices, 0, sizeof(_devices));
+    setFrequency(frequency);
+}
+
+SimI2C::~SimI2C()
+{
+}
+
+int SimI2C::attach(SimI2CDevice *device)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_devices[device->address()] != nullptr) {
+        Error() << "Address" << device->address() << "is already used";
+        return -1;
+    }
+    _devices[device->address()] = device;
+    return 0;
+}
+
+void SimI2C::detach(SimI2CDevice *device)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_devices[device->address()] == device) {
+        _devices[device->address()] = nullptr;
+    }
+}
+
+void SimI2C::setFrequency(uint32_t frequency)
+{
+    assert(frequency > 0);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _byte_nsec = 9000000000ull / frequency;
+}
+
+void SimI2C::setTransferOverhead(uint64_t nsec)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _overhead_nsec = nsec;
+}
+
+void SimI2C::setRealtime(bool realtime)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _realtime = realtime;
+}
+
+void SimI2C::setErrorRate(float probability)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _error_rate = probability;
+}
+
+void SimI2C::failNext(unsigned count)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _fail_next = count;
+}
+
+int SimI2C::readWrite(i2c_rdwr_ioctl_data &messages)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint64_t start = monotonicNsec();
+
+    uint64_t bytes = 0;
+    int ret = 0;
+    if (_fail_next > 0) {
+        _fail_next--;
+        ret = -1;
+    } else if (_error_rate > 0.f && rand_r(&_seed) < _error_rate * RAND_MAX) {
+        ret = -1;
+    }
+
+    // failed transfer is aborted on the first message
+    for (size_t i=0; i<messages.nmsgs; i++) {
+        i2c_msg &message = messages.msgs[i];
+        bytes += message.len + 1;
+        if (ret < 0) {
+            break;
+        }
+        SimI2CDevice *device = _devices[message.addr & 0x7F];
+        if (device == nullptr) {
+            ret = -1;
+        } else if (message.flags & I2C_M_RD) {
+            ret = device->read(message.buf, message.len);
+        } else {
+            ret = device->write(message.buf, message.len);
+        }
+    }
+
+    uint64_t duration = _overhead_nsec + bytes * _byte_nsec;
+    _transfers++;
+    _messages += messages.nmsgs;
+    _bytes += bytes;
+    _busy += duration;
+
+    if (_realtime) {
+        uint64_t end = start + duration;
+        timespec deadline;
+        deadline.tv_sec = end / 1000000000ull;
+        deadline.tv_nsec = end % 1000000000ull;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) != 0);
+    }
+
+    if (ret < 0) {
+        _errors++;
+        Debug() << "Simulated transfer failed";
+        return -1;
+    }
+    return 0;
+}
+
+void SimI2C::getStatistics(uint64_t &transfers, uint64_t &messages, uint64_t &bytes,
+                           uint64_t &errors, uint64_t &busy_nsec)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    transfers = _transfers;
+    messages = _messages;
+    bytes = _bytes;
+    errors = _errors;
+    busy_nsec = _busy;
+}
+
+void SimI2C::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _transfers = _messages = _bytes = _errors = _busy = 0;
+}
@@ -0,0 +1,130 @@
+#ifndef SIMI2C_H
+#define SIMI2C_H
+
+#include "i2cbus.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+/** Simulated i2c device.
+ * Device receives bus messages addressed to it, see SimI2C.
+ * Models live in simdevices.h.
+ */
+class SimI2CDevice
+{
+public:
+    /** Constructor.
+     * @param address - i2c device address
+     */
+    SimI2CDevice(uint8_t address);
+    SimI2CDevice(const SimI2CDevice& that) = delete;  /**< Copy contructor not allowed because of device state. */
+    virtual ~SimI2CDevice();
+
+    /** Get device address. */
+    uint8_t address() const;
+
+    /** Handle master write message.
+     * @param data - message data
+     * @param size - message size
+     * @return 0 on success or negative value to NACK
+     */
+    virtual int write(const uint8_t data[], size_t size) = 0;
+
+    /** Handle master read message.
+     * @param data - buffer to fill
+     * @param size - message size
+     * @return 0 on success or negative value to NACK
+     */
+    virtual int read(uint8_t data[], size_t size) = 0;
+
+protected:
+    uint8_t _address;
+};
+
+/** In-process simulated i2c bus.
+ * Transfers are routed to attached device models and take as much time as they would
+ * on a real bus: every byte including address takes 9 bit times, plus fixed transfer
+ * overhead which stands for syscall and adapter setup. Transfers are serialized like
+ * on a real adapter. Errors could be injected to test driver error paths.
+ * Counters give syscall equivalent numbers: one readWrite() is one ioctl.
+ */
+class SimI2C: public I2CBus
+{
+public:
+    /** Constructor.
+     * @param frequency - bus clock in Hz.
+     */
+    SimI2C(uint32_t frequency=400000);
+    SimI2C(const SimI2C& that) = delete;  /**< Copy contructor not allowed because of bus state. */
+    ~SimI2C();
+
+    /** Attach device model, device should outlive the bus or be detached.
+     * @param device - device model
+     * @return 0 on success or negative value on error
+     */
+    int attach(SimI2CDevice *device);
+
+    /** Detach device model.
+     * @param device - device model
+     */
+    void detach(SimI2CDevice *device);
+
+    /** Set bus clock.
+     * @param frequency - bus clock in Hz.
+     */
+    void setFrequency(uint32_t frequency);
+
+    /** Set fixed time added to every transfer.
+     * @param nsec - overhead in nanoseconds, 0 by default.
+     */
+    void setTransferOverhead(uint64_t nsec);
+
+    /** Enable or disable waiting for transfer time, enabled by default.
+     * When disabled transfers complete immediately and only busy time is accounted.
+     */
+    void setRealtime(bool realtime);
+
+    /** Set probability of failed transfer.
+     * @param probability - value in range 0..1
+     */
+    void setErrorRate(float probability);
+
+    /** Fail next transfers.
+     * @param count - amount of transfers to fail.
+     */
+    void failNext(unsigned count);
+
+    int readWrite(i2c_rdwr_ioctl_data &messages) override;
+
+    /** Get bus counters since last reset.
+     * @param transfers - readWrite() calls, i.e. syscalls on real adapter.
+     * @param messages - i2c messages
+     * @param bytes - transferred bytes including addresses
+     * @param errors - failed transfers
+     * @param busy_nsec - time bus was busy
+     */
+    void getStatistics(uint64_t &transfers, uint64_t &messages, uint64_t &bytes,
+                       uint64_t &errors, uint64_t &busy_nsec);
+
+    /** Reset counters. */
+    void resetStatistics();
+
+private:
+    std::mutex _mutex;
+    SimI2CDevice *_devices[128];
+    uint64_t _byte_nsec;
+    uint64_t _overhead_nsec;
+    bool _realtime;
+    float _error_rate;
+    unsigned _fail_next;
+    unsigned _seed;
+
+    uint64_t _transfers;
+    uint64_t _messages;
+    uint64_t _bytes;
+    uint64_t _errors;
+    uint64_t _busy;
+};
+
+#endif // SIMI2C_H
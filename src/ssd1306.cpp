@@ -1,10 +1,13 @@
 #include "ssd1306.h"
-#include "i2c.h"
+#include "i2cbus.h"
+#include "i2casync.h"
+#include "i2cbatch.h"
+#include "timer.h"
 #include "log.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-
-#include "fonts/fonts.inc"
+#include <algorithm>
 
 #define SSD1306_SETCONTRAST 0x81
 #define SSD1306_DISPLAYALLON_RESUME 0xA4
@@ -45,62 +48,102 @@
 
 #define SSD1306_TRANSACTION_SIZE 128
 
+#define SSD1306_PAGES 8
+
+// address window commands and data control byte cost of one more rectangle
+#define SSD1306_RECT_OVERHEAD 10
+
+// changed spans per page, with 2 all rectangles fit into one I2C_RDWR ioctl
+#define SSD1306_PAGE_SPANS 2
+#define SSD1306_MAX_RECTS (SSD1306_PAGES * SSD1306_PAGE_SPANS)
+
 SSD1306::SSD1306():
-    SSD1306(SSD1306_I2C_ADDRESS, I2C::getDefault(), false)
+    SSD1306(SSD1306_I2C_ADDRESS, I2CBus::getDefault(), false)
 {
 }
 
-SSD1306::SSD1306(uint8_t address, I2C *bus, bool ext_vcc):
-    _i2c(bus), _address(address), _ext_vcc(ext_vcc), _buffer(nullptr)
+SSD1306::SSD1306(uint8_t address, I2CBus *bus, bool ext_vcc):
+    _i2c(bus), _async(nullptr), _address(address), _ext_vcc(ext_vcc), _buffer(nullptr),
+    _sent(nullptr), _sent_valid(false), _commit_running(false), _commit_queued(false), _commit_pending(0),
+    _chunk_timer(nullptr), _chunks(), _chunk(0), _chunk_page(0)
 {
     _buffer = new uint8_t [width()*height()/8];
+    _sent = new uint8_t [width()*height()/8];
+    invalidate();
+}
+
+SSD1306::SSD1306(uint8_t address, I2CAsync *bus, bool ext_vcc):
+    SSD1306(address, bus->bus(), ext_vcc)
+{
+    _async = bus;
+}
+
+SSD1306::SSD1306(uint8_t address, I2CBus *bus, bool ext_vcc, Poller *event_poller):
+    SSD1306(address, bus, ext_vcc)
+{
+    _chunk_timer = new Timer(event_poller);
+    _chunk_timer->onTimeout = [this]() { _commitChunk(); };
+    _chunks.reserve(SSD1306_MAX_RECTS);
 }
 
 SSD1306::~SSD1306()
 {
+    delete _chunk_timer; _chunk_timer = nullptr;
+    delete [] _sent; _sent = nullptr;
     delete [] _buffer; _buffer = nullptr;
 }
 
 int SSD1306::initialize()
 {
+    I2CBatch batch(_i2c);
+    batch.setMerge(_address, I2CBatch::MergeStream);
+
     // TODO: remove magic
-    _sendCommand(SSD1306_DISPLAYOFF);
+    _sendCommand(batch, SSD1306_DISPLAYOFF);
 
-    _sendCommand(SSD1306_SETDISPLAYCLOCKDIV);
-    _sendCommand(0xF0);
+    _sendCommand(batch, SSD1306_SETDISPLAYCLOCKDIV);
+    _sendCommand(batch, 0xF0);
 
-    _sendCommand(SSD1306_SETMULTIPLEX);
-    _sendCommand(0x3F);
+    _sendCommand(batch, SSD1306_SETMULTIPLEX);
+    _sendCommand(batch, 0x3F);
 
-    _sendCommand(SSD1306_SETDISPLAYOFFSET);
-    _sendCommand(0x00);
+    _sendCommand(batch, SSD1306_SETDISPLAYOFFSET);
+    _sendCommand(batch, 0x00);
 
-    _sendCommand(SSD1306_SETSTARTLINE | 0x0);
+    _sendCommand(batch, SSD1306_SETSTARTLINE | 0x0);
 
-    _sendCommand(SSD1306_CHARGEPUMP);
-    _sendCommand(_ext_vcc ? 0x10 : 0x14);
+    _sendCommand(batch, SSD1306_CHARGEPUMP);
+    _sendCommand(batch, _ext_vcc ? 0x10 : 0x14);
 
-    _sendCommand(SSD1306_MEMORYMODE);
-    _sendCommand(0x00);
+    _sendCommand(batch, SSD1306_MEMORYMODE);
+    _sendCommand(batch, 0x00);
 
-    _sendCommand(SSD1306_SEGREMAP | 0x1);
-    _sendCommand(SSD1306_COMSCANDEC);
+    _sendCommand(batch, SSD1306_SEGREMAP | 0x1);
+    _sendCommand(batch, SSD1306_COMSCANDEC);
 
-    _sendCommand(SSD1306_SETCOMPINS);
-    _sendCommand(0x12);
+    _sendCommand(batch, SSD1306_SETCOMPINS);
+    _sendCommand(batch, 0x12);
 
-    _sendCommand(SSD1306_SETCONTRAST);
-    _sendCommand(_ext_vcc ? 0x9F : 0xCF);
+    _sendCommand(batch, SSD1306_SETCONTRAST);
+    _sendCommand(batch, _ext_vcc ? 0x9F : 0xCF);
 
-    _sendCommand(SSD1306_SETPRECHARGE);
-    _sendCommand(_ext_vcc ? 0x22 : 0xF1);
+    _sendCommand(batch, SSD1306_SETPRECHARGE);
+    _sendCommand(batch, _ext_vcc ? 0x22 : 0xF1);
 
-    _sendCommand(SSD1306_SETVCOMDETECT);
-    _sendCommand(0x40);
+    _sendCommand(batch, SSD1306_SETVCOMDETECT);
+    _sendCommand(batch, 0x40);
 
-    _sendCommand(SSD1306_DISPLAYALLON_RESUME);
-    _sendCommand(SSD1306_NORMALDISPLAY);
-    _sendCommand(SSD1306_DISPLAYON);
+    _sendCommand(batch, SSD1306_DISPLAYALLON_RESUME);
+    _sendCommand(batch, SSD1306_NORMALDISPLAY);
+    _sendCommand(batch, SSD1306_DISPLAYON);
+
+    if (batch.submit() < 0) {
+        Error() << "Unable to initialize display, device communication error";
+        return -1;
+    }
+
+    // display memory content is unknown after power up
+    invalidate();
 
     return 0;
 }
@@ -122,32 +165,66 @@ size_t SSD1306::height()
 
 int SSD1306::commit()
 {
-    _sendCommand(SSD1306_COLUMNADDR);
-    _sendCommand(0);    // Column start address (0 = reset)
-    _sendCommand(127);  // Column end address (127 = reset)
+    if (_async != nullptr || _chunk_timer != nullptr) {
+        if (_commit_running) {
+            _commit_queued = true;
+            return 0;
+        }
+        return _async != nullptr ? _commitAsync() : _commitChunked();
+    }
+
+    Rect rects[SSD1306_MAX_RECTS];
+    size_t count = _takeChanges(rects);
+    if (count == 0) {
+        return 0;
+    }
 
-    _sendCommand(SSD1306_PAGEADDR);
-    _sendCommand(0);    // Page start address (0 = reset)
-    _sendCommand(7);    // Page end address
+    // whole commit is one ioctl: command and data messages alternate per rectangle
+    I2CBatch batch(_i2c);
+    batch.setMerge(_address, I2CBatch::MergeStream);
 
-    uint8_t data[SSD1306_TRANSACTION_SIZE+1];
-    for (size_t i=0; i < width()*height()/8/SSD1306_TRANSACTION_SIZE; i++) {
-        data[0] = 0x40;
-        memcpy(data+1, _buffer+i*SSD1306_TRANSACTION_SIZE, SSD1306_TRANSACTION_SIZE);
-        _i2c->writeBatch(_address, sizeof(data), data);
+    for (size_t i=0; i<count; i++) {
+        const Rect &rect = rects[i];
+        _sendCommand(batch, SSD1306_COLUMNADDR);
+        _sendCommand(batch, rect.column_begin);
+        _sendCommand(batch, rect.column_end);
+
+        _sendCommand(batch, SSD1306_PAGEADDR);
+        _sendCommand(batch, rect.page_begin);
+        _sendCommand(batch, rect.page_end);
+
+        // data writes are merged into one message
+        uint8_t size = rect.column_end - rect.column_begin + 1;
+        for (size_t page=rect.page_begin; page<=rect.page_end; page++) {
+            batch.writeBytes(_address, 0x40, size, _sent + page*width() + rect.column_begin);
+        }
     }
 
+    if (batch.submit() < 0) {
+        // display memory is unknown now, resend everything with next frame
+        invalidate();
+        return -1;
+    }
     return 0;
 }
 
+void SSD1306::invalidate()
+{
+    for (size_t page=0; page<SSD1306_PAGES; page++) {
+        _dirty[page].begin = 0;
+        _dirty[page].end = width() - 1;
+    }
+    _sent_valid = false;
+}
+
 void SSD1306::fill()
 {
-    memset(_buffer, 0xFF, width()*height()/8);
+    _fillPages(0xFF);
 }
 
 void SSD1306::clear()
 {
-    memset(_buffer, 0x00, width()*height()/8);
+    _fillPages(0x00);
 }
 
 void SSD1306::drawPixel(uint8_t x, uint8_t y, uint8_t color)
@@ -161,76 +238,128 @@ void SSD1306::drawPixel(uint8_t x, uint8_t y, uint8_t color)
     uint8_t page_offset = y % 8;
     uint8_t segment = x;
 
+    uint8_t &byte = _buffer[page*width()+segment];
+    uint8_t value = byte;
     if (color == COLOR_WHITE) {
-        _buffer[page*width()+segment] = _buffer[page*width()+segment] | (1 << page_offset);
+        value = byte | (1 << page_offset);
     } else if (color == COLOR_BLACK) {
-        _buffer[page*width()+segment] = _buffer[page*width()+segment] & ~(1 << page_offset);
+        value = byte & ~(1 << page_offset);
     } else if (color == COLOR_INVERT) {
-        _buffer[page*width()+segment] = _buffer[page*width()+segment] ^ (1 << page_offset);
+        value = byte ^ (1 << page_offset);
+    }
+
+    if (value != byte) {
+        byte = value;
+        _markDirty(page, segment, segment);
     }
 }
 
 void SSD1306::drawLine(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t color)
 {
-    if (x2<x1) std::swap(x1, x2);
-    if (y2<y1) std::swap(y1, y2);
+    if (y1 == y2) {
+        _fillRect(std::min(x1, x2), y1, abs(x2 - x1) + 1, 1, color);
+        return;
+    }
+    if (x1 == x2) {
+        _fillRect(x1, std::min(y1, y2), 1, abs(y2 - y1) + 1, color);
+        return;
+    }
 
-    if (x2 == x1) {
-        uint8_t y=y1;
-        do {
-            drawPixel(x1, y, color);
-            y++;
-        } while(y<y2);
-    } else if (y2==y1) {
-        uint8_t x=x1;
-        do {
-            drawPixel(x, y1, color);
-            x++;
-        } while(x<x2);
-    } else {
-        uint8_t x=0;
-        do {
-            uint16_t y = y1 + x * (y2-y1) / (x2-x1);
-            drawPixel(x1+x, y, color);
-            x++;
-        } while(x<(x2-x1));
-    }
-}
-
-void SSD1306::drawText(uint8_t x, uint8_t y, std::string text, uint8_t color, uint8_t font)
+    // integer Bresenham, every pixel is visited once, so COLOR_INVERT works too
+    int dx = abs(x2 - x1);
+    int dy = -abs(y2 - y1);
+    int step_x = x1 < x2 ? 1 : -1;
+    int step_y = y1 < y2 ? 1 : -1;
+    int error = dx + dy;
+    int x = x1, y = y1;
+    for (;;) {
+        _plot(x, y, color);
+        if (x == x2 && y == y2) {
+            break;
+        }
+        int error2 = 2 * error;
+        if (error2 >= dy) {
+            error += dy;
+            x += step_x;
+        }
+        if (error2 <= dx) {
+            error += dx;
+            y += step_y;
+        }
+    }
+
+    // bounding box is marked, commit compares bytes anyway
+    int left = std::min(x1, x2);
+    int right = std::min<int>(std::max(x1, x2), width() - 1);
+    int top = std::min(y1, y2);
+    int bottom = std::min<int>(std::max(y1, y2), height() - 1);
+    if (left > right || top > bottom) {
+        return;
+    }
+    for (int page = top / 8; page <= bottom / 8; page++) {
+        _markDirty(page, left, right);
+    }
+}
+
+void SSD1306::drawHorizontalLine(uint8_t x, uint8_t y, uint8_t width, uint8_t color)
 {
-    drawText(x, y, 127, 63, text, color, font);
+    _fillRect(x, y, width, 1, color);
 }
 
-void SSD1306::drawText(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, std::string text, uint8_t color, uint8_t font)
+void SSD1306::drawVerticalLine(uint8_t x, uint8_t y, uint8_t height, uint8_t color)
 {
-    if (x2<x1) std::swap(x1, x2);
-    if (y2<y1) std::swap(y1, y2);
+    _fillRect(x, y, 1, height, color);
+}
 
-    const uint8_t* psf_font = getFont(font);
-    const uint32_t* header = reinterpret_cast<const uint32_t*>(psf_font);
+void SSD1306::drawRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t color)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+    _fillRect(x, y, width, 1, color);
+    if (height > 1) {
+        _fillRect(x, y + height - 1, width, 1, color);
+    }
+    // sides skip top and bottom rows
+    if (height > 2) {
+        _fillRect(x, y + 1, 1, height - 2, color);
+        if (width > 1) {
+            _fillRect(x + width - 1, y + 1, 1, height - 2, color);
+        }
+    }
+}
 
-    uint32_t magic          = header[0];
-    uint32_t version        = header[1];
-    uint32_t header_size    = header[2];
-    uint32_t flags          = header[3];
-    uint32_t chars_count    = header[4];
-    uint32_t char_length    = header[5];
-    uint32_t char_height    = header[6];
-    uint32_t char_width     = header[7];
+void SSD1306::fillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t color)
+{
+    _fillRect(x, y, width, height, color);
+}
 
-    assert(magic == 0x864ab572);
-    assert(version == 0);
-    assert(flags == 0x1);
-    assert(chars_count > 255);
+void SSD1306::drawBitmap(int x, int y, const uint8_t bitmap[], uint8_t width, uint8_t height, uint8_t color)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+    _blit(x, y, bitmap, width, height, color);
+}
 
-    psf_font += header_size;
+void SSD1306::drawText(uint8_t x, uint8_t y, const std::string &text, uint8_t color, uint8_t font)
+{
+    drawText(x, y, 127, 63, text, color, font);
+}
+
+void SSD1306::drawText(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, const std::string &text, uint8_t color, uint8_t font)
+{
+    if (x2<x1) std::swap(x1, x2);
+    if (y2<y1) std::swap(y1, y2);
 
-    uint32_t width = x2 - x1;
-    uint32_t columns = width / char_width;
+    const Font &glyphs = Font::get(font);
+    uint32_t columns = (x2 - x1) / glyphs.width();
+    if (columns == 0) {
+        return;
+    }
 
     int pos=0;
-    for (std::string::iterator it=text.begin(); it!=text.end(); ++it) {
+    for (std::string::const_iterator it=text.begin(); it!=text.end(); ++it) {
         switch (*it) {
         case '\n':
             pos += columns - pos % columns;
@@ -240,24 +369,362 @@ void SSD1306::drawText(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, std::stri
             break;
         }
 
-        uint16_t text_x = x1 + (pos % columns) * char_width;
-        uint16_t text_y = y1 + (pos / columns) * char_height;
-        uint16_t real_width = char_width + (8 - char_width % 8) % 8; // 8bit aligning
-        const uint8_t * font_char = psf_font + char_length * (*it);
-
-        if (text_y < y2) {
-            for (uint8_t ih=0; ih<char_height; ih++) {
-                for (uint8_t iw=0; iw<real_width; iw++) {
-                    size_t offset = ih * real_width / 8 + iw / 8;
-                    uint8_t probe_mask = 0b10000000 >> (iw % 8);
-                    if (*(font_char + offset) & probe_mask) {
-                        drawPixel(text_x + iw, text_y + ih, color);
-                    }
+        int text_x = x1 + (pos % columns) * glyphs.width();
+        int text_y = y1 + (pos / columns) * glyphs.height();
+        if (text_y >= y2) {
+            break;
+        }
+        _blit(text_x, text_y, glyphs.glyph(*it), glyphs.width(), glyphs.height(), color);
+
+        pos++;
+    }
+}
+
+size_t SSD1306::textWidth(const std::string &text, uint8_t font)
+{
+    return Font::get(font).textWidth(text);
+}
+
+int SSD1306::_commitAsync()
+{
+    Rect rects[SSD1306_MAX_RECTS];
+    size_t count = _takeChanges(rects);
+    if (count == 0) {
+        return 0;
+    }
+
+    // callbacks run from event loop, none of them could run before all transactions are submitted
+    I2CAsync::Callback callback = [this](int result, I2CAsync::Transaction&) {
+        if (result < 0) {
+            Error() << "Unable to send frame, device communication error";
+            invalidate();
+        }
+        if (--_commit_pending == 0) {
+            _commitDone();
+        }
+    };
+
+    _commit_running = true;
+    for (size_t i=0; i<count; i++) {
+        const Rect &rect = rects[i];
+        const uint8_t commands[] = {
+            0x00,   // Command stream
+            SSD1306_COLUMNADDR, rect.column_begin, rect.column_end,
+            SSD1306_PAGEADDR, rect.page_begin, rect.page_end
+        };
+
+        I2CAsync::Transaction setup;
+        setup.write(_address, sizeof(commands), commands);
+        if (_async->submit(std::move(setup), callback, I2CAsync::PriorityLow) < 0) {
+            invalidate();
+            _commit_running = _commit_pending > 0;
+            return -1;
+        }
+        _commit_pending++;
+
+        // one transaction per page lets higher priority reads in between
+        size_t size = rect.column_end - rect.column_begin + 1;
+        for (size_t page=rect.page_begin; page<=rect.page_end; page++) {
+            I2CAsync::Transaction data;
+            data.writeBytes(_address, 0x40, size, _sent + page*width() + rect.column_begin);
+            if (_async->submit(std::move(data), callback, I2CAsync::PriorityLow) < 0) {
+                invalidate();
+                _commit_running = _commit_pending > 0;
+                return -1;
+            }
+            _commit_pending++;
+        }
+    }
+
+    return 0;
+}
+
+int SSD1306::_commitChunked()
+{
+    Rect rects[SSD1306_MAX_RECTS];
+    size_t count = _takeChanges(rects);
+    if (count == 0) {
+        return 0;
+    }
+
+    _chunks.assign(rects, rects + count);
+    _chunk = 0;
+    _chunk_page = rects[0].page_begin;
+
+    // the shortest timeout fires on the next loop iteration, after events which are ready already
+    if (_chunk_timer->start({0, 1}, {0, 0}) < 0) {
+        Error() << "Unable to schedule frame";
+        invalidate();
+        return -1;
+    }
+    _commit_running = true;
+    return 0;
+}
+
+void SSD1306::_commitChunk()
+{
+    const Rect &rect = _chunks[_chunk];
+
+    I2CBatch batch(_i2c);
+    batch.setMerge(_address, I2CBatch::MergeStream);
+
+    // address window stays set between chunks, nobody else writes to display
+    if (_chunk_page == rect.page_begin) {
+        _sendCommand(batch, SSD1306_COLUMNADDR);
+        _sendCommand(batch, rect.column_begin);
+        _sendCommand(batch, rect.column_end);
+
+        _sendCommand(batch, SSD1306_PAGEADDR);
+        _sendCommand(batch, rect.page_begin);
+        _sendCommand(batch, rect.page_end);
+    }
+    uint8_t size = rect.column_end - rect.column_begin + 1;
+    batch.writeBytes(_address, 0x40, size, _sent + _chunk_page*width() + rect.column_begin);
+
+    if (batch.submit() < 0) {
+        Error() << "Unable to send frame, device communication error";
+        invalidate();
+        _commitDone();
+        return;
+    }
+
+    if (_chunk_page++ == rect.page_end) {
+        if (++_chunk == _chunks.size()) {
+            _commitDone();
+            return;
+        }
+        _chunk_page = _chunks[_chunk].page_begin;
+    }
+
+    if (_chunk_timer->start({0, 1}, {0, 0}) < 0) {
+        Error() << "Unable to schedule frame";
+        invalidate();
+        _commitDone();
+    }
+}
+
+void SSD1306::_commitDone()
+{
+    _commit_running = false;
+    if (_commit_queued) {
+        _commit_queued = false;
+        commit();
+    }
+}
+
+void SSD1306::_markDirty(uint8_t page, uint8_t begin, uint8_t end)
+{
+    Span &span = _dirty[page];
+    if (span.begin > span.end) {
+        span.begin = begin;
+        span.end = end;
+        return;
+    }
+    if (begin < span.begin) span.begin = begin;
+    if (end > span.end) span.end = end;
+}
+
+size_t SSD1306::_changedSpans(uint8_t page, Span spans[])
+{
+    const Span &dirty = _dirty[page];
+    if (dirty.begin > dirty.end) {
+        return 0;
+    }
+    if (!_sent_valid) {
+        spans[0] = dirty;
+        return 1;
+    }
+
+    // bytes outside of dirty span are equal to sent ones, so comparing whole words is safe,
+    // words never cross row end because width is multiple of 8
+    const uint8_t *row = _buffer + page*width();
+    const uint8_t *sent = _sent + page*width();
+    size_t count = 0;
+    for (size_t word = dirty.begin & ~7u; word <= dirty.end; word += 8) {
+        uint64_t current, previous;
+        memcpy(&current, row + word, sizeof(current));
+        memcpy(&previous, sent + word, sizeof(previous));
+        if (current == previous) {
+            continue;
+        }
+        for (size_t column = word; column < word + 8; column++) {
+            if (row[column] == sent[column]) {
+                continue;
+            }
+            // short gaps are cheaper to send than another address window
+            if (count > 0 && (count == SSD1306_PAGE_SPANS || column <= (size_t)spans[count-1].end + SSD1306_RECT_OVERHEAD)) {
+                spans[count-1].end = column;
+            } else {
+                spans[count++] = Span{(uint8_t)column, (uint8_t)column};
+            }
+        }
+    }
+    return count;
+}
+
+size_t SSD1306::_takeChanges(Rect rects[])
+{
+    // vertically adjacent single span pages share one address window
+    // when extra bytes cost less than another window
+    size_t count = 0;
+    bool mergeable = false;
+    for (uint8_t page=0; page<SSD1306_PAGES; page++) {
+        Span spans[SSD1306_PAGE_SPANS];
+        size_t spans_count = _changedSpans(page, spans);
+
+        for (size_t i=0; i<spans_count; i++) {
+            const Span &span = spans[i];
+            if (spans_count == 1 && mergeable && rects[count-1].page_end + 1 == page) {
+                Rect &last = rects[count-1];
+                size_t pages = last.page_end - last.page_begin + 1;
+                size_t begin = std::min(last.column_begin, span.begin);
+                size_t end = std::max(last.column_end, span.end);
+                size_t merged = (end - begin + 1) * (pages + 1);
+                size_t separate = (last.column_end - last.column_begin + 1) * pages
+                                + (span.end - span.begin + 1) + SSD1306_RECT_OVERHEAD;
+                if (merged <= separate) {
+                    last.column_begin = begin;
+                    last.column_end = end;
+                    last.page_end = page;
+                    continue;
                 }
             }
+            rects[count++] = Rect{span.begin, span.end, page, page};
         }
+        mergeable = spans_count == 1;
 
-        pos++;
+        _dirty[page].begin = 1;
+        _dirty[page].end = 0;
+    }
+
+    // sent frame is updated right away, transfers read from it
+    for (size_t i=0; i<count; i++) {
+        const Rect &rect = rects[i];
+        size_t size = rect.column_end - rect.column_begin + 1;
+        for (size_t page=rect.page_begin; page<=rect.page_end; page++) {
+            size_t offset = page*width() + rect.column_begin;
+            memcpy(_sent + offset, _buffer + offset, size);
+        }
+    }
+    _sent_valid = true;
+    return count;
+}
+
+void SSD1306::_blit(int x, int y, const uint8_t bitmap[], int bitmap_width, int bitmap_height, uint8_t color)
+{
+    int column_begin = std::max(0, -x);
+    int column_end = std::min(bitmap_width, (int)width() - x);
+    if (column_begin >= column_end || y >= (int)height() || y + bitmap_height <= 0) {
+        return;
+    }
+    size_t size = column_end - column_begin;
+
+    // every source page lands on two display pages when y is not page aligned
+    int shift = ((y % 8) + 8) % 8;
+    int first_page = (y - shift) / 8;
+    int pages = (bitmap_height + 7) / 8;
+    for (int source_page=0; source_page<pages; source_page++) {
+        const uint8_t *source = bitmap + source_page * bitmap_width + column_begin;
+        uint8_t mask = 0xFF;
+        if (source_page == pages - 1 && bitmap_height % 8) {
+            mask = (1 << (bitmap_height % 8)) - 1;
+        }
+
+        for (int half=0; half<(shift ? 2 : 1); half++) {
+            int page = first_page + source_page + half;
+            if (page < 0 || page >= SSD1306_PAGES) {
+                continue;
+            }
+            uint8_t bits[SSD1306_TRANSACTION_SIZE];
+            for (size_t i=0; i<size; i++) {
+                uint8_t value = source[i] & mask;
+                bits[i] = half ? value >> (8 - shift) : value << shift;
+            }
+
+            uint8_t *row = _buffer + page*width() + x + column_begin;
+            if (color == COLOR_WHITE) {
+                for (size_t i=0; i<size; i++) row[i] |= bits[i];
+            } else if (color == COLOR_BLACK) {
+                for (size_t i=0; i<size; i++) row[i] &= ~bits[i];
+            } else if (color == COLOR_INVERT) {
+                for (size_t i=0; i<size; i++) row[i] ^= bits[i];
+            }
+            _markDirty(page, x + column_begin, x + column_end - 1);
+        }
+    }
+}
+
+void SSD1306::_fillRect(int x, int y, int rect_width, int rect_height, uint8_t color)
+{
+    int x_end = std::min(x + rect_width, (int)width());
+    int y_end = std::min(y + rect_height, (int)height());
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    if (x >= x_end || y >= y_end) {
+        return;
+    }
+    size_t size = x_end - x;
+
+    // one mask per page, pages covered completely are plain memset
+    for (int page = y / 8; page <= (y_end - 1) / 8; page++) {
+        int top = std::max(y - page * 8, 0);
+        int bottom = std::min(y_end - page * 8, 8);
+        uint8_t mask = (0xFF << top) & (0xFF >> (8 - bottom));
+
+        uint8_t *row = _buffer + page*width() + x;
+        if (color == COLOR_WHITE) {
+            if (mask == 0xFF) {
+                memset(row, 0xFF, size);
+            } else {
+                for (size_t i=0; i<size; i++) row[i] |= mask;
+            }
+        } else if (color == COLOR_BLACK) {
+            if (mask == 0xFF) {
+                memset(row, 0x00, size);
+            } else {
+                for (size_t i=0; i<size; i++) row[i] &= ~mask;
+            }
+        } else if (color == COLOR_INVERT) {
+            for (size_t i=0; i<size; i++) row[i] ^= mask;
+        }
+        _markDirty(page, x, x_end - 1);
+    }
+}
+
+void SSD1306::_plot(int x, int y, uint8_t color)
+{
+    // caller marks dirty region
+    if (x < 0 || y < 0 || x >= (int)width() || y >= (int)height()) {
+        return;
+    }
+    uint8_t &byte = _buffer[(y / 8)*width() + x];
+    uint8_t bit = 1 << (y % 8);
+    if (color == COLOR_WHITE) {
+        byte |= bit;
+    } else if (color == COLOR_BLACK) {
+        byte &= ~bit;
+    } else if (color == COLOR_INVERT) {
+        byte ^= bit;
+    }
+}
+
+void SSD1306::_fillPages(uint8_t value)
+{
+    // only columns which really change are marked, so clear() and redraw don't resend the whole frame
+    for (size_t page=0; page<SSD1306_PAGES; page++) {
+        uint8_t *row = _buffer + page*width();
+        size_t begin = 0;
+        size_t end = width();
+        while (begin < end && row[begin] == value) {
+            begin++;
+        }
+        while (end > begin && row[end-1] == value) {
+            end--;
+        }
+        if (begin < end) {
+            memset(row + begin, value, end - begin);
+            _markDirty(page, begin, end - 1);
+        }
     }
 }
 
@@ -266,3 +733,8 @@ int SSD1306::_sendCommand(uint8_t command)
     uint8_t batch[] = { 0x00, command };
     return _i2c->writeBatch(_address, sizeof(batch), batch);
 }
+
+void SSD1306::_sendCommand(I2CBatch &batch, uint8_t command)
+{
+    batch.writeByte(_address, 0x00, command);
+}
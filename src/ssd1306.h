@@ -1,44 +1,50 @@
 #ifndef SSD1306_H
 #define SSD1306_H
 
+#include "font.h"
+
 #define SSD1306_I2C_ADDRESS     0x3C
 
 #define COLOR_BLACK             0x00
 #define COLOR_WHITE             0x01
 #define COLOR_INVERT            0x02
 
-#define FONT_TERMINUS_v12n      0x00
-#define FONT_TERMINUS_v14b      0x01
-#define FONT_TERMINUS_v14n      0x02
-#define FONT_TERMINUS_v14v      0x03
-#define FONT_TERMINUS_v16b      0x04
-#define FONT_TERMINUS_v16n      0x05
-#define FONT_TERMINUS_v16v      0x06
-#define FONT_TERMINUS_v18b      0x07
-#define FONT_TERMINUS_v18n      0x08
-#define FONT_TERMINUS_v20b      0x09
-#define FONT_TERMINUS_v20n      0x0A
-#define FONT_TERMINUS_v22b      0x0B
-#define FONT_TERMINUS_v22n      0x0C
-#define FONT_TERMINUS_v24b      0x0D
-#define FONT_TERMINUS_v24n      0x0E
-#define FONT_TERMINUS_v28b      0x0F
-#define FONT_TERMINUS_v28n      0x10
-#define FONT_TERMINUS_v32b      0x11
-#define FONT_TERMINUS_v32n      0x12
-
 #include <stdint.h>
+#include <stddef.h>
+#include <string>
 #include <functional>
+#include <vector>
 
 class Poller;
 class Timer;
-class I2C;
+class I2CBus;
+class I2CAsync;
+class I2CBatch;
 
 class SSD1306
 {
 public:
     SSD1306();
-    SSD1306(uint8_t address, I2C *bus, bool ext_vcc);
+    SSD1306(uint8_t address, I2CBus *bus, bool ext_vcc);
+    /** Constructor with asynchronous commit.
+     * Frame is copied and sent by bus worker page by page with low priority,
+     * so sensor reads on the same bus are not delayed by the whole frame.
+     * Object must outlive transactions submitted to the engine.
+     * @param address - device address
+     * @param bus - asynchronous i2c engine
+     * @param ext_vcc - external VCC is used
+     */
+    SSD1306(uint8_t address, I2CAsync *bus, bool ext_vcc);
+    /** Constructor with chunked commit on blocking bus.
+     * commit() only takes a snapshot of changed rectangles, event loop sends them
+     * one page per loop iteration, so timers and sensor callbacks run in between.
+     * Object must outlive the event loop iterations which send the frame.
+     * @param address - device address
+     * @param bus - i2c bus
+     * @param ext_vcc - external VCC is used
+     * @param event_poller - event loop which sends chunks
+     */
+    SSD1306(uint8_t address, I2CBus *bus, bool ext_vcc, Poller *event_poller);
     SSD1306(const SSD1306& that) = delete; /**< Copy contructor is not allowed. */
     ~SSD1306();
 
@@ -52,24 +58,123 @@ public:
     size_t width();
     size_t height();
 
+    /** Send changed part of buffer to display.
+     * Buffer is compared with the last frame sent to display, only rectangles which
+     * cover changed bytes are sent, so redrawing the whole screen costs only the difference.
+     * Nothing is sent if buffer was not changed since last commit.
+     * In asynchronous and chunked modes it returns immediately, if previous frame is still
+     * being sent only the latest buffer will be sent after it.
+     * @return 0 on success or negative value on error
+     */
     int commit();
 
+    /** Mark whole buffer as changed, next commit() sends full frame.
+     * Use it when display memory could differ from buffer, e.g. after display reset.
+     */
+    void invalidate();
+
     void clear();
     void fill();
 
     void drawPixel(uint8_t x, uint8_t y, uint8_t color=COLOR_WHITE);
+
+    /** Draw line between two points, both ends included.
+     * Parts outside of canvas are clipped.
+     */
     void drawLine(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t color=COLOR_WHITE);
-    void drawText(uint8_t x, uint8_t y, std::string text, uint8_t color=COLOR_WHITE, uint8_t font=FONT_TERMINUS_v12n);
-    void drawText(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, std::string text,
+
+    /** Draw horizontal line from (x, y) to the right.
+     * @param width - length in pixels
+     */
+    void drawHorizontalLine(uint8_t x, uint8_t y, uint8_t width, uint8_t color=COLOR_WHITE);
+
+    /** Draw vertical line from (x, y) down.
+     * @param height - length in pixels
+     */
+    void drawVerticalLine(uint8_t x, uint8_t y, uint8_t height, uint8_t color=COLOR_WHITE);
+
+    /** Draw rectangle outline, every pixel is drawn once so COLOR_INVERT keeps corners.
+     * @param x - left column
+     * @param y - top row
+     * @param width - width in pixels
+     * @param height - height in pixels
+     */
+    void drawRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t color=COLOR_WHITE);
+
+    /** Draw filled rectangle, whole display bytes are written at once.
+     * @param x - left column
+     * @param y - top row
+     * @param width - width in pixels
+     * @param height - height in pixels
+     */
+    void fillRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t color=COLOR_WHITE);
+
+    /** Draw 1 bit per pixel bitmap, only set bits are drawn with color.
+     * Bitmap uses display memory layout: (height + 7) / 8 rows of width bytes,
+     * bit 0 of a byte is the top pixel. Parts outside of canvas are clipped.
+     * @param x - left column, could be negative
+     * @param y - top row, could be negative
+     * @param bitmap - bitmap data
+     * @param width - width in pixels
+     * @param height - height in pixels
+     */
+    void drawBitmap(int x, int y, const uint8_t bitmap[], uint8_t width, uint8_t height, uint8_t color=COLOR_WHITE);
+
+    void drawText(uint8_t x, uint8_t y, const std::string &text, uint8_t color=COLOR_WHITE, uint8_t font=FONT_TERMINUS_v12n);
+    void drawText(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, const std::string &text,
                   uint8_t color=COLOR_WHITE, uint8_t font=FONT_TERMINUS_v12n);
 
+    /** Width of text drawn without wrapping.
+     * @param text - text, the longest line is measured
+     * @param font - FONT_TERMINUS_* id
+     * @return width in pixels
+     */
+    size_t textWidth(const std::string &text, uint8_t font=FONT_TERMINUS_v12n);
+
 private:
-    I2C *_i2c;
+    /** Changed columns of one page, inclusive, page is clean when begin > end. */
+    struct Span {
+        uint8_t begin;
+        uint8_t end;
+    };
+
+    /** Display memory window, inclusive. */
+    struct Rect {
+        uint8_t column_begin;
+        uint8_t column_end;
+        uint8_t page_begin;
+        uint8_t page_end;
+    };
+
+    I2CBus *_i2c;
+    I2CAsync *_async;
     uint8_t _address;
     bool _ext_vcc;
     uint8_t *_buffer;
+    uint8_t *_sent;         /**< frame in display memory */
+    bool _sent_valid;
+    bool _commit_running;
+    bool _commit_queued;
+    size_t _commit_pending;
+    Span _dirty[8];         /**< columns which could differ from sent frame */
+    Timer *_chunk_timer;
+    std::vector<Rect> _chunks;
+    size_t _chunk;
+    uint8_t _chunk_page;
 
     int _sendCommand(uint8_t command);
+    void _sendCommand(I2CBatch &batch, uint8_t command);
+    int _commitAsync();
+    int _commitChunked();
+    void _commitChunk();
+    void _commitDone();
+    void _markDirty(uint8_t page, uint8_t begin, uint8_t end);
+    size_t _changedSpans(uint8_t page, Span spans[]);
+    size_t _takeChanges(Rect rects[]);
+    void _fillPages(uint8_t value);
+    void _blit(int x, int y, const uint8_t bitmap[], int bitmap_width, int bitmap_height, uint8_t color);
+    void _fillRect(int x, int y, int rect_width, int rect_height, uint8_t color);
+    void _plot(int x, int y, uint8_t color);
 };
 
 #endif // SSD1306_H
@@ -0,0 +1,372 @@
+#include "startup.h"
+#include "poller.h"
+#include "timer.h"
+#include "log.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+Startup::Startup(Poller *event_poller, size_t threads):
+    _event_poller(event_poller), _threads(threads > 0 ? threads : 1),
+    _start(0), _remaining(0), _running(0), _failed(false),
+    _retry(new Timer(event_poller)), _conclude_deferred(false), _stopping(false)
+{
+    _retry->onTimeout = [this]() { _runDeferred(); };
+}
+
+Startup::~Startup()
+{
+    _stopPool();
+    delete _retry; _retry = nullptr;
+}
+
+int Startup::addStep(const std::string &name, AsyncStep step, const std::vector<std::string> &depends)
+{
+    return _add(name, step, nullptr, depends);
+}
+
+int Startup::addBlockingStep(const std::string &name, BlockingStep step, const std::vector<std::string> &depends)
+{
+    return _add(name, nullptr, step, depends);
+}
+
+int Startup::_add(const std::string &name, AsyncStep async, BlockingStep blocking, const std::vector<std::string> &depends)
+{
+    if (_done) {
+        Error() << "Unable to add step" << name.c_str() << "while startup is running";
+        return -1;
+    }
+    for (const Entry &entry: _timeline) {
+        if (entry.name == name) {
+            Error() << "Duplicate startup step" << name.c_str();
+            return -1;
+        }
+    }
+
+    Step step;
+    step.async = async;
+    step.blocking = blocking;
+    step.depends = depends;
+    step.state = StepPending;
+    step.completed = false;
+    _steps.push_back(step);
+
+    Entry entry;
+    entry.name = name;
+    entry.ready = entry.begin = entry.end = 0;
+    entry.result = 0;
+    entry.blocking = blocking != nullptr;
+    entry.finished = false;
+    _timeline.push_back(entry);
+    return 0;
+}
+
+int Startup::start(Completion done)
+{
+    if (_done) {
+        Error() << "Startup is already running";
+        return -1;
+    }
+    if (_resolve() < 0) {
+        return -1;
+    }
+
+    _done = done;
+    _start = monotonicNsec();
+    _remaining = _steps.size();
+    _running = 0;
+    _failed = false;
+    _schedule();
+    if (_running == 0) {
+        // nothing to wait for: no steps or every ready step failed to start
+        if (_event_poller->post([this]() { _conclude(); }) < 0) {
+            _conclude_deferred = true;
+            if (_retry->start(timespec{0, 1}, timespec{0, 0}) < 0) {
+                Error() << "Unable to defer startup conclusion";
+            }
+        }
+    }
+    return 0;
+}
+
+size_t Startup::size() const
+{
+    return _steps.size();
+}
+
+const std::vector<Startup::Entry>& Startup::timeline() const
+{
+    return _timeline;
+}
+
+void Startup::printTimeline() const
+{
+    uint64_t total = 0;
+    for (const Entry &entry: _timeline) {
+        if (!entry.finished) {
+            Info() << "startup:" << entry.name.c_str() << "not finished";
+            continue;
+        }
+        Info() << "startup:" << entry.name.c_str() << (entry.blocking ? "blocking" : "async")
+               << "ready ms:" << entry.ready / 1e6f << "begin:" << entry.begin / 1e6f
+               << "end:" << entry.end / 1e6f << "result:" << entry.result;
+        if (entry.end > total) {
+            total = entry.end;
+        }
+    }
+    Info() << "startup: total ms:" << total / 1e6f;
+}
+
+void Startup::setTrace(const std::string &path)
+{
+    _trace = path;
+}
+
+int Startup::_resolve()
+{
+    for (Step &step: _steps) {
+        step.dependencies.clear();
+        step.state = StepPending;
+        step.completed = false;
+        for (const std::string &name: step.depends) {
+            size_t index = 0;
+            while (index < _timeline.size() && _timeline[index].name != name) {
+                index++;
+            }
+            if (index == _timeline.size()) {
+                Error() << "Unknown startup dependency" << name.c_str();
+                return -1;
+            }
+            step.dependencies.push_back(index);
+        }
+    }
+
+    // Kahn's algorithm, steps left unsorted are part of a cycle
+    std::vector<size_t> waiting(_steps.size());
+    for (size_t i=0; i<_steps.size(); i++) {
+        waiting[i] = _steps[i].dependencies.size();
+    }
+    size_t sorted = 0;
+    bool progress = true;
+    std::vector<bool> done(_steps.size(), false);
+    while (progress) {
+        progress = false;
+        for (size_t i=0; i<_steps.size(); i++) {
+            if (done[i] || waiting[i] > 0) {
+                continue;
+            }
+            done[i] = true;
+            sorted++;
+            progress = true;
+            for (size_t j=0; j<_steps.size(); j++) {
+                for (size_t dependency: _steps[j].dependencies) {
+                    if (dependency == i) {
+                        waiting[j]--;
+                    }
+                }
+            }
+        }
+    }
+    if (sorted != _steps.size()) {
+        for (size_t i=0; i<_steps.size(); i++) {
+            if (!done[i]) {
+                Error() << "Startup step" << _timeline[i].name.c_str() << "is part of dependency cycle";
+            }
+        }
+        return -1;
+    }
+    return 0;
+}
+
+void Startup::_schedule()
+{
+    if (_failed) {
+        return;
+    }
+    for (size_t i=0; i<_steps.size(); i++) {
+        Step &step = _steps[i];
+        if (step.state != StepPending) {
+            continue;
+        }
+        bool ready = true;
+        for (size_t dependency: step.dependencies) {
+            ready = ready && _steps[dependency].state == StepDone;
+        }
+        if (ready) {
+            _run(i);
+            if (_failed) {
+                return;
+            }
+        }
+    }
+}
+
+void Startup::_run(size_t index)
+{
+    Step &step = _steps[index];
+    Entry &entry = _timeline[index];
+    step.state = StepRunning;
+    entry.ready = _elapsed();
+    _running++;
+
+    if (step.blocking) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back([this, index]() {
+                _timeline[index].begin = _elapsed();
+                _complete(index, _steps[index].blocking(), false);
+            });
+        }
+        while (_pool.size() < _threads) {
+            _pool.push_back(std::thread(&Startup::_worker, this));
+        }
+        _wakeup.notify_one();
+        return;
+    }
+
+    entry.begin = _elapsed();
+    if (step.async([this, index](int result) { _complete(index, result, true); }) < 0) {
+        Error() << "Unable to start step" << entry.name.c_str();
+        entry.end = _elapsed();
+        entry.result = -1;
+        entry.finished = true;
+        step.state = StepDone;
+        _running--;
+        _remaining--;
+        _failed = true;
+    }
+}
+
+void Startup::_complete(size_t index, int result, bool from_loop)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_steps[index].completed) {
+            Warn() << "Startup step" << _timeline[index].name.c_str() << "completed twice, ignored";
+            return;
+        }
+        _steps[index].completed = true;
+    }
+
+    // steps could complete from thread pool or from inside _run(), continue from event loop
+    _timeline[index].end = _elapsed();
+    while (_event_poller->post([this, index, result]() { _finish(index, result); }) < 0) {
+        if (from_loop) {
+            // queue is drained only after this callback returns, finish on next loop iteration
+            _deferred.push_back(std::make_pair(index, result));
+            if (_retry->start(timespec{0, 1}, timespec{0, 0}) < 0) {
+                Error() << "Unable to defer completion of startup step" << _timeline[index].name.c_str();
+            }
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void Startup::_runDeferred()
+{
+    std::vector<std::pair<size_t, int>> deferred;
+    deferred.swap(_deferred);
+    for (const std::pair<size_t, int> &completion: deferred) {
+        _finish(completion.first, completion.second);
+    }
+    if (_conclude_deferred) {
+        _conclude_deferred = false;
+        _conclude();
+    }
+}
+
+void Startup::_finish(size_t index, int result)
+{
+    // step which failed to start is already accounted
+    if (_steps[index].state == StepDone) {
+        return;
+    }
+    Entry &entry = _timeline[index];
+    entry.result = result;
+    entry.finished = true;
+    _steps[index].state = StepDone;
+    _running--;
+    _remaining--;
+    if (result < 0) {
+        Error() << "Startup step" << entry.name.c_str() << "failed";
+        _failed = true;
+    }
+    _schedule();
+    if (_running == 0 && (_remaining == 0 || _failed)) {
+        _conclude();
+    }
+}
+
+void Startup::_conclude()
+{
+    _stopPool();
+    if (!_trace.empty()) {
+        _writeTrace();
+    }
+    Completion done = std::move(_done);
+    _done = nullptr;
+    if (done) done(_failed || _remaining > 0 ? -1 : 0);
+}
+
+void Startup::_worker()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wakeup.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+        if (_queue.empty()) {
+            return;
+        }
+        std::function<void()> task = std::move(_queue.front());
+        _queue.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+void Startup::_stopPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+    for (std::thread &thread: _pool) {
+        thread.join();
+    }
+    _pool.clear();
+    _stopping = false;
+}
+
+int Startup::_writeTrace() const
+{
+    FILE *file = fopen(_trace.c_str(), "w");
+    if (file == nullptr) {
+        Error() << "Unable to write startup trace" << _trace.c_str() << strerror(errno);
+        return -1;
+    }
+    fprintf(file, "{\"traceEvents\": [\n");
+    for (size_t i=0; i<_timeline.size(); i++) {
+        const Entry &entry = _timeline[i];
+        fprintf(file, "  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %zu,"
+                " \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"ready\": %.3f, \"result\": %d}}%s\n",
+                entry.name.c_str(), entry.blocking ? "blocking" : "async", i,
+                entry.begin / 1e3, (entry.end - entry.begin) / 1e3, entry.ready / 1e3, entry.result,
+                i + 1 < _timeline.size() ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    if (fclose(file) != 0) {
+        Error() << "Unable to write startup trace" << _trace.c_str() << strerror(errno);
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t Startup::_elapsed() const
+{
+    return monotonicNsec() - _start;
+}
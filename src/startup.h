@@ -0,0 +1,145 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class Poller;
+class Timer;
+
+/** Startup orchestrator.
+ * Components declare named init steps with dependencies, e.g. bus before device and device before start.
+ * Steps whose dependencies are finished run concurrently: asynchronous steps in event loop thread
+ * (driver initializeAsync()), blocking steps on a small thread pool.
+ * Every step is timed, timeline could be logged or written as a trace file.
+ *
+ * Blocking steps run in parallel with event loop and with each other,
+ * they must not touch objects used by steps which could run at the same time.
+ */
+class Startup
+{
+public:
+    /** Step completion, 0 on success or negative value on error. */
+    typedef std::function<void(int)> Completion;
+    /** Step which reports completion later from event loop, returns negative value if it was not started. */
+    typedef std::function<int(Completion)> AsyncStep;
+    /** Step which blocks until done, runs on thread pool. */
+    typedef std::function<int(void)> BlockingStep;
+
+    /** Step timing, nanoseconds since start(). */
+    struct Entry {
+        std::string name;
+        uint64_t ready;     /**< dependencies finished */
+        uint64_t begin;
+        uint64_t end;
+        int result;
+        bool blocking;
+        bool finished;
+    };
+
+    /** Constructor.
+     * @param event_poller - event loop which runs asynchronous steps and completions
+     * @param threads - thread pool size for blocking steps
+     */
+    Startup(Poller *event_poller, size_t threads=2);
+    Startup(const Startup& that) = delete;  /**< Copy contructor not allowed because of thread pool. */
+    ~Startup();
+
+    /** Add asynchronous step.
+     * @param name - unique step name
+     * @param step - step function, completion could be called before it returns
+     * @param depends - names of steps which should finish first
+     * @return 0 on success or negative value on error
+     */
+    int addStep(const std::string &name, AsyncStep step, const std::vector<std::string> &depends={});
+
+    /** Add blocking step, it is executed on thread pool.
+     * @param name - unique step name
+     * @param step - step function, returns 0 on success or negative value on error
+     * @param depends - names of steps which should finish first
+     * @return 0 on success or negative value on error
+     */
+    int addBlockingStep(const std::string &name, BlockingStep step, const std::vector<std::string> &depends={});
+
+    /** Run steps, must be called from event loop thread or before loop is started.
+     * Remaining steps are not started after first failure, done is called once running ones finish.
+     * @param done - called from event loop with 0 when all steps succeeded or negative value on error
+     * @return 0 on success or negative value on error (unknown dependency, cycle, already running)
+     */
+    int start(Completion done);
+
+    /** Amount of added steps. */
+    size_t size() const;
+
+    /** Step timings in order of addition. */
+    const std::vector<Entry>& timeline() const;
+
+    /** Write timeline with Info() log. */
+    void printTimeline() const;
+
+    /** Write timeline in Chrome trace event format when startup finishes, see chrome://tracing.
+     * @param path - file path, empty string disables trace
+     */
+    void setTrace(const std::string &path);
+
+private:
+    enum StepState {
+        StepPending,
+        StepRunning,
+        StepDone
+    };
+
+    struct Step {
+        AsyncStep async;
+        BlockingStep blocking;
+        std::vector<std::string> depends;
+        std::vector<size_t> dependencies;
+        StepState state;
+        bool completed;     /**< completion was reported, guarded by _mutex */
+    };
+
+    Poller *_event_poller;
+    size_t _threads;
+    std::vector<Step> _steps;
+    std::vector<Entry> _timeline;
+    Completion _done;
+    std::string _trace;
+    uint64_t _start;
+    size_t _remaining;
+    size_t _running;
+    bool _failed;
+
+    /** Fallback when event loop task queue is full, completions continue on next loop iteration. */
+    Timer *_retry;
+    std::vector<std::pair<size_t, int>> _deferred;
+    bool _conclude_deferred;
+
+    std::vector<std::thread> _pool;
+    std::deque<std::function<void()>> _queue;
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    bool _stopping;
+
+    int _add(const std::string &name, AsyncStep async, BlockingStep blocking, const std::vector<std::string> &depends);
+    int _resolve();
+    void _schedule();
+    void _run(size_t index);
+    void _complete(size_t index, int result, bool from_loop);
+    void _runDeferred();
+    void _finish(size_t index, int result);
+    void _conclude();
+    void _worker();
+    void _stopPool();
+    int _writeTrace() const;
+    uint64_t _elapsed() const;
+};
+
+#endif // STARTUP_H
@@ -1,5 +1,7 @@
 #include "timer.h"
+#include "timerwheel.h"
 #include "log.h"
+#include "utils.h"
 
 #include <sys/timerfd.h>
 #include <unistd.h>
@@ -8,6 +10,19 @@
 #include <errno.h>
 #include <cmath>
 
+static inline uint64_t _timespecToNsec(const timespec &ts)
+{
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline timespec _nsecToTimespec(uint64_t nsec)
+{
+    timespec ts;
+    ts.tv_sec = nsec / 1000000000ull;
+    ts.tv_nsec = nsec % 1000000000ull;
+    return ts;
+}
+
 Timer::Timer():
     Timer(Poller::getDefault())
 {
@@ -15,17 +30,34 @@ Timer::Timer():
 }
 
 Timer::Timer(Poller *event_poller):
-    Descriptor(event_poller), _state(Idle)
+    Descriptor(event_poller), _state(Idle), _overrun_policy(OverrunReplay),
+    _expires(0), _interval(0), _last_wakeup(0), _lateness(), _jitter(), _overruns(0),
+    _wheel(event_poller->timerWheel()), _wheel_prev(nullptr), _wheel_next(nullptr),
+    _wheel_level(-1), _wheel_slot(0)
+{
+    if (_wheel == nullptr) {
+        _descriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        assert(_descriptor);
+        _registerRead();
+    }
+}
+
+Timer::Timer(TimerWheel *wheel):
+    Descriptor(wheel->_ep), _state(Idle), _overrun_policy(OverrunReplay),
+    _expires(0), _interval(0), _last_wakeup(0), _lateness(), _jitter(), _overruns(0),
+    _wheel(wheel), _wheel_prev(nullptr), _wheel_next(nullptr),
+    _wheel_level(-1), _wheel_slot(0)
 {
-    _descriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-    assert(_descriptor);
-    _registerRead();
 }
 
 Timer::~Timer()
 {
-    _unregisterRead();
-    close(_descriptor);
+    if (_wheel != nullptr) {
+        _wheel->_stop(this);
+    } else {
+        _unregisterRead();
+        close(_descriptor);
+    }
 }
 
 const char* Timer::name()
@@ -75,40 +107,109 @@ int Timer::start(timespec interval)
 
 int Timer::start(timespec timeout, timespec interval)
 {
+    uint64_t timeout_ns = _timespecToNsec(timeout);
+    if (timeout_ns == 0) {
+        // zero timeout disarms timerfd
+        return stop();
+    }
+
+    return _arm(monotonicNsec() + timeout_ns, _timespecToNsec(interval));
+}
+
+int Timer::startAligned(timespec interval, timespec phase)
+{
+    uint64_t interval_ns = _timespecToNsec(interval);
+    if (interval_ns == 0) {
+        Error() << "Aligned timer requires non zero interval";
+        return -1;
+    }
+
+    uint64_t origin = epoch() + _timespecToNsec(phase);
+    uint64_t now = monotonicNsec();
+    uint64_t expires = origin;
+    if (now >= origin) {
+        expires += ((now - origin) / interval_ns + 1) * interval_ns;
+    }
+
+    return _arm(expires, interval_ns);
+}
+
+int Timer::stop()
+{
+    if (_wheel != nullptr) {
+        _wheel->_stop(this);
+        _state = Idle;
+        return 0;
+    }
+
     itimerspec spec;
-    spec.it_interval = interval;
-    spec.it_value = timeout;
+    memset(&spec, 0, sizeof(spec));
 
     if (timerfd_settime(_descriptor, 0, &spec, nullptr) != 0) {
         Error() << "Error setting timer parameters. errno" << errno << strerror(errno);
         return -1;
     }
 
-    _state = Running;
-
+    _state = Idle;
     return 0;
 }
 
-int Timer::stop()
+void Timer::setOverrunPolicy(OverrunPolicy policy)
 {
-    timespec timeout_spec;
-    timeout_spec.tv_sec = 0;
-    timeout_spec.tv_nsec = 0;
+    _overrun_policy = policy;
+}
 
-    timespec interval_spec;
-    interval_spec.tv_sec = 0;
-    interval_spec.tv_nsec = 0;
+const Histogram& Timer::lateness() const
+{
+    return _lateness;
+}
+
+const Histogram& Timer::jitter() const
+{
+    return _jitter;
+}
+
+uint64_t Timer::overruns() const
+{
+    return _overruns.load(std::memory_order_relaxed);
+}
+
+void Timer::resetStatistics()
+{
+    _lateness.reset();
+    _jitter.reset();
+    _overruns.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Timer::epoch()
+{
+    static const uint64_t epoch = monotonicNsec();
+    return epoch;
+}
+
+int Timer::_arm(uint64_t expires, uint64_t interval)
+{
+    _expires = expires;
+    _interval = interval;
+    _last_wakeup = 0;
+
+    if (_wheel != nullptr) {
+        _wheel->_start(this);
+        _state = Running;
+        return 0;
+    }
 
     itimerspec spec;
-    spec.it_interval = interval_spec;
-    spec.it_value = timeout_spec;
+    spec.it_value = _nsecToTimespec(expires);
+    spec.it_interval = _nsecToTimespec(interval);
 
-    if (timerfd_settime(_descriptor, 0, &spec, nullptr) != 0) {
+    if (timerfd_settime(_descriptor, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
         Error() << "Error setting timer parameters. errno" << errno << strerror(errno);
         return -1;
     }
 
-    _state = Idle;
+    _state = Running;
+
     return 0;
 }
 
@@ -116,16 +217,47 @@ void Timer::_onRead()
 {
     uint64_t expiration_count = 0;
     if (read(_descriptor, &expiration_count, sizeof(uint64_t)) == sizeof(uint64_t)) {
-        if (expiration_count > 1) {
-            Warn() << this << expiration_count << "timeout events was coalesced. Check CPU usage and application logic.";
+        uint64_t deadline = _expires + (expiration_count - 1) * _interval;
+        _expires = deadline + _interval;
+        _onExpired(expiration_count, monotonicNsec(), deadline);
+    } else {
+        Error() << "Incomplete timer data";
+    }
+}
+
+void Timer::_onExpired(uint64_t expiration_count, uint64_t now, uint64_t deadline)
+{
+    _lateness.add(now > deadline ? now - deadline : 0);
+    if (_interval > 0) {
+        if (_last_wakeup != 0) {
+            int64_t deviation = (int64_t)(now - _last_wakeup) - (int64_t)(_interval * expiration_count);
+            _jitter.add(deviation < 0 ? -deviation : deviation);
         }
+        _last_wakeup = now;
+    }
+
+    if (expiration_count > 1) {
+        _overruns.fetch_add(expiration_count - 1, std::memory_order_relaxed);
 
-        while (expiration_count > 0 && _state == Running) {
-            expiration_count--;
-            onTimeout();
+        switch (_overrun_policy) {
+        case OverrunReplay:
+            WarnLimited(1) << this << expiration_count << "timeout events was coalesced. Check CPU usage and application logic.";
+            break;
+        case OverrunSkip:
+            expiration_count = 1;
+            break;
+        case OverrunNotify:
+            if (onOverrun) {
+                onOverrun(expiration_count - 1);
+            }
+            expiration_count = 1;
+            break;
         }
-    } else {
-        Error() << "Incomplete timer data";
+    }
+
+    while (expiration_count > 0 && _state == Running) {
+        expiration_count--;
+        onTimeout();
     }
 }
 
@@ -3,27 +3,49 @@
 
 #include "poller.h"
 #include "descriptor.h"
+#include "histogram.h"
 #include <time.h>
 #include <stdint.h>
 #include <functional>
 
+class TimerWheel;
+
 /** Linux timerfd wrapper.
  *  Class provides event driven timers.
+ *  If event poller has a TimerWheel attached, timer is multiplexed onto the wheel timerfd
+ *  instead of owning one, API and callback semantics stay the same.
+ *
+ *  Deadlines are absolute (TFD_TIMER_ABSTIME), periodic timers never drift and
+ *  startAligned() timers of all loops stay in phase with the shared epoch().
+ *  Every timer keeps lateness and jitter histograms which could be read from any thread.
  */
 class Timer: public Descriptor
 {
+    friend class TimerWheel;
+
     enum State {
         Idle,
         Running
     };
 
 public:
+    /** What to do when several periods elapsed before callback could run. */
+    enum OverrunPolicy {
+        OverrunReplay,  /**< call onTimeout for every missed period (default) */
+        OverrunSkip,    /**< call onTimeout once, missed periods are dropped */
+        OverrunNotify   /**< call onOverrun with missed periods count, then onTimeout once */
+    };
+
     /** Timer constructor with default eventloop. */
     Timer();
     /** Timer constructor.
      * @param event_poller - EventPoller instance which will be used to process events.
      */
     Timer(Poller *event_poller);
+    /** Timer constructor.
+     * @param wheel - TimerWheel instance which will be used as timer backend.
+     */
+    Timer(TimerWheel *wheel);
     Timer(const Timer& that) = delete;  /**< Copy contructor not allowed because of internal state and file descriptor. */
     virtual ~Timer();
 
@@ -32,6 +54,9 @@ public:
     /** User set callback. Will be called on timer timeout. */
     std::function<void(void)> onTimeout;
 
+    /** User set callback. Will be called with amount of missed periods if OverrunNotify policy is set. */
+    std::function<void(uint64_t)> onOverrun;
+
     /** Start one shot timer.
      * @param timeout - interval in msec.
      * @return 0 on success or negative value on error
@@ -66,18 +91,67 @@ public:
      */
     int start(timespec timeout, timespec interval);
 
+    /** Start periodic timer phase locked to shared epoch.
+     * Timer fires at epoch() + phase + N * interval, so timers with commensurable intervals
+     * stay aligned to each other even if they live in different event loops.
+     * @param interval - interval timespec.
+     * @param phase - offset from epoch timespec.
+     * @return 0 on success or negative value on error
+     */
+    int startAligned(timespec interval, timespec phase);
+
     /**
      * stop timer
      * @return 0 on success or negative value on error
      */
     int stop();
 
+    /** Set overrun policy.
+     * @param policy - see OverrunPolicy.
+     */
+    void setOverrunPolicy(OverrunPolicy policy);
+
+    /** Callback lateness histogram: time from deadline to callback start. */
+    const Histogram& lateness() const;
+
+    /** Period jitter histogram: deviation of time between callbacks from interval. */
+    const Histogram& jitter() const;
+
+    /** Amount of missed periods since timer creation. */
+    uint64_t overruns() const;
+
+    /** Reset lateness, jitter and overrun statistics. */
+    void resetStatistics();
+
+    /** Shared epoch for aligned timers.
+     * @return CLOCK_MONOTONIC nsec captured on first call.
+     */
+    static uint64_t epoch();
+
 protected:
     virtual void _onRead();
     virtual void _onWrite();
 
 private:
     State _state;
+    OverrunPolicy _overrun_policy;
+
+    uint64_t _expires;      /**< next deadline, monotonic nsec */
+    uint64_t _interval;     /**< interval, nsec */
+    uint64_t _last_wakeup;  /**< previous callback time, monotonic nsec */
+
+    Histogram _lateness;
+    Histogram _jitter;
+    std::atomic<uint64_t> _overruns;
+
+    TimerWheel *_wheel;
+    Timer *_wheel_prev;
+    Timer *_wheel_next;
+    int8_t _wheel_level;
+    uint8_t _wheel_slot;
+
+    int _arm(uint64_t expires, uint64_t interval);
+    void _onExpired(uint64_t expiration_count, uint64_t now, uint64_t deadline);
 };
 
 #endif
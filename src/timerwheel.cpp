@@ -0,0 +1,281 @@
+#include "timerwheel.h"
+#include "timer.h"
+#include "poller.h"
+#include "log.h"
+#include "utils.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <cassert>
+
+static inline uint64_t _rotateRight(uint64_t value, unsigned shift)
+{
+    shift &= 63;
+    return shift ? (value >> shift) | (value << (64 - shift)) : value;
+}
+
+TimerWheel::TimerWheel():
+    TimerWheel(Poller::getDefault())
+{
+
+}
+
+TimerWheel::TimerWheel(Poller *event_poller):
+    Descriptor(event_poller), _pending(nullptr),
+    _current(0), _armed(0), _processing(false),
+    _wakeups(0), _expirations(0), _rearms(0)
+{
+    memset(_slots, 0, sizeof(_slots));
+    memset(_occupied, 0, sizeof(_occupied));
+    _current = monotonicNsec() >> _tick_shift;
+
+    _descriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    assert(_descriptor >= 0);
+    _registerRead();
+}
+
+TimerWheel::~TimerWheel()
+{
+    for (int level=0; level<_levels; level++) {
+        if (_occupied[level]) {
+            Error() << "Timer wheel destroyed with active timers on level" << level;
+        }
+    }
+    _unregisterRead();
+    close(_descriptor);
+}
+
+const char* TimerWheel::name()
+{
+    return "TimerWheel";
+}
+
+void TimerWheel::getStatistics(uint64_t &wakeups, uint64_t &expirations, uint64_t &rearms)
+{
+    wakeups = _wakeups;
+    expirations = _expirations;
+    rearms = _rearms;
+}
+
+int TimerWheel::_start(Timer *timer)
+{
+    _unlink(timer);
+    _insert(timer);
+    if (!_processing) {
+        _rearm();
+    }
+    return 0;
+}
+
+int TimerWheel::_stop(Timer *timer)
+{
+    // timerfd is left armed, at worst it will cause one spurious wakeup
+    _unlink(timer);
+    return 0;
+}
+
+void TimerWheel::_insert(Timer *timer)
+{
+    uint64_t tick = (timer->_expires + (1ull << _tick_shift) - 1) >> _tick_shift;
+    if (tick <= _current) {
+        tick = _current + 1;
+    }
+
+    uint64_t delta = tick - _current;
+    int level = 0;
+    while (level < _levels && (delta >> (_level_bits * (level + 1))) != 0) {
+        level++;
+    }
+
+    uint64_t slot_tick;
+    if (level == _levels) {
+        // beyond wheel range: park in the farthest slot, will be cascaded again
+        level = _levels - 1;
+        slot_tick = (_current >> (_level_bits * level)) + _slots_count;
+    } else {
+        slot_tick = tick >> (_level_bits * level);
+    }
+
+    _link(timer, level, slot_tick & (_slots_count - 1));
+}
+
+void TimerWheel::_link(Timer *timer, int level, int slot)
+{
+    Timer **head = level == _pending_level ? &_pending : &_slots[level][slot];
+    timer->_wheel_prev = nullptr;
+    timer->_wheel_next = *head;
+    if (*head != nullptr) {
+        (*head)->_wheel_prev = timer;
+    }
+    *head = timer;
+    timer->_wheel_level = level;
+    timer->_wheel_slot = slot;
+    if (level != _pending_level) {
+        _occupied[level] |= 1ull << slot;
+    }
+}
+
+void TimerWheel::_unlink(Timer *timer)
+{
+    int level = timer->_wheel_level;
+    if (level < 0) {
+        return;
+    }
+
+    int slot = timer->_wheel_slot;
+    Timer **head = level == _pending_level ? &_pending : &_slots[level][slot];
+    if (timer->_wheel_prev != nullptr) {
+        timer->_wheel_prev->_wheel_next = timer->_wheel_next;
+    } else {
+        *head = timer->_wheel_next;
+    }
+    if (timer->_wheel_next != nullptr) {
+        timer->_wheel_next->_wheel_prev = timer->_wheel_prev;
+    }
+    if (level != _pending_level && *head == nullptr) {
+        _occupied[level] &= ~(1ull << slot);
+    }
+
+    timer->_wheel_prev = timer->_wheel_next = nullptr;
+    timer->_wheel_level = -1;
+}
+
+uint64_t TimerWheel::_nextTick()
+{
+    // Slot of level L holds timers which must be cascaded (or fired for level 0)
+    // at one of 64 slot ticks after current one, so first occupied slot after current gives the nearest event.
+    uint64_t next = UINT64_MAX;
+    for (int level=0; level<_levels; level++) {
+        if (_occupied[level] == 0) {
+            continue;
+        }
+        int shift = _level_bits * level;
+        uint64_t base = (_current >> shift) + 1;
+        uint64_t tick = (base + __builtin_ctzll(_rotateRight(_occupied[level], base))) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+void TimerWheel::_advance(uint64_t now)
+{
+    uint64_t now_tick = now >> _tick_shift;
+
+    for (;;) {
+        uint64_t next = _nextTick();
+        if (next > now_tick) {
+            break;
+        }
+
+        // collect slots due at this tick, cascaded timers are re-inserted after current tick update
+        Timer *cascade = nullptr;
+        for (int level=_levels-1; level>=0; level--) {
+            int shift = _level_bits * level;
+            if (next & ((1ull << shift) - 1)) {
+                continue;
+            }
+            int slot = (next >> shift) & (_slots_count - 1);
+            if (!(_occupied[level] & (1ull << slot))) {
+                continue;
+            }
+            uint64_t base = (_current >> shift) + 1;
+            if (((base + ((slot - base) & (_slots_count - 1))) << shift) != next) {
+                continue;
+            }
+            while (_slots[level][slot] != nullptr) {
+                Timer *timer = _slots[level][slot];
+                _unlink(timer);
+                if (level == 0) {
+                    _link(timer, _pending_level, 0);
+                } else {
+                    timer->_wheel_next = cascade;
+                    cascade = timer;
+                }
+            }
+        }
+
+        _current = next;
+        while (cascade != nullptr) {
+            Timer *timer = cascade;
+            cascade = timer->_wheel_next;
+            uint64_t tick = (timer->_expires + (1ull << _tick_shift) - 1) >> _tick_shift;
+            if (tick <= _current) {
+                _link(timer, _pending_level, 0);
+            } else {
+                _insert(timer);
+            }
+        }
+
+        // callbacks may start, stop or delete any timer, so pending list head is re-read every time
+        while (_pending != nullptr) {
+            Timer *timer = _pending;
+            _unlink(timer);
+            _expirations++;
+
+            uint64_t count = 1;
+            uint64_t deadline = timer->_expires;
+            if (timer->_interval > 0) {
+                if (now > timer->_expires) {
+                    count += (now - timer->_expires) / timer->_interval;
+                }
+                deadline += (count - 1) * timer->_interval;
+                timer->_expires = deadline + timer->_interval;
+                _insert(timer);
+            }
+            timer->_onExpired(count, now, deadline);
+        }
+    }
+
+    if (now_tick > _current) {
+        _current = now_tick;
+    }
+}
+
+void TimerWheel::_rearm()
+{
+    uint64_t next = _nextTick();
+    if (next == _armed || (next == UINT64_MAX && _armed == 0)) {
+        return;
+    }
+
+    itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (next != UINT64_MAX) {
+        uint64_t deadline = next << _tick_shift;
+        spec.it_value.tv_sec = deadline / 1000000000ull;
+        spec.it_value.tv_nsec = deadline % 1000000000ull;
+    }
+
+    _rearms++;
+    if (timerfd_settime(_descriptor, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        Error() << "Error setting timer parameters. errno" << errno << strerror(errno);
+        _armed = 0;
+        return;
+    }
+    _armed = next == UINT64_MAX ? 0 : next;
+}
+
+void TimerWheel::_onRead()
+{
+    uint64_t expiration_count = 0;
+    if (read(_descriptor, &expiration_count, sizeof(uint64_t)) != sizeof(uint64_t)) {
+        if (errno != EAGAIN) {
+            Error() << "Incomplete timer data";
+        }
+    }
+
+    _wakeups++;
+    _armed = 0;
+    _processing = true;
+    _advance(monotonicNsec());
+    _processing = false;
+    _rearm();
+}
+
+void TimerWheel::_onWrite()
+{
+}
@@ -0,0 +1,75 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "descriptor.h"
+#include <stdint.h>
+
+class Timer;
+
+/** Hierarchical timer wheel multiplexed onto one timerfd.
+ *  Many logical timers share one kernel timer. The timerfd is always armed to the nearest
+ *  wheel event, so one wakeup costs one epoll event and one read() regardless of timers count.
+ *
+ *  Wheel has 6 levels of 64 slots, level 0 tick is 1024 ns, which covers about 19 hours,
+ *  longer timeouts are cascaded from the last level.
+ *  Timer deadlines are rounded up to the tick, so timers never fire early.
+ *
+ *  Attach wheel to poller with Poller::setTimerWheel(), every Timer created on that poller afterwards
+ *  will use the wheel instead of own timerfd. Wheel must outlive its timers.
+ */
+class TimerWheel: public Descriptor
+{
+    friend class Timer;
+public:
+    /** Timer wheel constructor with default eventloop. */
+    TimerWheel();
+    /** Timer wheel constructor.
+     * @param event_poller - EventPoller instance which will be used to process events.
+     */
+    TimerWheel(Poller *event_poller);
+    TimerWheel(const TimerWheel& that) = delete;  /**< Copy contructor not allowed because of internal state and file descriptor. */
+    virtual ~TimerWheel();
+
+    virtual const char* name();
+
+    /** Request wheel statistics.
+     * @param wakeups - amount of timerfd wakeups.
+     * @param expirations - amount of timer expirations.
+     * @param rearms - amount of timerfd_settime calls.
+     */
+    void getStatistics(uint64_t &wakeups, uint64_t &expirations, uint64_t &rearms);
+
+protected:
+    virtual void _onRead();
+    virtual void _onWrite();
+
+private:
+    static const int _levels = 6;
+    static const int _level_bits = 6;
+    static const int _slots_count = 1 << _level_bits;
+    static const int _tick_shift = 10;
+    static const int _pending_level = _levels;
+
+    Timer *_slots[_levels][_slots_count];
+    Timer *_pending;
+    uint64_t _occupied[_levels];
+    uint64_t _current;      /**< last processed tick */
+    uint64_t _armed;        /**< tick timerfd is armed to, 0 if disarmed */
+    bool _processing;
+
+    uint64_t _wakeups;
+    uint64_t _expirations;
+    uint64_t _rearms;
+
+    int _start(Timer *timer);
+    int _stop(Timer *timer);
+
+    void _insert(Timer *timer);
+    void _link(Timer *timer, int level, int slot);
+    void _unlink(Timer *timer);
+    uint64_t _nextTick();
+    void _advance(uint64_t now);
+    void _rearm();
+};
+
+#endif // TIMERWHEEL_H
@@ -1,6 +1,14 @@
 #include "utils.h"
 #include <math.h>
+#include <time.h>
 
 float roundTo(float number, float precision) {
     return (float) (floor(number * (1.0f/precision) + 0.5)/(1.0f/precision));
 }
+
+uint64_t monotonicNsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
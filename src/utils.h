@@ -1,6 +1,11 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+
 float roundTo(float number, float precision);
 
+/** CLOCK_MONOTONIC time in nanoseconds. */
+uint64_t monotonicNsec();
+
 #endif // UTILS_H
@@ -1,16 +1,16 @@
 #include "vz89.h"
-#include "i2c.h"
+#include "i2cbus.h"
 #include "log.h"
 
 #define VZ89_COMMAND_SET_PPMCO2 0x08
 #define VZ89_COMMAND_GET_STATUS 0x09
 
 VZ89::VZ89():
-    VZ89(VZ89_I2C_ADDRESS, I2C::getDefault())
+    VZ89(VZ89_I2C_ADDRESS, I2CBus::getDefault())
 {
 }
 
-VZ89::VZ89(uint8_t address, I2C *bus):
+VZ89::VZ89(uint8_t address, I2CBus *bus):
     _i2c(bus), _address(address)
 {
 }
@@ -6,7 +6,7 @@
 #include <stdint.h>
 
 class Poller;
-class I2C;
+class I2CBus;
 
 class VZ89
 {
@@ -18,7 +18,7 @@ public:
      * @param bus - but instance, where sensor located.
      * @param address - device address.
      */
-    VZ89(uint8_t address, I2C *bus);
+    VZ89(uint8_t address, I2CBus *bus);
     VZ89(const VZ89& that) = delete; /**< Copy contructor is not allowed. */
     ~VZ89();
 
@@ -30,7 +30,7 @@ public:
     int getStatus(float &co2, uint8_t &reactivity, float &tvoc);
 
 private:
-    I2C *_i2c;
+    I2CBus *_i2c;
     uint8_t _address;
 
 };